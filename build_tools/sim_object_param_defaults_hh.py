@@ -0,0 +1,119 @@
+# Copyright (c) 2026 The Regents of the University of California
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are
+# met: redistributions of source code must retain the above copyright
+# notice, this list of conditions and the following disclaimer;
+# redistributions in binary form must reproduce the above copyright
+# notice, this list of conditions and the following disclaimer in the
+# documentation and/or other materials provided with the distribution;
+# neither the name of the copyright holders nor the names of its
+# contributors may be used to endorse or promote products derived from
+# this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+# "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+# A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+# OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+# SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+# LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+# DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+# THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+"""Generate a header of functions setting the default values of the params
+of SimObjects, for C++ code which builds them without the python side.
+
+For every SimObject Name, inline void NameDefaults(TypeParams &p) sets the
+params with a boolean or numeric default. Params with a proxy or a SimObject
+as default, or with no default, are left to the caller. Any other default
+is an error, rather than a param silently left unset.
+"""
+
+import argparse
+import importlib
+import os.path
+import sys
+
+import importer
+
+from code_formatter import code_formatter
+
+parser = argparse.ArgumentParser()
+parser.add_argument('modpath', help='module the simobjects belong to')
+parser.add_argument('defaults_hh', help='defaults header file to generate')
+parser.add_argument('sim_objects', nargs='+',
+                    help='names of the simobjects, in the module')
+
+args = parser.parse_args()
+
+importer.install()
+module = importlib.import_module(args.modpath)
+
+from m5.params import isNullPointer
+from m5.proxy import isproxy
+from m5.SimObject import isSimObjectOrVector
+
+def cxx_literal(sim_object, name, value):
+    """The C++ literal of the default of a param, None to leave it."""
+    if value is None or isproxy(value) or isNullPointer(value) or \
+            isSimObjectOrVector(value):
+        return None
+    value = value.getValue()
+    if isinstance(value, bool):
+        return 'true' if value else 'false'
+    if isinstance(value, int):
+        return str(value)
+    if isinstance(value, float):
+        return repr(value)
+    print(f'{sim_object.__name__}.{name}: cannot write a default of type '
+          f'{type(value).__name__}', file=sys.stderr)
+    sys.exit(1)
+
+basename = os.path.basename(args.defaults_hh)
+guard = '__PARAM_DEFAULTS_' + \
+    os.path.splitext(basename)[0].upper() + '_HH__'
+
+sim_objects = [getattr(module, name) for name in args.sim_objects]
+
+code = code_formatter()
+code('''
+#ifndef ${guard}
+#define ${guard}
+
+''')
+for cxx_type in sorted(set(sim_object.type for sim_object in sim_objects)):
+    code('#include "params/${cxx_type}.hh"')
+code('''
+
+namespace gem5
+{
+''')
+
+for sim_object in sim_objects:
+    name = sim_object.__name__
+    code('''
+
+/** The defaults of the params of ${name} */
+inline void
+${name}Defaults(${{sim_object.type}}Params &p)
+{''')
+    code.indent()
+    for param in sorted(sim_object._params.keys()):
+        literal = cxx_literal(sim_object, param,
+                              sim_object._values.get(param))
+        if literal is not None:
+            code('p.${param} = ${literal};')
+    code.dedent()
+    code('}')
+
+code('''
+
+} // namespace gem5
+
+#endif // ${guard}
+''')
+code.write(args.defaults_hh)
@@ -36,6 +36,56 @@ import m5
 # import all of the SimObjects
 from m5.objects import *
 
+# Add the common scripts to our path
+m5.util.addToPath('../../')
+
+from common import ObjectList
+from common import SimpleOpts
+
+# The replacement policy is a parameter of SimpleCache, so one binary can
+# sweep any of the policies in src/mem/cache/replacement_policies
+SimpleOpts.add_option("--replacement_policy", default="LRURP",
+                      choices=ObjectList.rp_list.get_names(),
+                      help="Replacement policy of the CacheStore. "
+                           "Default: LRURP")
+
+SimpleOpts.add_option("--indexing", default="SetAssociative",
+                      choices=CacheStoreIndexing.vals,
+                      help="Set indexing function of the CacheStore. "
+                           "Default: SetAssociative")
+
+# Any of the compressors of src/mem/cache/compressors can compress the lines
+compressor_list = ObjectList.ObjectList(
+    getattr(m5.objects, 'BaseCacheCompressor', None))
+SimpleOpts.add_option("--compressor", default=None,
+                      choices=compressor_list.get_names(),
+                      help="Compressor of the CacheStore lines. "
+                           "Default: none")
+SimpleOpts.add_option("--max_compression_ratio", type=int, default=2,
+                      help="Blocks of a super-block a way can hold when "
+                           "compressed. Default: 2")
+
+# Any of the prefetchers of src/mem/cache/prefetch can fill the cache
+SimpleOpts.add_option("--prefetcher", default=None,
+                      choices=ObjectList.hwp_list.get_names(),
+                      help="Hardware prefetcher of the cache. Default: none")
+SimpleOpts.add_option("--prefetched_first", action="store_true",
+                      help="Evict the unused prefetched lines first")
+
+SimpleOpts.add_option("--split_inst_data", action="store_true",
+                      help="Keep instruction fetches in a CacheStore (and "
+                           "MSHRs) of their own")
+
+# Warm up the cache with an atomic CPU, then switch to the timing CPU for the
+# detailed region. The cache contents survive the switch.
+SimpleOpts.add_option("--fast_forward", type=int, default=0,
+                      help="Number of instructions to fast-forward with an "
+                           "atomic CPU before switching to timing mode. "
+                           "Default: 0 (timing from the start)")
+
+# Finalize the arguments and grab the args so we can pass it on to our objects
+args = SimpleOpts.parse_args()
+
 # create the system we are going to simulate
 system = System()
 
@@ -45,7 +95,10 @@ system.clk_domain.clock = '1GHz'
 system.clk_domain.voltage_domain = VoltageDomain()
 
 # Set up the system
-system.mem_mode = 'timing'               # Use timing accesses
+if args.fast_forward:
+    system.mem_mode = 'atomic'           # Use atomic accesses until the switch
+else:
+    system.mem_mode = 'timing'           # Use timing accesses
 system.mem_ranges = [AddrRange('512MB')] # Create an address range
 
 # Set the cache line size of the CacheStore in system
@@ -53,7 +106,12 @@ system.mem_ranges = [AddrRange('512MB')] # Create an address range
 system.cache_line_size = 32
 
 # Create a simple CPU
-system.cpu = TimingSimpleCPU()
+if args.fast_forward:
+    system.cpu = AtomicSimpleCPU(max_insts_any_thread=args.fast_forward)
+    # The timing CPU takes over the ports of the atomic one at the switch
+    system.switch_cpu = TimingSimpleCPU(switched_out=True)
+else:
+    system.cpu = TimingSimpleCPU()
 
 # Create a memory bus, a coherent crossbar, in this case
 system.membus = SystemXBar()
@@ -62,6 +120,22 @@ system.membus = SystemXBar()
 system.cache = SimpleCache()
 system.cache.line_per_set = 4
 system.cache.param_for_set = 1
+system.cache.replacement_policy = \
+    ObjectList.rp_list.get(args.replacement_policy)()
+system.cache.indexing = args.indexing
+if args.compressor:
+    system.cache.compressor = compressor_list.get(args.compressor)()
+    system.cache.max_compression_ratio = args.max_compression_ratio
+    # The replacement policy sees every slot of the super-blocks
+    system.cache.assoc = \
+        system.cache.line_per_set * args.max_compression_ratio
+if args.prefetcher:
+    system.cache.prefetcher = ObjectList.hwp_list.get(args.prefetcher)()
+    system.cache.prefetched_first = args.prefetched_first
+if args.split_inst_data:
+    system.cache.split_inst_data = True
+    system.cache.inst_line_per_set = 2
+    system.cache.inst_param_for_set = 1
 
 # Connect the I and D cache ports of the CPU to the memobj.
 # Since cpu_side is a vector port, each time one of these is connected, it will
@@ -100,6 +174,12 @@ process.cmd = [binpath]
 system.cpu.workload = process
 system.cpu.createThreads()
 
+if args.fast_forward:
+    system.switch_cpu.workload = process
+    system.switch_cpu.clk_domain = system.cpu.clk_domain
+    system.switch_cpu.isa = system.cpu.isa
+    system.switch_cpu.createThreads()
+
 system.workload = SEWorkload.init_compatible(binpath)
 
 # set up the root SimObject and start the simulation
@@ -109,4 +189,11 @@ m5.instantiate()
 
 print("Beginning simulation!")
 exit_event = m5.simulate()
+
+if args.fast_forward and \
+        exit_event.getCause() == "a thread reached the max instruction count":
+    print("Switching to timing mode @ tick %i" % m5.curTick())
+    # Drains the system (including the cache) and changes the memory mode
+    m5.switchCpus(system, [(system.cpu, system.switch_cpu)])
+    exit_event = m5.simulate()
 print('Exiting @ tick %i because %s' % (m5.curTick(), exit_event.getCause()))
@@ -0,0 +1,166 @@
+# -*- coding: utf-8 -*-
+# Copyright (c) 2017 Jason Lowe-Power
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are
+# met: redistributions of source code must retain the above copyright
+# notice, this list of conditions and the following disclaimer;
+# redistributions in binary form must reproduce the above copyright
+# notice, this list of conditions and the following disclaimer in the
+# documentation and/or other materials provided with the distribution;
+# neither the name of the copyright holders nor the names of its
+# contributors may be used to endorse or promote products derived from
+# this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+# "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+# A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+# OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+# SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+# LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+# DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+# THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+""" This file creates a barebones system and executes 'hello', a simple Hello
+World application. Uses SimpleCache for every level of a cache hierarchy:
+split L1 instruction and data caches, an L2 and optionally an LLC, with the
+inclusion policy of the lower levels selectable.
+
+The L1 caches are not kept coherent with each other, which is fine for
+single-threaded SE workloads without self-modifying code.
+
+This config file assumes that the x86 ISA was built.
+"""
+
+# import the m5 (gem5) library created when gem5 is built
+import m5
+# import all of the SimObjects
+from m5.objects import *
+
+# Add the common scripts to our path
+m5.util.addToPath('../../')
+
+from common import ObjectList
+from common import SimpleOpts
+
+SimpleOpts.add_option("--levels", type=int, default=2, choices=[2, 3],
+                      help="Number of cache levels (L1 + L2, or L1 + L2 + "
+                           "LLC). Default: 2")
+SimpleOpts.add_option("--inclusion", default="NINE",
+                      choices=SimpleCacheInclusion.vals,
+                      help="Inclusion policy of the levels below the L1s. "
+                           "Default: NINE")
+SimpleOpts.add_option("--replacement_policy", default="LRURP",
+                      choices=ObjectList.rp_list.get_names(),
+                      help="Replacement policy of the last level. "
+                           "Default: LRURP")
+
+# Finalize the arguments and grab the args so we can pass it on to our objects
+args = SimpleOpts.parse_args()
+
+# create the system we are going to simulate
+system = System()
+
+# Set the clock fequency of the system (and all of its children)
+system.clk_domain = SrcClockDomain()
+system.clk_domain.clock = '1GHz'
+system.clk_domain.voltage_domain = VoltageDomain()
+
+# Set up the system
+system.mem_mode = 'timing'               # Use timing accesses
+system.mem_ranges = [AddrRange('512MB')] # Create an address range
+
+# Set the cache line size of the CacheStore in system
+# only four values are acceptable: 16, 32, 64, 128(Bytes)
+system.cache_line_size = 32
+
+# Create a simple CPU
+system.cpu = TimingSimpleCPU()
+
+# Create a memory bus, a coherent crossbar, in this case
+system.membus = SystemXBar()
+
+def make_cache(sets_bits, assoc, latency):
+    cache = SimpleCache()
+    cache.param_for_set = sets_bits
+    cache.line_per_set = assoc
+    cache.latency = latency
+    return cache
+
+# Private L1 caches. Above an exclusive cache the clean victims have to be
+# written back with their data, that is how the victim cache is filled.
+system.cpu.icache = make_cache(2, 2, 1)
+system.cpu.dcache = make_cache(2, 2, 1)
+system.cpu.icache.writeback_clean = (args.inclusion == 'Exclusive')
+system.cpu.dcache.writeback_clean = (args.inclusion == 'Exclusive')
+
+system.cpu.icache_port = system.cpu.icache.cpu_side
+system.cpu.dcache_port = system.cpu.dcache.cpu_side
+
+# L2: both L1s connect to its vector cpu_side port
+system.l2cache = make_cache(4, 4, 4)
+system.l2cache.inclusion = args.inclusion
+system.l2cache.upper_caches = [system.cpu.icache, system.cpu.dcache]
+system.cpu.icache.mem_side = system.l2cache.cpu_side
+system.cpu.dcache.mem_side = system.l2cache.cpu_side
+last_level = system.l2cache
+
+if args.levels == 3:
+    system.l2cache.writeback_clean = (args.inclusion == 'Exclusive')
+
+    system.llc = make_cache(6, 8, 10)
+    system.llc.inclusion = args.inclusion
+    system.llc.upper_caches = [system.l2cache]
+    system.l2cache.mem_side = system.llc.cpu_side
+    last_level = system.llc
+
+# The replacement choices of the last level are the ones under study
+last_level.replacement_policy = \
+    ObjectList.rp_list.get(args.replacement_policy)()
+
+# Hook the last level up to the memory bus
+last_level.mem_side = system.membus.cpu_side_ports
+
+# create the interrupt controller for the CPU and connect to the membus
+system.cpu.createInterruptController()
+system.cpu.interrupts[0].pio = system.membus.mem_side_ports
+system.cpu.interrupts[0].int_requestor = system.membus.cpu_side_ports
+system.cpu.interrupts[0].int_responder = system.membus.mem_side_ports
+
+# Create a DDR3 memory controller and connect it to the membus
+system.mem_ctrl = MemCtrl()
+system.mem_ctrl.dram = DDR3_1600_8x8()
+system.mem_ctrl.dram.range = system.mem_ranges[0]
+system.mem_ctrl.port = system.membus.mem_side_ports
+
+# Connect the system up to the membus
+system.system_port = system.membus.cpu_side_ports
+
+# Create a process for a simple "Hello World" application
+process = Process()
+# Set the command
+# grab the specific path to the binary
+thispath = os.path.dirname(os.path.realpath(__file__))
+binpath = os.path.join(thispath, '../../../',
+                       'tests/test-progs/hello/bin/x86/linux/hello')
+# cmd is a list which begins with the executable (like argv)
+process.cmd = [binpath]
+# Set the cpu to use the process as its workload and create thread contexts
+system.cpu.workload = process
+system.cpu.createThreads()
+
+system.workload = SEWorkload.init_compatible(binpath)
+
+# set up the root SimObject and start the simulation
+root = Root(full_system = False, system = system)
+# instantiate all of the objects we've created above
+m5.instantiate()
+
+print("Beginning simulation!")
+exit_event = m5.simulate()
+print('Exiting @ tick %i because %s' % (m5.curTick(), exit_event.getCause()))
@@ -0,0 +1,119 @@
+# -*- coding: utf-8 -*-
+# Copyright (c) 2026 The Regents of the University of California
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are
+# met: redistributions of source code must retain the above copyright
+# notice, this list of conditions and the following disclaimer;
+# redistributions in binary form must reproduce the above copyright
+# notice, this list of conditions and the following disclaimer in the
+# documentation and/or other materials provided with the distribution;
+# neither the name of the copyright holders nor the names of its
+# contributors may be used to endorse or promote products derived from
+# this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+# "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+# A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+# OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+# SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+# LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+# DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+# THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+""" This file checks that the data of a SimpleCache hierarchy stays correct
+while an inclusive cache below back-invalidates the caches above it.
+
+Every MemTest tester has a private SimpleCache L1, with several misses
+outstanding, and all the L1s share an L2 much smaller than them. The L2
+keeps evicting the blocks the L1s are still fetching or writing back,
+which is the race between the back-invalidations and the fills and
+writebacks in flight. The testers use disjoint regions as the L1s are not
+kept coherent with each other, and check the data of every load. The
+script exits with an error if the testers do not all reach --loads.
+"""
+
+import sys
+
+# import the m5 (gem5) library created when gem5 is built
+import m5
+# import all of the SimObjects
+from m5.objects import *
+
+# Add the common scripts to our path
+m5.util.addToPath('../../')
+
+from common import SimpleOpts
+
+SimpleOpts.add_option("--testers", type=int, default=2,
+                      help="Number of testers. Default: 2")
+SimpleOpts.add_option("--inclusion", default="Inclusive",
+                      choices=SimpleCacheInclusion.vals,
+                      help="Inclusion policy of the L2. Default: Inclusive")
+SimpleOpts.add_option("--loads", type=int, default=100000,
+                      help="Number of loads of each tester. Default: 100000")
+
+# Finalize the arguments and grab the args so we can pass it on to our objects
+args = SimpleOpts.parse_args()
+
+def make_cache(sets_bits, assoc, latency):
+    cache = SimpleCache()
+    cache.param_for_set = sets_bits
+    cache.line_per_set = assoc
+    cache.latency = latency
+    return cache
+
+# Each tester in a region of its own
+system = System()
+system.tester = [MemTest(max_loads=args.loads, progress_interval=args.loads,
+                         size=0x10000,
+                         base_addr_1=(2 * i + 1) * 0x100000,
+                         base_addr_2=(2 * i + 2) * 0x100000,
+                         percent_uncacheable=0, percent_functional=0)
+                 for i in range(args.testers)]
+
+system.clk_domain = SrcClockDomain()
+system.clk_domain.clock = '1GHz'
+system.clk_domain.voltage_domain = VoltageDomain()
+
+system.mem_mode = 'timing'
+system.mem_ranges = [AddrRange('512MB')]
+
+# Private L1s, each with several fills in flight
+system.l1cache = [make_cache(4, 4, 1) for i in range(args.testers)]
+system.l2bus = L2XBar()
+for tester, l1cache in zip(system.tester, system.l1cache):
+    l1cache.mshrs = 8
+    l1cache.writeback_clean = (args.inclusion == 'Exclusive')
+    tester.port = l1cache.cpu_side
+    l1cache.mem_side = system.l2bus.cpu_side_ports
+
+# A tiny L2, which evicts all the time
+system.l2cache = make_cache(2, 2, 4)
+system.l2cache.inclusion = args.inclusion
+system.l2cache.upper_caches = system.l1cache
+system.l2cache.cpu_side = system.l2bus.mem_side_ports
+
+system.membus = SystemXBar()
+system.l2cache.mem_side = system.membus.cpu_side_ports
+
+system.physmem = SimpleMemory(range=system.mem_ranges[0])
+system.physmem.port = system.membus.mem_side_ports
+
+system.system_port = system.membus.cpu_side_ports
+
+# set up the root SimObject and start the simulation
+root = Root(full_system = False, system = system)
+# instantiate all of the objects we've created above
+m5.instantiate()
+
+print("Beginning simulation!")
+exit_event = m5.simulate()
+print('Exiting @ tick %i because %s' % (m5.curTick(), exit_event.getCause()))
+
+if exit_event.getCause() != "maximum number of loads reached":
+    sys.exit(1)
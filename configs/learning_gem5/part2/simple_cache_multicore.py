@@ -0,0 +1,153 @@
+# -*- coding: utf-8 -*-
+# Copyright (c) 2017 Jason Lowe-Power
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are
+# met: redistributions of source code must retain the above copyright
+# notice, this list of conditions and the following disclaimer;
+# redistributions in binary form must reproduce the above copyright
+# notice, this list of conditions and the following disclaimer in the
+# documentation and/or other materials provided with the distribution;
+# neither the name of the copyright holders nor the names of its
+# contributors may be used to endorse or promote products derived from
+# this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+# "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+# A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+# OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+# SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+# LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+# DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+# THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+""" This file creates a barebones multi-core system where every core runs
+its own copy of 'hello' and all the cores share one SimpleCache. The ways
+of the shared cache can be partitioned among the cores, statically or with
+UCP, to compare the throughput of a consolidated workload with and without
+isolation (see the partition* stats of the cache).
+
+The cores do not share memory, so no coherence is needed.
+
+This config file assumes that the x86 ISA was built.
+"""
+
+# import the m5 (gem5) library created when gem5 is built
+import m5
+# import all of the SimObjects
+from m5.objects import *
+
+# Add the common scripts to our path
+m5.util.addToPath('../../')
+
+from common import ObjectList
+from common import SimpleOpts
+
+SimpleOpts.add_option("--cores", type=int, default=2,
+                      help="Number of cores sharing the cache. Default: 2")
+SimpleOpts.add_option("--partitioning", default="NoPartitioning",
+                      choices=SimpleCachePartitioning.vals,
+                      help="Way partitioning among the cores. "
+                           "Default: NoPartitioning")
+SimpleOpts.add_option("--way_masks", default="",
+                      help="Comma-separated way mask of every core for "
+                           "StaticWays partitioning, e.g. 0x3,0xc. "
+                           "Default: an even split")
+SimpleOpts.add_option("--replacement_policy", default="LRURP",
+                      choices=ObjectList.rp_list.get_names(),
+                      help="Replacement policy of the shared cache. "
+                           "Default: LRURP")
+
+# Finalize the arguments and grab the args so we can pass it on to our objects
+args = SimpleOpts.parse_args()
+
+# create the system we are going to simulate
+system = System()
+
+# Set the clock fequency of the system (and all of its children)
+system.clk_domain = SrcClockDomain()
+system.clk_domain.clock = '1GHz'
+system.clk_domain.voltage_domain = VoltageDomain()
+
+# Set up the system
+system.mem_mode = 'timing'               # Use timing accesses
+system.mem_ranges = [AddrRange('512MB')] # Create an address range
+
+# Set the cache line size of the CacheStore in system
+# only four values are acceptable: 16, 32, 64, 128(Bytes)
+system.cache_line_size = 32
+
+# Create the cores, named system.cpu0, system.cpu1...
+system.cpu = [TimingSimpleCPU(cpu_id=i) for i in range(args.cores)]
+
+# Create a memory bus, a coherent crossbar, in this case
+system.membus = SystemXBar()
+
+# One shared cache, with enough ways to give every core a few
+system.cache = SimpleCache()
+system.cache.line_per_set = 8
+system.cache.param_for_set = 4
+system.cache.mshrs = 4 * args.cores
+system.cache.replacement_policy = \
+    ObjectList.rp_list.get(args.replacement_policy)()
+
+# A partition per core, which holds its instruction and data requestors
+system.cache.partitioning = args.partitioning
+system.cache.partition_requestors = \
+    ['system.cpu%d' % i for i in range(args.cores)]
+if args.partitioning == 'StaticWays':
+    if args.way_masks:
+        system.cache.way_masks = \
+            [int(mask, 0) for mask in args.way_masks.split(',')]
+    else:
+        ways = system.cache.line_per_set // args.cores
+        system.cache.way_masks = \
+            [((1 << ways) - 1) << (i * ways) for i in range(args.cores)]
+
+thispath = os.path.dirname(os.path.realpath(__file__))
+binpath = os.path.join(thispath, '../../../',
+                       'tests/test-progs/hello/bin/x86/linux/hello')
+
+for cpu in system.cpu:
+    # Both ports of every core connect to the vector cpu_side port
+    cpu.icache_port = system.cache.cpu_side
+    cpu.dcache_port = system.cache.cpu_side
+
+    # create the interrupt controller for the CPU and connect to the membus
+    cpu.createInterruptController()
+    cpu.interrupts[0].pio = system.membus.mem_side_ports
+    cpu.interrupts[0].int_requestor = system.membus.cpu_side_ports
+    cpu.interrupts[0].int_responder = system.membus.mem_side_ports
+
+    # Every core runs its own process
+    process = Process(pid=100 + cpu.cpu_id)
+    process.cmd = [binpath]
+    cpu.workload = process
+    cpu.createThreads()
+
+# Hook the cache up to the memory bus
+system.cache.mem_side = system.membus.cpu_side_ports
+
+# Create a DDR3 memory controller and connect it to the membus
+system.mem_ctrl = MemCtrl()
+system.mem_ctrl.dram = DDR3_1600_8x8()
+system.mem_ctrl.dram.range = system.mem_ranges[0]
+system.mem_ctrl.port = system.membus.mem_side_ports
+
+# Connect the system up to the membus
+system.system_port = system.membus.cpu_side_ports
+
+system.workload = SEWorkload.init_compatible(binpath)
+
+# set up the root SimObject and start the simulation
+root = Root(full_system = False, system = system)
+# instantiate all of the objects we've created above
+m5.instantiate()
+
+print("Beginning simulation!")
+exit_event = m5.simulate()
+print('Exiting @ tick %i because %s' % (m5.curTick(), exit_event.getCause()))
@@ -0,0 +1,160 @@
+# -*- coding: utf-8 -*-
+# Copyright (c) 2026 The Regents of the University of California
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are
+# met: redistributions of source code must retain the above copyright
+# notice, this list of conditions and the following disclaimer;
+# redistributions in binary form must reproduce the above copyright
+# notice, this list of conditions and the following disclaimer in the
+# documentation and/or other materials provided with the distribution;
+# neither the name of the copyright holders nor the names of its
+# contributors may be used to endorse or promote products derived from
+# this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+# "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+# A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+# OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+# SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+# LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+# DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+# THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+""" This file checks that a multi-core system simulated by several threads
+behaves exactly as when it is simulated by a single thread.
+
+It creates two identical systems, where every core runs its own copy of
+'hello' through a private SimpleCache, and the cores share a memory bus
+and controller. m5.parallel partitions system_a onto a single event queue
+and system_b onto --threads event queues, i.e., host threads, and both
+are simulated side by side. All the statistics of the two systems must
+match, and the script exits with an error otherwise.
+
+This config file assumes that the x86 ISA was built.
+"""
+
+import os
+import sys
+
+# import the m5 (gem5) library created when gem5 is built
+import m5
+# import all of the SimObjects
+from m5.objects import *
+from m5.parallel import partition
+from m5.stats.gem5stats import get_simstat
+
+# Add the common scripts to our path
+m5.util.addToPath('../../')
+
+from common import SimpleOpts
+
+SimpleOpts.add_option("--cores", type=int, default=4,
+                      help="Number of cores of each system. Default: 4")
+SimpleOpts.add_option("--threads", type=int, default=2,
+                      help="Number of threads simulating system_b. "
+                           "Default: 2")
+SimpleOpts.add_option("--latency", default="1ns",
+                      help="Latency between the cores and the memory bus, "
+                           "also the simulation quantum. Default: 1ns")
+
+# Finalize the arguments and grab the args so we can pass it on to our objects
+args = SimpleOpts.parse_args()
+
+thispath = os.path.dirname(os.path.realpath(__file__))
+binpath = os.path.join(thispath, '../../../',
+                       'tests/test-progs/hello/bin/x86/linux/hello')
+
+def create_system(first_pid):
+    system = System()
+
+    # Set the clock fequency of the system (and all of its children)
+    system.clk_domain = SrcClockDomain()
+    system.clk_domain.clock = '1GHz'
+    system.clk_domain.voltage_domain = VoltageDomain()
+
+    system.mem_mode = 'timing'
+    system.mem_ranges = [AddrRange('1GB')]
+
+    system.cpu = [TimingSimpleCPU(cpu_id=i) for i in range(args.cores)]
+    system.membus = SystemXBar()
+
+    # A private cache per core, which the partitioner finds through the
+    # ports of the core
+    system.cache = [SimpleCache() for i in range(args.cores)]
+
+    for cpu, cache in zip(system.cpu, system.cache):
+        cpu.icache_port = cache.cpu_side
+        cpu.dcache_port = cache.cpu_side
+        cache.mem_side = system.membus.cpu_side_ports
+
+        # create the interrupt controller for the CPU and connect to the
+        # membus
+        cpu.createInterruptController()
+        cpu.interrupts[0].pio = system.membus.mem_side_ports
+        cpu.interrupts[0].int_requestor = system.membus.cpu_side_ports
+        cpu.interrupts[0].int_responder = system.membus.mem_side_ports
+
+        # Every core runs its own process
+        process = Process(pid=first_pid + cpu.cpu_id)
+        process.cmd = [binpath]
+        cpu.workload = process
+        cpu.createThreads()
+
+    # Create a DDR3 memory controller and connect it to the membus
+    system.mem_ctrl = MemCtrl()
+    system.mem_ctrl.dram = DDR3_1600_8x8()
+    system.mem_ctrl.dram.range = system.mem_ranges[0]
+    system.mem_ctrl.port = system.membus.mem_side_ports
+
+    system.system_port = system.membus.cpu_side_ports
+
+    system.workload = SEWorkload.init_compatible(binpath)
+    return system
+
+system_a = create_system(100)
+system_b = create_system(200)
+
+# system_a on the main event queue, system_b on the others
+partition(system_a, [0], latency=args.latency, arena='8MB')
+partition(system_b, range(1, 1 + args.threads), latency=args.latency,
+          arena='8MB')
+
+# set up the root SimObject and start the simulation
+root = Root(full_system = False, system_a = system_a, system_b = system_b)
+root.sim_quantum = m5.ticks.fromSeconds(
+    m5.util.convert.anyToLatency(args.latency))
+# instantiate all of the objects we've created above
+m5.instantiate()
+
+print("Beginning simulation!")
+exit_event = m5.simulate()
+print('Exiting @ tick %i because %s' % (m5.curTick(), exit_event.getCause()))
+
+def flatten(stats, prefix=''):
+    """All the values of a tree of statistics, by name."""
+    values = {}
+    for key, value in stats.items():
+        if isinstance(value, dict):
+            values.update(flatten(value, prefix + key + '.'))
+        else:
+            values[prefix + key] = value
+    return values
+
+simstat = get_simstat(root)
+stats_a = flatten(simstat.system_a.to_json())
+stats_b = flatten(simstat.system_b.to_json())
+mismatches = sorted(name for name in set(stats_a) | set(stats_b)
+                    if stats_a.get(name) != stats_b.get(name))
+for name in mismatches:
+    print('%s: %s on one thread, %s on %d threads' %
+          (name, stats_a.get(name), stats_b.get(name), args.threads))
+
+if mismatches:
+    print('%d statistics differ' % len(mismatches))
+    sys.exit(1)
+print('%d statistics match' % len(stats_a))
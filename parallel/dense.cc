@@ -8,20 +8,34 @@
 #include <iostream>
 #include <sstream>
 
+#include "roi.hpp"
+
 using namespace std;
 
-pthread_mutex_t mutex;
+// register block of the micro-kernel: MR rows of x_matrix, NR columns (two vectors)
+const int MR = 4;
+const int NR = 8;
+// the cache-oblivious recursion stops once the three blocks are at most LEAF x LEAF
+const int LEAF = 64;
+// progress messages of the threads (off in harness.cc)
+bool verbose = true;
+
+// 4 ints, lowered to SSE2 on x86 and NEON on Arm (scalar code elsewhere)
+typedef int v4si __attribute__((vector_size(16)));
+// same vector, loaded from and stored to addresses aligned on an int only
+typedef int v4si_u __attribute__((vector_size(16), aligned(4)));
 
 typedef struct _thread_arg
 {
     int matrix_size;
     int blocking_factor;
-    int **x_matrix;
-    int **y_matrix;
-    int **z_matrix; // matrix multiplication
+    int kernel; // 0: tiled, 1: cache-oblivious
+    int *x_matrix;
+    int *y_matrix;
+    int *z_matrix; // matrix multiplication, row-major
 
     int blocks_num;
-    int *block_id; // workload: which blocks the thread should handle
+    int *block_id; // workload: which blocks of x_matrix the thread owns
 
     // for core binding:
     char tag[10];             // thread name(tag)
@@ -31,7 +45,7 @@ typedef struct _thread_arg
 
     _thread_arg()
     {
-        matrix_size = blocking_factor = blocks_num = 0;
+        matrix_size = blocking_factor = kernel = blocks_num = 0;
         x_matrix = y_matrix = z_matrix = NULL;
         block_id = NULL;
 
@@ -41,16 +55,15 @@ typedef struct _thread_arg
     };
 } thread_arg;
 
-int ** gen_matrix(int matrix_size, float sparse_factor)
+// element (i, j) of a row-major matrix is matrix[i * matrix_size + j]
+int * gen_matrix(int matrix_size, float sparse_factor)
 {
     bool flag = false;  // assert that at least one non-zero element can be found
-    int ** matrix = new int * [matrix_size];
-    for (int i = 0; i < matrix_size; ++i)
-        matrix[i] = new int [matrix_size];
+    int * matrix = new int [matrix_size * matrix_size];
     for (int i = 0; i < matrix_size; ++i)
         for (int j = 0; j < matrix_size; ++j) {
             float possibility = rand() % 100 / (float) (100);
-            matrix[i][j] = (possibility < sparse_factor);
+            matrix[i * matrix_size + j] = (possibility < sparse_factor);
             if (possibility < sparse_factor)
                 flag = true;
         }
@@ -58,49 +71,46 @@ int ** gen_matrix(int matrix_size, float sparse_factor)
     return matrix;
 }
 
-void destructor(int **matrix, int matrix_size)
+void destructor(int *matrix)
 {
-    for (int i = 0; i < matrix_size; ++i)
-        delete[] matrix[i];
     delete[] matrix;
 }
 
-void print_matrix(int **matrix, int matrix_size)
+void print_matrix(int *matrix, int matrix_size)
 {
     for (int i = 0; i < matrix_size; ++i)
     {
         for (int j = 0; j < matrix_size; ++j)
-            cout << matrix[i][j] << " ";
+            cout << matrix[i * matrix_size + j] << " ";
         cout << endl;
     }
 }
 
 // for correctness
-bool benchmark(int matrix_size, int **x_matrix, int **y_matrix, int **z_matrix)
+bool benchmark(int matrix_size, int *x_matrix, int *y_matrix, int *z_matrix)
 {
-    int **benchmark_matrix = gen_matrix(matrix_size, 0.5);
+    int *benchmark_matrix = gen_matrix(matrix_size, 0.5);
     for (int i = 0; i < matrix_size; ++i)
         for (int j = 0; j < matrix_size; ++j)
         {
             int r = 0;
             for (int k = 0; k < matrix_size; ++k)
-                r += y_matrix[i][k] * z_matrix[k][j];
-            benchmark_matrix[i][j] = r;
+                r += y_matrix[i * matrix_size + k] * z_matrix[k * matrix_size + j];
+            benchmark_matrix[i * matrix_size + j] = r;
         }
 
     cout << "=== BENCHMARK_MATRIX ===" << endl;
     print_matrix(benchmark_matrix, matrix_size);
     cout << endl;
 
-    for (int i = 0; i < matrix_size; ++i)
-        for (int j = 0; j < matrix_size; ++j)
-            if (benchmark_matrix[i][j] != x_matrix[i][j])
-            {
-                destructor(benchmark_matrix, matrix_size);
-                return false;
-            }
+    for (int i = 0; i < matrix_size * matrix_size; ++i)
+        if (benchmark_matrix[i] != x_matrix[i])
+        {
+            destructor(benchmark_matrix);
+            return false;
+        }
 
-    destructor(benchmark_matrix, matrix_size);
+    destructor(benchmark_matrix);
 
     return true;
 }
@@ -119,43 +129,113 @@ static void *wrapper(void *args)
         CPU_SET(obj->core_id, &cpuset);
 
     pthread_setaffinity_np(obj->pid, sizeof(cpu_set_t), &cpuset);
-    cout << obj->tag << " starts running..." << endl;
+    if (verbose)
+        cout << obj->tag << " starts running..." << endl;
     obj->run(args);
     return NULL;
 }
 
+// x[m x n] += y[m x k] * z[k x n], all three inside matrices of leading dimension ld
+static void kernel(const int *y, const int *z, int *x, int m, int n, int k, int ld)
+{
+    int i = 0;
+    for (; i + MR <= m; i += MR)
+    {
+        int j = 0;
+        for (; j + NR <= n; j += NR)
+        { // micro-kernel: the MR x NR block of x stays in registers along k
+            v4si acc[MR][2];
+            for (int r = 0; r < MR; ++r)
+            {
+                acc[r][0] = *(const v4si_u *)&x[(i + r) * ld + j];
+                acc[r][1] = *(const v4si_u *)&x[(i + r) * ld + j + 4];
+            }
+            for (int p = 0; p < k; ++p)
+            {
+                v4si z0 = *(const v4si_u *)&z[p * ld + j];
+                v4si z1 = *(const v4si_u *)&z[p * ld + j + 4];
+                for (int r = 0; r < MR; ++r)
+                {
+                    int a = y[(i + r) * ld + p]; // broadcast
+                    acc[r][0] += a * z0;
+                    acc[r][1] += a * z1;
+                }
+            }
+            for (int r = 0; r < MR; ++r)
+            {
+                *(v4si_u *)&x[(i + r) * ld + j] = acc[r][0];
+                *(v4si_u *)&x[(i + r) * ld + j + 4] = acc[r][1];
+            }
+        }
+        // columns left over by the register block
+        for (int r = i; r < i + MR; ++r)
+            for (int p = 0; p < k; ++p)
+                for (int c = j; c < n; ++c)
+                    x[r * ld + c] += y[r * ld + p] * z[p * ld + c];
+    }
+    // rows left over by the register block
+    for (; i < m; ++i)
+        for (int p = 0; p < k; ++p)
+            for (int c = 0; c < n; ++c)
+                x[i * ld + c] += y[i * ld + p] * z[p * ld + c];
+}
+
+// cache-oblivious: halve the largest dimension until the three blocks fit the
+// leaf size, whatever the cache sizes are
+static void recursive(const int *y, const int *z, int *x, int m, int n, int k, int ld, int leaf)
+{
+    if (m <= leaf && n <= leaf && k <= leaf)
+        kernel(y, z, x, m, n, k, ld);
+    else if (m >= n && m >= k)
+    { // rows of x, independent
+        int h = m / 2;
+        recursive(y, z, x, h, n, k, ld, leaf);
+        recursive(y + h * ld, z, x + h * ld, m - h, n, k, ld, leaf);
+    }
+    else if (n >= k)
+    { // columns of x, independent
+        int h = n / 2;
+        recursive(y, z, x, m, h, k, ld, leaf);
+        recursive(y, z + h, x + h, m, n - h, k, ld, leaf);
+    }
+    else
+    { // the sum, both halves accumulate into the same block of x one after the other
+        int h = k / 2;
+        recursive(y, z, x, m, n, h, ld, leaf);
+        recursive(y + h, z + h * ld, x, m, n, k - h, ld, leaf);
+    }
+}
+
 static void *thread_routine(void *arg)
 {
     thread_arg *argu = (thread_arg *)arg; // parse the arguments
     int matrix_size = argu->matrix_size;
     int blocking_factor = argu->blocking_factor;
-    int **x_matrix = argu->x_matrix;
-    int **y_matrix = argu->y_matrix;
-    int **z_matrix = argu->z_matrix;
+    int *x_matrix = argu->x_matrix;
+    int *y_matrix = argu->y_matrix;
+    int *z_matrix = argu->z_matrix;
     int blocks_num = argu->blocks_num;
     int *block_id = argu->block_id;
 
+    // every block of x_matrix is owned by a single thread, which computes it
+    // completely: no two threads write the same element, no locking
+    int blocks_per_row = matrix_size / blocking_factor;
     for (int i = 0; i < blocks_num; ++i)
     { // each iteration handles one block
-        // calculate the starting row and column: jj, kk
+        // calculate the starting row and column: ii, jj
         int id = block_id[i];
-        int blocks_per_row = matrix_size / blocking_factor;
-        int jj = floor(id / blocks_per_row) * blocking_factor;
-        int kk = (id % blocks_per_row) * blocking_factor;
-
-        for (int i = 0; i < matrix_size; ++i)
-            // all rows in x_matrix are affected
-            for (int k = kk; k < kk + blocking_factor; k++)
-            { // update elements in certain columns
-                int r = 0;
-                for (int j = 0; j < blocking_factor; j++)
-                    // number of elements to be added
-                    r += y_matrix[i][jj + j] * z_matrix[jj + j][k];
-                pthread_mutex_lock(&mutex);
-                x_matrix[i][k] += r;
-                pthread_mutex_unlock(&mutex);
-                // fine-grained locks for refinement
-            }
+        int ii = (id / blocks_per_row) * blocking_factor;
+        int jj = (id % blocks_per_row) * blocking_factor;
+
+        if (argu->kernel == 1)
+            recursive(y_matrix + ii * matrix_size, z_matrix + jj, x_matrix + ii * matrix_size + jj,
+                      blocking_factor, blocking_factor, matrix_size, matrix_size, LEAF);
+        else
+            for (int kk = 0; kk < matrix_size; kk += blocking_factor)
+                // one block of y_matrix times one block of z_matrix
+                kernel(y_matrix + ii * matrix_size + kk, z_matrix + kk * matrix_size + jj,
+                       x_matrix + ii * matrix_size + jj,
+                       blocking_factor, blocking_factor, blocking_factor, matrix_size);
     }
 
     // to check the correctness of core binding (use top)
@@ -165,6 +245,64 @@ static void *thread_routine(void *arg)
     return NULL;
 }
 
+// X = Y * Z on threads_number threads, bound to cores if binding, with the
+// tiled (kernel 0) or cache-oblivious (kernel 1) kernel; x_matrix is overwritten
+void multiply(int *x_matrix, int *y_matrix, int *z_matrix, int matrix_size, int blocking_factor,
+              int threads_number, int binding, int kernel)
+{
+    memset(x_matrix, 0, sizeof(int) * matrix_size * matrix_size);
+
+    int num_of_blocks = (matrix_size / blocking_factor) * (matrix_size / blocking_factor);
+    int blocks_per_thread = floor(num_of_blocks / threads_number);
+    thread_arg *args = new thread_arg[threads_number]; // thread argument
+    int nproc = sysconf(_SC_NPROCESSORS_CONF);
+
+    // prepare arguments
+    for (int i = 0; i < threads_number; ++i)
+    {
+        args[i].matrix_size = matrix_size;
+        args[i].blocking_factor = blocking_factor;
+        args[i].kernel = kernel;
+        args[i].x_matrix = x_matrix;
+        args[i].y_matrix = y_matrix;
+        args[i].z_matrix = z_matrix;
+
+        if (i != threads_number - 1)
+            args[i].blocks_num = blocks_per_thread;
+        else
+            args[i].blocks_num = num_of_blocks - blocks_per_thread * (threads_number - 1);
+
+        args[i].block_id = new int[args[i].blocks_num];
+        // then, assign block id to thread: contiguous blocks of x_matrix, row by row
+        for (int j = 0; j < args[i].blocks_num; ++j)
+        {
+            args[i].block_id[j] = i * blocks_per_thread + j;
+        }
+
+        // for core binding:
+        args[i].run = thread_routine;
+        stringstream t;
+        t << i;
+        strcpy(args[i].tag, ("id-" + t.str()).c_str());
+        if (binding) // core0 is left to the main thread, unless it is the only one
+            args[i].core_id = nproc > 1 ? i % (nproc - 1) + 1 : 0;
+        else
+            args[i].core_id = nproc;
+    }
+
+    for (int i = 0; i < threads_number; ++i)
+        pthread_create(&args[i].pid, NULL, wrapper, (void *)&args[i]);
+
+    for (int i = 0; i < threads_number; ++i)
+        pthread_join(args[i].pid, NULL);
+
+    for (int i = 0; i < threads_number; ++i)
+        delete[] args[i].block_id;
+
+    delete[] args;
+}
+
+#ifndef HARNESS // harness.cc has its own main
 int stoi(char *a)
 {
     stringstream b(a);
@@ -181,8 +319,10 @@ int main(int argc, char **argv)
     CPU_SET(0, &cpuset);
     pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
 
-    // usage: ./dense.out [matrix size] [blocking factor] [threads number] [binding] [sparse factor]
-    assert(argc == 6); // then, parse the parameters
+    // usage: ./dense.out [matrix size] [blocking factor] [threads number] [binding] [sparse factor] [kernel]
+    // kernel (optional): 0 tiled, blocks of y_matrix and z_matrix of the blocking factor (default)
+    //                    1 cache-oblivious, every block of x_matrix by recursive halving
+    assert(argc == 6 || argc == 7); // then, parse the parameters
     int matrix_size = stoi(argv[1]);
     int blocking_factor = stoi(argv[2]);
     int threads_number = stoi(argv[3]);
@@ -190,97 +330,45 @@ int main(int argc, char **argv)
     assert(matrix_size % blocking_factor == 0);
 
     float sparse_factor = stod(argv[5]);
+    int kernel = (argc == 7) ? stoi(argv[6]) : 0;
+    assert(kernel == 0 || kernel == 1);
 
     cout << "=== INPUT ===" << endl;
     cout << "matrix size: " << matrix_size << " blocking factor: " << blocking_factor << " threads number: " << threads_number
-         << " binding: " << binding << " sparse factor: " << sparse_factor << endl << endl;
+         << " binding: " << binding << " sparse factor: " << sparse_factor
+         << " kernel: " << (kernel ? "cache-oblivious" : "tiled") << endl << endl;
 
     cout << "=== CPU_NUM ===" << endl;
     cout << "system cpu number: " << sysconf(_SC_NPROCESSORS_CONF) << endl << endl;
 
     srand(time(NULL)); // matrix elements are random
 
-    pthread_mutex_init(&mutex, NULL);
-
-    int **y_matrix = gen_matrix(matrix_size, sparse_factor);
+    int *y_matrix = gen_matrix(matrix_size, sparse_factor);
     cout << "=== Y_MATRIX ===" << endl;
     print_matrix(y_matrix, matrix_size);
     cout << endl;
 
-    int **z_matrix = gen_matrix(matrix_size, sparse_factor);
+    int *z_matrix = gen_matrix(matrix_size, sparse_factor);
     cout << "=== Z_MATRIX ===" << endl;
     print_matrix(z_matrix, matrix_size);
     cout << endl;
 
-    int **x_matrix = gen_matrix(matrix_size, sparse_factor); // multiplication: X = Y * Z
-
-    for (int i = 0; i < matrix_size; ++i)
-        for (int j = 0; j < matrix_size; ++j)
-            x_matrix[i][j] = 0;
+    int *x_matrix = gen_matrix(matrix_size, sparse_factor); // multiplication: X = Y * Z
 
     // sequential implementation:
 
-    // for (int jj = 0; jj < matrix_size; jj += blocking_factor)  // jj: starting row number in blocks of z_matrix
-    //     for (int kk = 0; kk < matrix_size; kk += blocking_factor)  // kk: starting column number in blocks of z_matrix
-    //         for (int i = 0; i < matrix_size; ++i)  // all rows in x_matrix are affected
-    //             for (int k = kk; k < kk + blocking_factor; k++) {  // update elements in certain columns
-    //                 int r = 0;
-    //                 for (int j = 0; j < blocking_factor; j++)  // number of elements to be added
-    //                     r += y_matrix[i][jj + j] * z_matrix[jj + j][k];
-    //                 x_matrix[i][k] += r;
-    //             }
+    // for (int ii = 0; ii < matrix_size; ii += blocking_factor)  // ii: starting row number in blocks of x_matrix
+    //     for (int jj = 0; jj < matrix_size; jj += blocking_factor)  // jj: starting column number in blocks of x_matrix
+    //         for (int kk = 0; kk < matrix_size; kk += blocking_factor)  // kk: blocks of y_matrix and z_matrix added
+    //             kernel(y_matrix + ii * matrix_size + kk, z_matrix + kk * matrix_size + jj,
+    //                    x_matrix + ii * matrix_size + jj,
+    //                    blocking_factor, blocking_factor, blocking_factor, matrix_size);
 
     // parallel implementation:
 
-    int num_of_blocks = (matrix_size / blocking_factor) * (matrix_size / blocking_factor);
-    int blocks_per_thread = floor(num_of_blocks / threads_number);
-    thread_arg *args = new thread_arg[threads_number]; // thread argument
-
-    // prepare arguments
-    for (int i = 0; i < threads_number; ++i)
-    {
-        args[i].matrix_size = matrix_size;
-        args[i].blocking_factor = blocking_factor;
-        args[i].x_matrix = x_matrix;
-        args[i].y_matrix = y_matrix;
-        args[i].z_matrix = z_matrix;
-
-        if (i != threads_number - 1)
-            args[i].blocks_num = blocks_per_thread;
-        else
-            args[i].blocks_num = num_of_blocks - blocks_per_thread * (threads_number - 1);
-
-        args[i].block_id = new int[args[i].blocks_num];
-        // then, assign block id to thread
-        for (int j = 0; j < args[i].blocks_num; ++j)
-        {
-            args[i].block_id[j] = i * blocks_per_thread + j;
-        }
-
-        // for core binding:
-        args[i].run = thread_routine;
-        string x;
-        stringstream t(x);
-        t << i;
-        strcpy(args[i].tag, ("id-" + x).c_str());
-        if (binding)
-            args[i].core_id = i % (sysconf(_SC_NPROCESSORS_CONF) - 1) + 1;
-        else
-            args[i].core_id = sysconf(_SC_NPROCESSORS_CONF);
-    }
-
-    for (int i = 0; i < threads_number; ++i)
-        pthread_create(&args[i].pid, NULL, wrapper, (void *)&args[i]);
-
-    for (int i = 0; i < threads_number; ++i)
-        pthread_join(args[i].pid, NULL);
-
-    for (int i = 0; i < threads_number; ++i)
-        delete[] args[i].block_id;
-
-    delete[] args;
-
-    pthread_mutex_destroy(&mutex);
+    roi_begin(0); // gem5 statistics of the multiply only
+    multiply(x_matrix, y_matrix, z_matrix, matrix_size, blocking_factor, threads_number, binding, kernel);
+    roi_end(0);
 
     cout << "=== X_MATRIX ===" << endl;
     print_matrix(x_matrix, matrix_size);
@@ -288,9 +376,10 @@ int main(int argc, char **argv)
 
     assert(benchmark(matrix_size, x_matrix, y_matrix, z_matrix));
 
-    destructor(x_matrix, matrix_size);
-    destructor(y_matrix, matrix_size);
-    destructor(z_matrix, matrix_size);
+    destructor(x_matrix);
+    destructor(y_matrix);
+    destructor(z_matrix);
 
     return 0;
 }
+#endif
@@ -0,0 +1,949 @@
+// One benchmark binary over every X = Y * Z kernel of parallel/: the dense
+// kernels of dense.cc, the parallel sparse kernels of sparse_coo.cc,
+// sparse_csr.cc and sparse_csc.cc, and the sequential ai_code/ kernels.
+//
+// The operands come from one generator (or a Matrix Market file) and are
+// converted to the format of every kernel outside the timing. Each kernel runs
+// warmup times, then reps times timed, for every threads number and binding
+// asked for; a sampled row check compares its result with a reference
+// computed from the operands. One CSV row per run configuration goes to
+// stdout, progress and skipped kernels go to stderr.
+//
+// usage: ./harness.out [options]
+//   -k kernels       comma separated, out of dense, dense-co, coo, csr, csc,
+//                    ai-coo, ai-csr, ai-csc (default dense,coo,csr,csc)
+//   -g generator     uniform, powerlaw or banded (default uniform)
+//   -f file          Matrix Market (coordinate) file instead of a generator:
+//                    Y is the matrix, Z is the matrix or, when it is not
+//                    square, its transpose
+//   -n size          rows and columns of the generated matrices (default 1000)
+//   -d density       expected fraction of non-zero elements (default 0.01)
+//   -a alpha         powerlaw: row degree of the r-th row ~ r^-alpha (default 1)
+//   -w width         banded: non-zero elements only where |i - j| <= width
+//                    (default size / 100)
+//   -s seed          random seed of the generator and the check (default 1)
+//   -t threads       comma separated threads numbers to sweep (default 1)
+//   -b binding       comma separated bindings to sweep, 0 or 1 (default 0)
+//   -B block         blocking factor of the dense kernels (default 64)
+//   -W warmup        untimed runs before the timed ones (default 1)
+//   -r reps          timed runs, the median is reported (default 5)
+//   -c rows          rows of X checked, 0 for none (default 64, all if larger
+//                    than the rows)
+//
+// The kernels multiply ints: Matrix Market values are rounded, and those that
+// round to 0 become 1 so that the pattern is kept. products is the number of
+// multiply-adds of the sparse kernels (padded size^3 for dense), gflops is
+// 2 * products / median time.
+//
+// Built with M5OPS (make M5OPS=1), every timed run is a gem5 region of
+// interest (roi.hpp): work item n is the n-th CSV row, and the statistics are
+// reset before and dumped after each run, so that they leave the generator,
+// the conversions, the warmup runs and the check out.
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+// before the kernels, which include it too: one roi_begin and roi_end for all
+#include "roi.hpp"
+
+// every kernel in its own namespace, without its main
+#define HARNESS
+namespace dense {
+#include "dense.cc"
+}
+namespace coo {
+#include "sparse_coo.cc"
+}
+namespace csr {
+#include "sparse_csr.cc"
+}
+namespace csc {
+#include "sparse_csc.cc"
+}
+namespace ai_coo {
+#include "ai_code/coo.hpp"
+}
+namespace ai_csr {
+#include "ai_code/csr.hpp"
+}
+namespace ai_csc {
+#include "ai_code/csc.hpp"
+}
+#undef HARNESS
+
+using namespace std;
+
+// kernels needing more memory (bytes) than this are skipped
+const double MEMORY_LIMIT = 4e9;
+// so are the ai_code kernels needing more operations than this
+const double WORK_LIMIT = 1e10;
+
+// an operand or a result in canonical form: CSR, columns increasing in every row
+struct Matrix
+{
+    int rows = 0, cols = 0;
+    vector<int> ptr;  // first element of every row, ptr[rows] == nnz
+    vector<int> idx;  // column of every element
+    vector<int> val;  // value of every element
+
+    long long nnz() const { return idx.size(); }
+};
+
+struct Triplet
+{
+    int row, col, val;
+};
+
+// canonical form of elements in any order, duplicates are summed
+Matrix from_triplets(int rows, int cols, vector<Triplet> & elements)
+{
+    sort(elements.begin(), elements.end(), [](const Triplet & a, const Triplet & b) {
+        return a.row != b.row ? a.row < b.row : a.col < b.col;
+    });
+    Matrix m;
+    m.rows = rows;
+    m.cols = cols;
+    m.ptr.assign(rows + 1, 0);
+    for (size_t i = 0; i < elements.size(); ++i) {
+        if (i && elements[i].row == elements[i - 1].row && elements[i].col == elements[i - 1].col) {
+            m.val.back() += elements[i].val;
+            continue;
+        }
+        m.ptr[elements[i].row + 1]++;
+        m.idx.push_back(elements[i].col);
+        m.val.push_back(elements[i].val);
+    }
+    for (int i = 0; i < rows; ++i)
+        m.ptr[i + 1] += m.ptr[i];
+    return m;
+}
+
+Matrix transpose(const Matrix & m)
+{
+    Matrix t;
+    t.rows = m.cols;
+    t.cols = m.rows;
+    t.ptr.assign(t.rows + 1, 0);
+    t.idx.resize(m.nnz());
+    t.val.resize(m.nnz());
+    for (long long k = 0; k < m.nnz(); ++k)
+        t.ptr[m.idx[k] + 1]++;
+    for (int i = 0; i < t.rows; ++i)
+        t.ptr[i + 1] += t.ptr[i];
+    vector<int> next(t.ptr.begin(), t.ptr.end() - 1);
+    for (int i = 0; i < m.rows; ++i)  // rows in order: the columns of t stay increasing
+        for (int k = m.ptr[i]; k < m.ptr[i + 1]; ++k) {
+            int l = next[m.idx[k]]++;
+            t.idx[l] = i;
+            t.val[l] = m.val[k];
+        }
+    return t;
+}
+
+// ---- generators ----
+
+typedef mt19937_64 Random;
+
+int gen_value(Random & rng) { return uniform_int_distribution<int>(1, 9)(rng); }
+
+// every element of [first, last) of the row, with probability density: the
+// gap to the next one is drawn instead of every element
+void gen_range(Random & rng, Matrix & m, int first, int last, double density)
+{
+    geometric_distribution<long long> gap(density);
+    for (long long j = first + gap(rng); j < last; j += 1 + gap(rng)) {
+        m.idx.push_back(j);
+        m.val.push_back(gen_value(rng));
+    }
+}
+
+Matrix gen_uniform(Random & rng, int n, double density)
+{
+    Matrix m;
+    m.rows = m.cols = n;
+    m.ptr.push_back(0);
+    for (int i = 0; i < n; ++i) {
+        gen_range(rng, m, 0, n, density);
+        m.ptr.push_back(m.nnz());
+    }
+    return m;
+}
+
+Matrix gen_banded(Random & rng, int n, double density, int width)
+{
+    Matrix m;
+    m.rows = m.cols = n;
+    m.ptr.push_back(0);
+    for (int i = 0; i < n; ++i) {
+        gen_range(rng, m, max(0, i - width), min(n, i + width + 1), density);
+        m.ptr.push_back(m.nnz());
+    }
+    return m;
+}
+
+// row degrees follow a power law (the rows are shuffled, so that the heavy
+// ones are spread), the columns of a row are distinct and uniform
+Matrix gen_powerlaw(Random & rng, int n, double density, double alpha)
+{
+    double sum = 0;
+    for (int r = 0; r < n; ++r)
+        sum += pow(r + 1, -alpha);
+    vector<int> degree(n);
+    for (int r = 0; r < n; ++r)
+        degree[r] = min<double>(n, llround(density * n * n * pow(r + 1, -alpha) / sum));
+    shuffle(degree.begin(), degree.end(), rng);
+
+    Matrix m;
+    m.rows = m.cols = n;
+    m.ptr.push_back(0);
+    vector<int> columns;
+    for (int i = 0; i < n; ++i) {
+        int d = degree[i];
+        columns.clear();
+        if (4 * (long long) d >= n) {  // dense row: selection sampling
+            for (int j = 0, left = d; j < n && left; ++j)
+                if (uniform_int_distribution<int>(0, n - j - 1)(rng) < left) {
+                    columns.push_back(j);
+                    left--;
+                }
+        } else {  // sparse row: draw, drop the repeated ones, draw again
+            uniform_int_distribution<int> column(0, n - 1);
+            while ((int) columns.size() < d) {
+                while ((int) columns.size() < d)
+                    columns.push_back(column(rng));
+                sort(columns.begin(), columns.end());
+                columns.erase(unique(columns.begin(), columns.end()), columns.end());
+            }
+        }
+        for (int j : columns) {
+            m.idx.push_back(j);
+            m.val.push_back(gen_value(rng));
+        }
+        m.ptr.push_back(m.nnz());
+    }
+    return m;
+}
+
+// coordinate Matrix Market: real, integer or pattern; general, symmetric or
+// skew-symmetric
+Matrix read_mm(const char * file)
+{
+    FILE * f = fopen(file, "r");
+    if (!f) {
+        fprintf(stderr, "harness: cannot open %s\n", file);
+        exit(1);
+    }
+    char line[1024], object[64], format[64], field[64], symmetry[64];
+    if (!fgets(line, sizeof(line), f) ||
+        sscanf(line, "%%%%MatrixMarket %63s %63s %63s %63s", object, format, field, symmetry) != 4) {
+        fprintf(stderr, "harness: %s: no MatrixMarket header\n", file);
+        exit(1);
+    }
+    for (char * s : {object, format, field, symmetry})
+        for (; *s; ++s)
+            *s = tolower(*s);
+    bool pattern = !strcmp(field, "pattern");
+    bool symmetric = !strcmp(symmetry, "symmetric");
+    bool skew = !strcmp(symmetry, "skew-symmetric");
+    if (strcmp(object, "matrix") || strcmp(format, "coordinate") ||
+        (!pattern && strcmp(field, "real") && strcmp(field, "integer")) ||
+        (!symmetric && !skew && strcmp(symmetry, "general"))) {
+        fprintf(stderr, "harness: %s: only real, integer or pattern coordinate matrices "
+                "(general, symmetric or skew-symmetric) are supported\n", file);
+        exit(1);
+    }
+
+    do {  // comments
+        if (!fgets(line, sizeof(line), f)) {
+            fprintf(stderr, "harness: %s: no size line\n", file);
+            exit(1);
+        }
+    } while (line[0] == '%');
+    long long rows, cols, entries;
+    if (sscanf(line, "%lld %lld %lld", &rows, &cols, &entries) != 3) {
+        fprintf(stderr, "harness: %s: bad size line\n", file);
+        exit(1);
+    }
+
+    vector<Triplet> elements;
+    elements.reserve((symmetric || skew ? 2 : 1) * entries);
+    for (long long e = 0; e < entries; ++e) {
+        if (!fgets(line, sizeof(line), f)) {
+            fprintf(stderr, "harness: %s: %lld entries instead of %lld\n", file, e, entries);
+            exit(1);
+        }
+        char * end;
+        long long i = strtoll(line, &end, 10);
+        long long j = strtoll(end, &end, 10);
+        double value = pattern ? 1 : strtod(end, &end);
+        if (i < 1 || i > rows || j < 1 || j > cols) {
+            fprintf(stderr, "harness: %s: entry %lld out of the matrix\n", file, e + 1);
+            exit(1);
+        }
+        int v = llround(value);
+        if (!v)
+            v = value < 0 ? -1 : 1;
+        elements.push_back({(int) i - 1, (int) j - 1, v});
+        if ((symmetric || skew) && i != j)
+            elements.push_back({(int) j - 1, (int) i - 1, skew ? -v : v});
+    }
+    fclose(f);
+    return from_triplets(rows, cols, elements);
+}
+
+// ---- correctness: sampled rows of X ----
+
+typedef vector<pair<int, long long>> Row;  // (column, value), columns increasing
+
+struct Sample
+{
+    vector<int> rows;  // the rows checked
+    vector<int> slot;  // slot of every row of X in rows, -1 if not checked
+    vector<Row> got;   // the elements a kernel gave for every row checked
+
+    Sample(int x_rows, int count, Random & rng) : slot(x_rows, -1)
+    {
+        vector<int> all(x_rows);
+        for (int i = 0; i < x_rows; ++i)
+            all[i] = i;
+        if (count < x_rows) {  // the first count of a partial shuffle
+            for (int i = 0; i < count; ++i)
+                swap(all[i], all[uniform_int_distribution<int>(i, x_rows - 1)(rng)]);
+            all.resize(count);
+            sort(all.begin(), all.end());
+        }
+        rows = all;
+        for (size_t s = 0; s < rows.size(); ++s)
+            slot[rows[s]] = s;
+    }
+
+    bool wanted(int row) const { return slot[row] >= 0; }
+
+    void clear() { got.assign(rows.size(), Row()); }
+
+    void add(int row, int col, long long value)
+    {
+        if (slot[row] >= 0)
+            got[slot[row]].emplace_back(col, value);
+    }
+};
+
+// sorted, duplicates summed, zeros dropped: kernels keep or drop cancelled elements alike
+void canonical(Row & row)
+{
+    sort(row.begin(), row.end());
+    Row res;
+    for (auto & e : row)
+        if (!res.empty() && res.back().first == e.first)
+            res.back().second += e.second;
+        else
+            res.push_back(e);
+    res.erase(remove_if(res.begin(), res.end(), [](const pair<int, long long> & e) { return !e.second; }),
+              res.end());
+    row.swap(res);
+}
+
+// the rows of the sample computed from the operands, one at a time
+vector<Row> reference(const Sample & sample, const Matrix & y, const Matrix & z)
+{
+    vector<Row> expected;
+    for (int i : sample.rows) {
+        Row row;
+        for (int k = y.ptr[i]; k < y.ptr[i + 1]; ++k)
+            for (int l = z.ptr[y.idx[k]]; l < z.ptr[y.idx[k] + 1]; ++l)
+                row.emplace_back(z.idx[l], (long long) y.val[k] * z.val[l]);
+        canonical(row);
+        expected.push_back(row);
+    }
+    return expected;
+}
+
+// ---- kernels ----
+
+// a kernel of parallel/ behind one interface: prepare converts the operands
+// (untimed), run computes X (timed), collect gives the sampled rows of X
+struct Kernel
+{
+    string name;
+    bool threaded;  // false: sequential, threads and binding are ignored
+
+    Kernel(const string & n, bool t) : name(n), threaded(t) {}
+    virtual ~Kernel() {}
+
+    // why the kernel is skipped for these operands, empty if it is not
+    virtual string skip(const Matrix & /* y */, const Matrix & /* z */, long long /* products */) { return ""; }
+    virtual void prepare(const Matrix & y, const Matrix & z) = 0;
+    virtual void run(int threads, int binding) = 0;
+    virtual void collect(Sample & sample) = 0;
+    virtual long long nnz() = 0;  // non-zero elements of X
+    virtual long long work(long long products) { return products; }
+};
+
+struct DenseKernel : Kernel
+{
+    int block, kernel;
+    int rows = 0, cols = 0, size = 0;  // X is rows x cols, padded to size x size
+    vector<int> x, y, z;
+
+    DenseKernel(const string & n, int b, int k) : Kernel(n, true), block(b), kernel(k) {}
+
+    int padded(const Matrix & y, const Matrix & z)
+    {
+        int n = max(max(y.rows, y.cols), z.cols);
+        return (n + block - 1) / block * block;
+    }
+
+    string skip(const Matrix & y, const Matrix & z, long long /* products */) override
+    {
+        if (3.0 * sizeof(int) * padded(y, z) * padded(y, z) > MEMORY_LIMIT)
+            return "three dense matrices exceed the memory limit";
+        return "";
+    }
+
+    void prepare(const Matrix & ym, const Matrix & zm) override
+    {
+        rows = ym.rows;
+        cols = zm.cols;
+        size = padded(ym, zm);
+        x.assign((size_t) size * size, 0);
+        y.assign((size_t) size * size, 0);
+        z.assign((size_t) size * size, 0);
+        for (int i = 0; i < ym.rows; ++i)
+            for (int k = ym.ptr[i]; k < ym.ptr[i + 1]; ++k)
+                y[(size_t) i * size + ym.idx[k]] = ym.val[k];
+        for (int i = 0; i < zm.rows; ++i)
+            for (int k = zm.ptr[i]; k < zm.ptr[i + 1]; ++k)
+                z[(size_t) i * size + zm.idx[k]] = zm.val[k];
+    }
+
+    void run(int threads, int binding) override
+    {
+        dense::multiply(x.data(), y.data(), z.data(), size, block, threads, binding, kernel);
+    }
+
+    void collect(Sample & sample) override
+    {
+        for (int i : sample.rows)
+            for (int j = 0; j < cols; ++j)
+                if (x[(size_t) i * size + j])
+                    sample.add(i, j, x[(size_t) i * size + j]);
+    }
+
+    long long nnz() override
+    {
+        long long n = 0;
+        for (int i = 0; i < rows; ++i)
+            for (int j = 0; j < cols; ++j)
+                n += x[(size_t) i * size + j] != 0;
+        return n;
+    }
+
+    long long work(long long) override { return (long long) size * size * size; }
+};
+
+struct CooKernel : Kernel
+{
+    coo::SparseMatrix * x = nullptr, * y = nullptr, * z = nullptr;
+
+    CooKernel() : Kernel("coo", true) {}
+    ~CooKernel() { delete x; delete y; delete z; }
+
+    static coo::SparseMatrix * convert(const Matrix & m)
+    {
+        coo::SparseMatrix * res = new coo::SparseMatrix(m.rows, m.cols, m.nnz());
+        for (int i = 0; i < m.rows; ++i)
+            for (int k = m.ptr[i]; k < m.ptr[i + 1]; ++k) {
+                res->row_indices[k] = i;
+                res->col_indices[k] = m.idx[k];
+                res->values[k] = m.val[k];
+            }
+        return res;
+    }
+
+    void prepare(const Matrix & ym, const Matrix & zm) override
+    {
+        y = convert(ym);
+        z = convert(zm);
+    }
+
+    void run(int threads, int binding) override
+    {
+        delete x;
+        x = new coo::SparseMatrix(y->rows, z->cols, 0);
+        coo::multiply(x, y, z, threads, binding);
+    }
+
+    void collect(Sample & sample) override
+    {
+        for (int k = 0; k < x->nnz; ++k)
+            sample.add(x->row_indices[k], x->col_indices[k], x->values[k]);
+    }
+
+    long long nnz() override { return x->nnz; }
+};
+
+struct CsrKernel : Kernel
+{
+    csr::CsrMatrix * x = nullptr, * y = nullptr, * z = nullptr;
+
+    CsrKernel() : Kernel("csr", true) {}
+    ~CsrKernel() { delete x; delete y; delete z; }
+
+    static csr::CsrMatrix * convert(const Matrix & m)
+    {
+        csr::CsrMatrix * res = new csr::CsrMatrix(m.rows, m.cols, m.nnz());
+        copy(m.ptr.begin(), m.ptr.end(), res->IA);
+        copy(m.idx.begin(), m.idx.end(), res->JA);
+        copy(m.val.begin(), m.val.end(), res->A);
+        return res;
+    }
+
+    void prepare(const Matrix & ym, const Matrix & zm) override
+    {
+        y = convert(ym);
+        z = convert(zm);
+    }
+
+    void run(int threads, int binding) override
+    {
+        delete x;
+        x = new csr::CsrMatrix(y->rows, z->cols, 0);
+        csr::multiply(x, y, z, threads, binding);
+    }
+
+    void collect(Sample & sample) override
+    {
+        for (int i : sample.rows)
+            for (int k = x->IA[i]; k < x->IA[i + 1]; ++k)
+                sample.add(i, x->JA[k], x->A[k]);
+    }
+
+    long long nnz() override { return x->nnz; }
+};
+
+struct CscKernel : Kernel
+{
+    csc::CscMatrix * x = nullptr, * y = nullptr, * z = nullptr;
+
+    CscKernel() : Kernel("csc", true) {}
+    ~CscKernel() { delete x; delete y; delete z; }
+
+    static csc::CscMatrix * convert(const Matrix & m)
+    {
+        Matrix t = transpose(m);  // CSC of m is CSR of its transpose
+        csc::CscMatrix * res = new csc::CscMatrix(m.rows, m.cols, m.nnz());
+        copy(t.ptr.begin(), t.ptr.end(), res->JA);
+        copy(t.idx.begin(), t.idx.end(), res->IA);
+        copy(t.val.begin(), t.val.end(), res->A);
+        return res;
+    }
+
+    void prepare(const Matrix & ym, const Matrix & zm) override
+    {
+        y = convert(ym);
+        z = convert(zm);
+    }
+
+    void run(int threads, int binding) override
+    {
+        delete x;
+        x = new csc::CscMatrix(y->rows, z->cols, 0);
+        csc::multiply(x, y, z, threads, binding);
+    }
+
+    void collect(Sample & sample) override
+    {
+        for (int j = 0; j < x->cols; ++j)
+            for (int k = x->JA[j]; k < x->JA[j + 1]; ++k)
+                sample.add(x->IA[k], j, x->A[k]);
+    }
+
+    long long nnz() override { return x->nnz; }
+};
+
+// ai_code/coo.hpp: every pair of elements, X searched linearly
+struct AiCooKernel : Kernel
+{
+    ai_coo::SparseMatrix x{0, 0, 0}, y{0, 0, 0}, z{0, 0, 0};
+
+    AiCooKernel() : Kernel("ai-coo", false) {}
+
+    string skip(const Matrix & ym, const Matrix & zm, long long products) override
+    {
+        if ((double) ym.nnz() * zm.nnz() + (double) products * products > WORK_LIMIT)
+            return "nnz(Y) * nnz(Z) + products^2 exceeds the work limit";
+        return "";
+    }
+
+    static void convert(const Matrix & m, ai_coo::SparseMatrix & res)
+    {
+        res = ai_coo::SparseMatrix(m.rows, m.cols, m.nnz());
+        for (int i = 0; i < m.rows; ++i)
+            for (int k = m.ptr[i]; k < m.ptr[i + 1]; ++k) {
+                res.row_indices[k] = i;
+                res.col_indices[k] = m.idx[k];
+                res.values[k] = m.val[k];
+            }
+    }
+
+    void prepare(const Matrix & ym, const Matrix & zm) override
+    {
+        convert(ym, y);
+        convert(zm, z);
+    }
+
+    void run(int, int) override { x = ai_coo::multiply(y, z); }
+
+    void collect(Sample & sample) override
+    {
+        for (int k = 0; k < x.nnz; ++k)
+            sample.add(x.row_indices[k], x.col_indices[k], x.values[k]);
+    }
+
+    long long nnz() override { return x.nnz; }
+};
+
+// ai_code/csr.hpp: every element of X, Z given by columns; X is allocated
+// for nnz(Y) * nnz(Z) elements
+struct AiCsrKernel : Kernel
+{
+    ai_csr::csr_matrix x{0, 0, 0, nullptr, nullptr, nullptr};
+    ai_csr::csr_matrix y{0, 0, 0, nullptr, nullptr, nullptr};
+    ai_csr::csr_matrix z{0, 0, 0, nullptr, nullptr, nullptr};
+
+    AiCsrKernel() : Kernel("ai-csr", false) {}
+    ~AiCsrKernel()
+    {
+        for (ai_csr::csr_matrix * m : {&x, &y, &z}) {
+            delete [] m->A;
+            delete [] m->IA;
+            delete [] m->JA;
+        }
+    }
+
+    string skip(const Matrix & ym, const Matrix & zm, long long /* products */) override
+    {
+        double pairs = (double) ym.nnz() * zm.nnz();
+        if (pairs * (sizeof(double) + sizeof(int)) > MEMORY_LIMIT)
+            return "nnz(Y) * nnz(Z) elements exceed the memory limit";
+        if (pairs > WORK_LIMIT)
+            return "nnz(Y) * nnz(Z) exceeds the work limit";
+        return "";
+    }
+
+    // rows of m, or its columns if by_columns (as csr_mult wants its second operand)
+    static void convert(const Matrix & m, ai_csr::csr_matrix & res, bool by_columns)
+    {
+        Matrix t = by_columns ? transpose(m) : m;
+        res = ai_csr::csr_matrix(m.rows, m.cols, m.nnz(), new double [m.nnz()],
+                                 new int [t.rows + 1], new int [m.nnz()]);
+        copy(t.ptr.begin(), t.ptr.end(), res.IA);
+        copy(t.idx.begin(), t.idx.end(), res.JA);
+        copy(t.val.begin(), t.val.end(), res.A);
+    }
+
+    void prepare(const Matrix & ym, const Matrix & zm) override
+    {
+        convert(ym, y, false);
+        convert(zm, z, true);
+    }
+
+    void run(int, int) override
+    {
+        delete [] x.A;
+        delete [] x.IA;
+        delete [] x.JA;
+        ai_csr::csr_mult(y, z, x);
+    }
+
+    void collect(Sample & sample) override
+    {
+        for (int i : sample.rows)
+            for (int k = x.IA[i]; k < x.IA[i + 1]; ++k)
+                sample.add(i, x.JA[k], llround(x.A[k]));
+    }
+
+    long long nnz() override { return x.nnz; }
+};
+
+// ai_code/csc.hpp: square matrices only, X searched linearly in every column;
+// X is allocated for size^2 elements
+struct AiCscKernel : Kernel
+{
+    ai_csc::csc_matrix x{0, 0, nullptr, nullptr, nullptr};
+    ai_csc::csc_matrix y{0, 0, nullptr, nullptr, nullptr};
+    ai_csc::csc_matrix z{0, 0, nullptr, nullptr, nullptr};
+
+    AiCscKernel() : Kernel("ai-csc", false) {}
+    ~AiCscKernel()
+    {
+        for (ai_csc::csc_matrix * m : {&x, &y, &z}) {
+            delete [] m->val;
+            delete [] m->row_ind;
+            delete [] m->col_ptr;
+        }
+    }
+
+    string skip(const Matrix & ym, const Matrix & zm, long long products) override
+    {
+        if (ym.rows != ym.cols || zm.rows != zm.cols || ym.rows != zm.rows)
+            return "square matrices of the same size only";
+        if ((double) ym.rows * ym.rows * (sizeof(double) + sizeof(int)) > MEMORY_LIMIT)
+            return "size^2 elements exceed the memory limit";
+        if ((double) products * (products / ym.rows + 1) > WORK_LIMIT)
+            return "products * products per column exceeds the work limit";
+        return "";
+    }
+
+    static void convert(const Matrix & m, ai_csc::csc_matrix & res)
+    {
+        Matrix t = transpose(m);
+        res.n = m.rows;
+        res.nnz = m.nnz();
+        res.val = new double [m.nnz()];
+        res.row_ind = new int [m.nnz()];
+        res.col_ptr = new int [m.cols + 1];
+        copy(t.ptr.begin(), t.ptr.end(), res.col_ptr);
+        copy(t.idx.begin(), t.idx.end(), res.row_ind);
+        copy(t.val.begin(), t.val.end(), res.val);
+    }
+
+    void prepare(const Matrix & ym, const Matrix & zm) override
+    {
+        convert(ym, y);
+        convert(zm, z);
+    }
+
+    void run(int, int) override
+    {
+        delete [] x.val;
+        delete [] x.row_ind;
+        delete [] x.col_ptr;
+        x = ai_csc::csc_multiply(y, z);
+    }
+
+    void collect(Sample & sample) override
+    {
+        for (int j = 0; j < x.n; ++j)
+            for (int k = x.col_ptr[j]; k < x.col_ptr[j + 1]; ++k)
+                sample.add(x.row_ind[k], j, llround(x.val[k]));
+    }
+
+    long long nnz() override { return x.nnz; }
+};
+
+Kernel * make_kernel(const string & name, int block)
+{
+    if (name == "dense")
+        return new DenseKernel(name, block, 0);
+    if (name == "dense-co")
+        return new DenseKernel(name, block, 1);
+    if (name == "coo")
+        return new CooKernel();
+    if (name == "csr")
+        return new CsrKernel();
+    if (name == "csc")
+        return new CscKernel();
+    if (name == "ai-coo")
+        return new AiCooKernel();
+    if (name == "ai-csr")
+        return new AiCsrKernel();
+    if (name == "ai-csc")
+        return new AiCscKernel();
+    return nullptr;
+}
+
+// ---- command line ----
+
+vector<string> split(const string & s)
+{
+    vector<string> res;
+    stringstream ss(s);
+    string item;
+    while (getline(ss, item, ','))
+        if (!item.empty())
+            res.push_back(item);
+    return res;
+}
+
+vector<int> split_ints(const string & s)
+{
+    vector<int> res;
+    for (const string & item : split(s))
+        res.push_back(atoi(item.c_str()));
+    return res;
+}
+
+void usage(const char * program)
+{
+    fprintf(stderr, "usage: %s [-k kernels] [-g uniform|powerlaw|banded] [-f file.mtx] [-n size] [-d density]\n"
+            "       [-a alpha] [-w width] [-s seed] [-t threads,...] [-b binding,...] [-B block]\n"
+            "       [-W warmup] [-r reps] [-c rows]\n"
+            "kernels: dense, dense-co, coo, csr, csc, ai-coo, ai-csr, ai-csc\n", program);
+    exit(1);
+}
+
+int main(int argc, char ** argv)
+{
+    string kernels = "dense,coo,csr,csc", generator = "uniform", file;
+    int size = 1000, width = -1, block = 64, warmup = 1, reps = 5, check = 64;
+    double density = 0.01, alpha = 1;
+    unsigned long long seed = 1;
+    vector<int> threads = {1}, bindings = {0};
+
+    int opt;
+    while ((opt = getopt(argc, argv, "k:g:f:n:d:a:w:s:t:b:B:W:r:c:h")) != -1) {
+        switch (opt) {
+          case 'k': kernels = optarg; break;
+          case 'g': generator = optarg; break;
+          case 'f': file = optarg; break;
+          case 'n': size = atoi(optarg); break;
+          case 'd': density = atof(optarg); break;
+          case 'a': alpha = atof(optarg); break;
+          case 'w': width = atoi(optarg); break;
+          case 's': seed = strtoull(optarg, nullptr, 10); break;
+          case 't': threads = split_ints(optarg); break;
+          case 'b': bindings = split_ints(optarg); break;
+          case 'B': block = atoi(optarg); break;
+          case 'W': warmup = atoi(optarg); break;
+          case 'r': reps = atoi(optarg); break;
+          case 'c': check = atoi(optarg); break;
+          default: usage(argv[0]);
+        }
+    }
+    if (optind != argc || size < 1 || block < 1 || warmup < 0 || reps < 1 || check < 0 ||
+        threads.empty() || bindings.empty() || !(density > 0 && density < 1))
+        usage(argv[0]);
+    for (int t : threads)
+        if (t < 1)
+            usage(argv[0]);
+    if (width < 0)
+        width = max(1, size / 100);
+
+    vector<Kernel *> runs;
+    for (const string & name : split(kernels)) {
+        Kernel * kernel = make_kernel(name, block);
+        if (!kernel) {
+            fprintf(stderr, "harness: unknown kernel %s\n", name.c_str());
+            usage(argv[0]);
+        }
+        runs.push_back(kernel);
+    }
+
+    dense::verbose = coo::verbose = csr::verbose = csc::verbose = false;
+
+    // the operands
+    Random rng(seed);
+    Matrix y, z;
+    stringstream source;
+    if (!file.empty()) {
+        y = read_mm(file.c_str());
+        z = y.rows == y.cols ? y : transpose(y);
+        source << file.substr(file.find_last_of('/') + 1);
+    } else if (generator == "uniform") {
+        y = gen_uniform(rng, size, density);
+        z = gen_uniform(rng, size, density);
+        source << "uniform:n=" << size << ":d=" << density << ":seed=" << seed;
+    } else if (generator == "powerlaw") {
+        y = gen_powerlaw(rng, size, density, alpha);
+        z = gen_powerlaw(rng, size, density, alpha);
+        source << "powerlaw:n=" << size << ":d=" << density << ":a=" << alpha << ":seed=" << seed;
+    } else if (generator == "banded") {
+        y = gen_banded(rng, size, density, width);
+        z = gen_banded(rng, size, density, width);
+        source << "banded:n=" << size << ":d=" << density << ":w=" << width << ":seed=" << seed;
+    } else {
+        usage(argv[0]);
+    }
+
+    long long products = 0;
+    for (int i = 0; i < y.rows; ++i)
+        for (int k = y.ptr[i]; k < y.ptr[i + 1]; ++k)
+            products += z.ptr[y.idx[k] + 1] - z.ptr[y.idx[k]];
+    fprintf(stderr, "harness: %s: Y %dx%d (%lld), Z %dx%d (%lld), %lld products\n", source.str().c_str(),
+            y.rows, y.cols, y.nnz(), z.rows, z.cols, z.nnz(), products);
+
+    Sample sample(y.rows, min(check, y.rows), rng);
+    vector<Row> expected = reference(sample, y, z);
+
+    printf("kernel,matrix,rows,cols,nnz_y,nnz_z,nnz_x,products,threads,binding,warmup,reps,"
+           "time_min_s,time_median_s,time_max_s,gflops,check\n");
+    fflush(stdout);
+
+    bool failed = false;
+    uint64_t work_id = 0;  // gem5 work item: the CSV row
+    for (Kernel * kernel : runs) {
+        string why = kernel->skip(y, z, products);
+        if (!why.empty()) {
+            fprintf(stderr, "harness: %s skipped: %s\n", kernel->name.c_str(), why.c_str());
+            delete kernel;
+            continue;
+        }
+        kernel->prepare(y, z);
+
+        for (int t : kernel->threaded ? threads : vector<int>{1})
+            for (int b : kernel->threaded ? bindings : vector<int>{0}) {
+                fprintf(stderr, "harness: %s, %d threads, binding %d\n", kernel->name.c_str(), t, b);
+                for (int i = 0; i < warmup; ++i)
+                    kernel->run(t, b);
+                vector<double> times;
+                for (int i = 0; i < reps; ++i) {
+                    roi_begin(work_id);  // under gem5: one stats dump per timed run
+                    auto start = chrono::steady_clock::now();
+                    kernel->run(t, b);
+                    times.push_back(chrono::duration<double>(chrono::steady_clock::now() - start).count());
+                    roi_end(work_id);
+                }
+                work_id++;
+                sort(times.begin(), times.end());
+                double median = reps % 2 ? times[reps / 2] : (times[reps / 2 - 1] + times[reps / 2]) / 2;
+
+                // the result of the last run
+                string status = "off";
+                if (!sample.rows.empty()) {
+                    sample.clear();
+                    kernel->collect(sample);
+                    status = "ok";
+                    for (size_t s = 0; s < sample.rows.size(); ++s) {
+                        canonical(sample.got[s]);
+                        if (sample.got[s] != expected[s]) {
+                            status = "FAIL";
+                            failed = true;
+                            fprintf(stderr, "harness: %s: row %d of X is wrong\n",
+                                    kernel->name.c_str(), sample.rows[s]);
+                            break;
+                        }
+                    }
+                }
+
+                long long work = kernel->work(products);
+                printf("%s,%s,%d,%d,%lld,%lld,%lld,%lld,%d,%d,%d,%d,%.9f,%.9f,%.9f,%.6f,%s\n",
+                       kernel->name.c_str(), source.str().c_str(), y.rows, z.cols, y.nnz(), z.nnz(),
+                       kernel->nnz(), work, t, b, warmup, reps, times.front(), median, times.back(),
+                       2.0 * work / median / 1e9, status.c_str());
+                fflush(stdout);
+            }
+        delete kernel;
+    }
+
+    return failed ? 1 : 0;
+}
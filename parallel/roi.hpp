@@ -0,0 +1,38 @@
+// Region of interest of the kernels, for runs under gem5.
+//
+// Built with -DM5OPS (and linked with libm5.a of util/m5, see the Makefile),
+// roi_begin resets the statistics and begins work item id, roi_end ends it and
+// dumps the statistics: the stats cover the multiply only, and the config can
+// fast-forward the initialization and switch to the detailed CPU at the work
+// item (e.g. se.py --work-begin-exit-count=1). Without M5OPS both do nothing,
+// for runs on hardware, where the m5 ops are illegal instructions.
+#ifndef PARALLEL_ROI_HPP
+#define PARALLEL_ROI_HPP
+
+#include <stdint.h>
+
+#ifdef M5OPS
+#include <gem5/m5ops.h>
+#endif
+
+inline void roi_begin(uint64_t id)
+{
+#ifdef M5OPS
+    m5_reset_stats(0, 0);
+    m5_work_begin(id, 0);
+#else
+    (void) id;
+#endif
+}
+
+inline void roi_end(uint64_t id)
+{
+#ifdef M5OPS
+    m5_work_end(id, 0);
+    m5_dump_stats(0, 0);
+#else
+    (void) id;
+#endif
+}
+
+#endif // PARALLEL_ROI_HPP
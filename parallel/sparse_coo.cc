@@ -5,12 +5,22 @@
 #include <pthread.h>
 #include <unistd.h>
 #include <stdio.h>
+#include <cstdlib>
 #include <cstring>
+#include <cstdint>
 
+#include <algorithm>
 #include <vector>
 
+#include "roi.hpp"
+
 using namespace std;
 
+// matrices up to this size are printed (dense and COO), larger ones are not
+const int PRINT_LIMIT = 32;
+// progress messages of the threads (off in harness.cc)
+bool verbose = true;
+
 // A structure to represent a sparse matrix in COO format
 struct SparseMatrix
 {
@@ -26,6 +36,11 @@ struct SparseMatrix
     {
         rows = r;
         cols = c;
+        resize(n);
+    }
+
+    void resize(int n)
+    {
         nnz = n;
         row_indices.resize(nnz);
         col_indices.resize(nnz);
@@ -35,6 +50,9 @@ struct SparseMatrix
     // A function to print the sparse matrix in COO format
     void print()
     {
+        if (rows > PRINT_LIMIT)
+            return;
+
         cout << "=== COO_SPARSE_MATRIX ===" << endl;
 
         cout << "row_indices: ";
@@ -54,38 +72,85 @@ struct SparseMatrix
     }
 };
 
-SparseMatrix * to_COO(int ** matrix, int matrix_size) {
-    int nnz = 0;
-    for (int i = 0; i < matrix_size; ++i)
-        for (int j = 0; j < matrix_size; ++j)
-            if (matrix[i][j])
-                nnz++;
-    SparseMatrix * res = new SparseMatrix(matrix_size, matrix_size, nnz);  // should be deleted later
-    nnz = 0;
-    for (int i = 0; i < matrix_size; ++i)
-        for (int j = 0; j < matrix_size; ++j)
-            if (matrix[i][j]) {
-                res->row_indices[nnz] = i;
-                res->col_indices[nnz] = j;
-                res->values[nnz] = matrix[i][j];
-                nnz++;
-            }
+// a random matrix straight in COO: every element is 1 with probability
+// sparse_factor, the gap to the next non-zero element is drawn (geometric
+// distribution) instead of every element. The non-zero elements are then
+// shuffled, COO input comes in no particular order
+SparseMatrix * gen_COO(int matrix_size, float sparse_factor)
+{
+    assert(sparse_factor > 0 && sparse_factor < 1);
+    SparseMatrix * res = new SparseMatrix(matrix_size, matrix_size, 0);  // should be deleted later
+    double log_q = log(1.0 - sparse_factor);
+    long long position = -1;
+    long long total = (long long) matrix_size * matrix_size;
+    for (;;) {
+        double u = (rand() + 1.0) / (RAND_MAX + 2.0);  // (0, 1)
+        position += 1 + (long long) floor(log(u) / log_q);
+        if (position >= total)
+            break;
+        res->row_indices.push_back(position / matrix_size);
+        res->col_indices.push_back(position % matrix_size);
+        res->values.push_back(1);
+    }
+    res->nnz = res->values.size();
+    assert(res->nnz);  // assert that at least one non-zero element can be found
+
+    for (int i = res->nnz - 1; i > 0; --i) {
+        int j = ((long long) rand() * RAND_MAX + rand()) % (i + 1);
+        swap(res->row_indices[i], res->row_indices[j]);
+        swap(res->col_indices[i], res->col_indices[j]);
+    }
+
     res->print();  // check
     return res;
 }
 
-void from_COO(int ** matrix, int matrix_size, SparseMatrix * mat_coo) {
+// bucket the non-zero elements by row (a stable counting sort), bucket i is
+// [row_start[i], row_start[i + 1])
+void bucket_rows(SparseMatrix * mat_coo, vector<int> & row_start)
+{
+    row_start.assign(mat_coo->rows + 1, 0);
+    for (int i = 0; i < mat_coo->nnz; ++i)
+        row_start[mat_coo->row_indices[i] + 1]++;
+    for (int i = 0; i < mat_coo->rows; ++i)
+        row_start[i + 1] += row_start[i];
+
+    vector<int> next(row_start.begin(), row_start.end() - 1);
+    SparseMatrix sorted(mat_coo->rows, mat_coo->cols, mat_coo->nnz);
+    for (int i = 0; i < mat_coo->nnz; ++i) {
+        int k = next[mat_coo->row_indices[i]]++;
+        sorted.row_indices[k] = mat_coo->row_indices[i];
+        sorted.col_indices[k] = mat_coo->col_indices[i];
+        sorted.values[k] = mat_coo->values[i];
+    }
+    mat_coo->row_indices.swap(sorted.row_indices);
+    mat_coo->col_indices.swap(sorted.col_indices);
+    mat_coo->values.swap(sorted.values);
+}
+
+void from_COO(int ** matrix, int /* matrix_size */, SparseMatrix * mat_coo) {
     for (int i = 0; i < mat_coo->nnz; ++i)
         matrix[mat_coo->row_indices[i]][mat_coo->col_indices[i]] = mat_coo->values[i];
 }
 
-pthread_mutex_t mutex;
+// synchronizes the accumulation and the merge of the threads
+pthread_barrier_t barrier;
 
 typedef struct _thread_arg {
     SparseMatrix * x_coo;
     SparseMatrix * y_coo;
     SparseMatrix * z_coo;
-    int nnz_num_per_thread, thread_id, last;
+    const vector<int> * y_start;  // row buckets of y_coo
+    const vector<int> * z_start;  // row buckets of z_coo
+    int start, end;  // rows of x_coo the thread owns, [start, end)
+    int thread_id;
+
+    // the thread's non-zero elements of x_coo, sorted, and where they go
+    vector<uint64_t> keys;
+    vector<int> values;
+    int offset;
+    struct _thread_arg * all;  // the arguments of every thread
+    int threads_number;
 
     // for core binding:
     char tag[10];  // thread name(tag)
@@ -95,7 +160,9 @@ typedef struct _thread_arg {
 
     _thread_arg() {
         x_coo = y_coo = z_coo = nullptr;
-        nnz_num_per_thread = thread_id = last = 0;
+        y_start = z_start = nullptr;
+        start = end = thread_id = offset = threads_number = 0;
+        all = nullptr;
 
         // for core binding:
         run = nullptr;
@@ -103,21 +170,94 @@ typedef struct _thread_arg {
     };
 } thread_arg;
 
-int ** gen_matrix(int matrix_size, float sparse_factor)
+// (row, col) packed so that the keys sort in row-major (canonical COO) order
+static inline uint64_t pack(int row, int col) { return (uint64_t) row << 32 | (uint32_t) col; }
+
+// open-addressing hash map of a thread from (row, col) to the value summed so
+// far. It holds one row of x_coo at a time and is sized by the products of
+// that row, so it stays in cache however large the matrices are
+struct HashMap
 {
-    bool flag = false;  // assert that at least one non-zero element can be found
-    int ** matrix = new int * [matrix_size];
-    for (int i = 0; i < matrix_size; ++i)
-        matrix[i] = new int [matrix_size];
-    for (int i = 0; i < matrix_size; ++i)
-        for (int j = 0; j < matrix_size; ++j) {
-            float possibility = rand() % 100 / (float) (100);
-            matrix[i][j] = (possibility < sparse_factor);
-            if (possibility < sparse_factor)
-                flag = true;
+    vector<uint64_t> keys;
+    vector<int> values;
+    vector<int> used;  // slots taken, in no order
+    size_t mask = 0;
+
+    static constexpr uint64_t FREE = ~(uint64_t) 0;
+
+    void reset(long long products)
+    {
+        size_t size = 16;
+        while (size < 2 * (size_t) products)
+            size *= 2;
+        if (keys.size() < size) {
+            keys.assign(size, FREE);
+            values.resize(size);
+        } else {
+            for (int slot : used)
+                keys[slot] = FREE;
         }
-    assert(flag);  // assert that at least one non-zero element can be found
-    return matrix;
+        used.clear();
+        mask = size - 1;
+    }
+
+    void add(uint64_t key, int value)
+    {
+        size_t slot = (key * 0x9e3779b97f4a7c15ull) >> 20 & mask;
+        while (keys[slot] != key && keys[slot] != FREE)
+            slot = (slot + 1) & mask;
+        if (keys[slot] == FREE) {
+            keys[slot] = key;
+            values[slot] = 0;
+            used.push_back(slot);
+        }
+        values[slot] += value;
+    }
+};
+
+// number of products (multiply-adds) of row i of y_coo * z_coo
+long long row_products(SparseMatrix * y_coo, const vector<int> & y_start, const vector<int> & z_start, int i)
+{
+    long long products = 0;
+    for (int k = y_start[i]; k < y_start[i + 1]; ++k)
+        products += z_start[y_coo->col_indices[k] + 1] - z_start[y_coo->col_indices[k]];
+    return products;
+}
+
+// for correctness: every row again, one at a time with a plain dense
+// accumulator, against x_coo, which must be in canonical order
+bool benchmark(SparseMatrix * x_coo, SparseMatrix * y_coo, SparseMatrix * z_coo,
+               const vector<int> & y_start, const vector<int> & z_start)
+{
+    vector<int> row(z_coo->cols, 0);
+    vector<char> set(z_coo->cols, 0);
+    vector<int> columns;
+    int nnz = 0;
+    for (int i = 0; i < y_coo->rows; ++i) {
+        columns.clear();
+        for (int k = y_start[i]; k < y_start[i + 1]; ++k)
+            for (int l = z_start[y_coo->col_indices[k]]; l < z_start[y_coo->col_indices[k] + 1]; ++l) {
+                int col = z_coo->col_indices[l];
+                if (!set[col]) {
+                    set[col] = 1;
+                    columns.push_back(col);
+                }
+                row[col] += y_coo->values[k] * z_coo->values[l];
+            }
+        sort(columns.begin(), columns.end());
+
+        bool same = nnz + (int) columns.size() <= x_coo->nnz;
+        for (size_t c = 0; same && c < columns.size(); ++c, ++nnz)
+            same = x_coo->row_indices[nnz] == i && x_coo->col_indices[nnz] == columns[c] &&
+                   x_coo->values[nnz] == row[columns[c]];
+        for (int col : columns) {
+            row[col] = 0;
+            set[col] = 0;
+        }
+        if (!same)
+            return false;
+    }
+    return nnz == x_coo->nnz;
 }
 
 void destructor(int ** matrix, int matrix_size)
@@ -136,32 +276,17 @@ void print_matrix(int ** matrix, int matrix_size)
     }
 }
 
-// for correctness
-bool benchmark(int matrix_size, int ** x_matrix, int ** y_matrix, int ** z_matrix)
+// print a small COO matrix densely
+void print_coo(SparseMatrix * mat_coo)
 {
-    int ** benchmark_matrix = gen_matrix(matrix_size, 0.5);
-    for (int i = 0; i < matrix_size; ++i)
-        for (int j = 0; j < matrix_size; ++j) {
-            int r = 0;
-            for (int k = 0; k < matrix_size; ++k)
-                r += y_matrix[i][k] * z_matrix[k][j];
-            benchmark_matrix[i][j] = r;
-        }
-
-    cout << "=== BENCHMARK_MATRIX ===" << endl;
-    print_matrix(benchmark_matrix, matrix_size);
-    cout << endl;
-
-    for (int i = 0; i < matrix_size; ++i)
-        for (int j = 0; j < matrix_size; ++j)
-            if (benchmark_matrix[i][j] != x_matrix[i][j]) {
-                destructor(benchmark_matrix, matrix_size);
-                return false;
-            }
-
-    destructor(benchmark_matrix, matrix_size);
-
-    return true;
+    if (mat_coo->rows > PRINT_LIMIT)
+        return;
+    int ** matrix = new int * [mat_coo->rows];
+    for (int i = 0; i < mat_coo->rows; ++i)
+        matrix[i] = new int [mat_coo->cols]();
+    from_COO(matrix, mat_coo->rows, mat_coo);
+    print_matrix(matrix, mat_coo->rows);
+    destructor(matrix, mat_coo->rows);
 }
 
 // wrapper in each thread for core binding
@@ -172,7 +297,8 @@ static void * wrapper(void * args) {
     CPU_ZERO(&cpuset);
     CPU_SET(obj->core_id, &cpuset);
     pthread_setaffinity_np(obj->pid, sizeof(cpu_set_t), &cpuset);
-    cout << obj->tag << " starts running..." << endl;
+    if (verbose)
+        cout << obj->tag << " starts running..." << endl;
     obj->run(args);
     return nullptr;
 }
@@ -182,38 +308,48 @@ static void * thread_routine(void * arg) {
     SparseMatrix * x_coo = argu->x_coo;
     SparseMatrix * y_coo = argu->y_coo;
     SparseMatrix * z_coo = argu->z_coo;
-    int nnz_num_per_thread = argu->nnz_num_per_thread;
-    int thread_id = argu->thread_id;
-    int last = argu->last;
-
-    int start = nnz_num_per_thread * thread_id;
-    int end = (last == 1) ? (y_coo->nnz - 1) : (nnz_num_per_thread * (thread_id + 1) - 1);
-
-    for (int i = start; i <= end; ++i)
-        for (int j = 0; j < z_coo->nnz; ++j)
-            if (y_coo->col_indices[i] == z_coo->row_indices[j]) {
-                int prod = y_coo->values[i] * z_coo->values[j];
-                int row = y_coo->row_indices[i], col = z_coo->col_indices[j];
-
-                pthread_mutex_lock(&mutex);
-
-                bool found = false;
-                for (int k = 0; k < x_coo->nnz; ++k)
-                    if (x_coo->row_indices[k] == row && x_coo->col_indices[k] == col) {
-                        found = true;
-                        x_coo->values[k] += prod;
-                        break;
-                    }
-                
-                if (!found) {
-                    x_coo->nnz++;
-                    x_coo->row_indices.push_back(row);
-                    x_coo->col_indices.push_back(col);
-                    x_coo->values.push_back(prod);
-                }
+    const vector<int> & y_start = * argu->y_start;
+    const vector<int> & z_start = * argu->z_start;
+
+    // accumulate: the thread owns its rows of x_coo, so its hash map never
+    // sees a (row, col) of another thread and nothing is locked
+    HashMap map;
+    vector<int> order;
+    for (int i = argu->start; i < argu->end; ++i) {
+        map.reset(row_products(y_coo, y_start, z_start, i));
+        for (int k = y_start[i]; k < y_start[i + 1]; ++k) {
+            int y_value = y_coo->values[k];
+            int z_row = y_coo->col_indices[k];
+            for (int l = z_start[z_row]; l < z_start[z_row + 1]; ++l)
+                map.add(pack(i, z_coo->col_indices[l]), y_value * z_coo->values[l]);
+        }
 
-                pthread_mutex_unlock(&mutex);
-            }
+        // sort the row, the rows come in order, so the run of the thread is sorted
+        order = map.used;
+        sort(order.begin(), order.end(), [&](int a, int b) { return map.keys[a] < map.keys[b]; });
+        for (int slot : order) {
+            argu->keys.push_back(map.keys[slot]);
+            argu->values.push_back(map.values[slot]);
+        }
+    }
+
+    // merge: the runs of the threads cover increasing rows, so merging them
+    // is placing each one after those of the threads before it
+    if (pthread_barrier_wait(&barrier) == PTHREAD_BARRIER_SERIAL_THREAD) {
+        int nnz = 0;
+        for (int i = 0; i < argu->threads_number; ++i) {
+            argu->all[i].offset = nnz;
+            nnz += argu->all[i].keys.size();
+        }
+        x_coo->resize(nnz);
+    }
+    pthread_barrier_wait(&barrier);
+
+    for (size_t k = 0; k < argu->keys.size(); ++k) {
+        x_coo->row_indices[argu->offset + k] = argu->keys[k] >> 32;
+        x_coo->col_indices[argu->offset + k] = (uint32_t) argu->keys[k];
+        x_coo->values[argu->offset + k] = argu->values[k];
+    }
 
     // to check the correctness of core binding (use top)
     // for (;;)
@@ -222,57 +358,42 @@ static void * thread_routine(void * arg) {
     return nullptr;
 }
 
-int main(int argc, char ** argv)
+// X = Y * Z on threads_number threads, bound to cores if binding; x_coo is
+// replaced, y_coo and z_coo end up bucketed by row. Returns the number of
+// products (multiply-adds)
+long long multiply(SparseMatrix * x_coo, SparseMatrix * y_coo, SparseMatrix * z_coo, int threads_number, int binding)
 {
-    // usage: ./dense.out [matrix size] [blocking factor] [threads number] [binding] [sparse factor]
-    assert(argc == 6);  // then, parse the parameters
-    int matrix_size = stoi(argv[1]);
-    int blocking_factor = stoi(argv[2]);
-    int threads_number = stoi(argv[3]);
-    int binding = stoi(argv[4]);
-    assert(matrix_size % blocking_factor == 0);
-
-    float sparse_factor = stod(argv[5]);
-
-    cout << "=== INPUT ===" << endl;
-    cout << "matrix size: " << matrix_size << " blocking factor: " << blocking_factor << " threads number: " << threads_number
-         << " binding: " << binding << " sparse factor: " << sparse_factor << endl << endl;
-
-    cout << "=== CPU_NUM ===" << endl;
-    cout << "system cpu number: " << sysconf(_SC_NPROCESSORS_CONF) << endl << endl;
-
-    srand(time(nullptr));  // matrix elements are random
-
-    pthread_mutex_init(&mutex, nullptr);
-
-    int ** y_matrix = gen_matrix(matrix_size, sparse_factor);
-    cout << "=== Y_MATRIX ===" << endl;
-    print_matrix(y_matrix, matrix_size);
-    cout << endl;
+    pthread_barrier_init(&barrier, nullptr, threads_number);
 
-    int ** z_matrix = gen_matrix(matrix_size, sparse_factor);
-    cout << "=== Z_MATRIX ===" << endl;
-    print_matrix(z_matrix, matrix_size);
-    cout << endl;
-
-    // switch two-dimensional storage to COO
-    SparseMatrix * y_coo = to_COO(y_matrix, matrix_size);
-    SparseMatrix * z_coo = to_COO(z_matrix, matrix_size);
+    // bucket both by row: a row of y_coo meets the row of z_coo of each of its columns
+    vector<int> y_start, z_start;
+    bucket_rows(y_coo, y_start);
+    bucket_rows(z_coo, z_start);
 
-    SparseMatrix * x_coo = new SparseMatrix(matrix_size, matrix_size, 0);
+    // contiguous rows per thread, with about as many products each
+    long long total_products = 0;
+    for (int i = 0; i < y_coo->rows; ++i)
+        total_products += row_products(y_coo, y_start, z_start, i);
 
-    int nnz_per_thread = floor(y_coo->nnz / threads_number);
     thread_arg * args = new thread_arg [threads_number];  // thread argument
 
     // prepare arguments
+    int row = 0;
+    long long products = 0;
     for (int i = 0; i < threads_number; ++i) {
         args[i].x_coo = x_coo;
         args[i].y_coo = y_coo;
         args[i].z_coo = z_coo;
+        args[i].y_start = &y_start;
+        args[i].z_start = &z_start;
         args[i].thread_id = i;
-        args[i].nnz_num_per_thread = nnz_per_thread;
-        if (i == threads_number - 1)
-            args[i].last = 1;  // marks last thread in the group
+        args[i].all = args;
+        args[i].threads_number = threads_number;
+        args[i].start = row;
+        while (row < y_coo->rows && (i == threads_number - 1 ||
+               products < total_products * (i + 1) / threads_number))
+            products += row_products(y_coo, y_start, z_start, row++);
+        args[i].end = row;
 
         // for core binding:
         args[i].run = thread_routine;
@@ -291,26 +412,61 @@ int main(int argc, char ** argv)
 
     delete [] args;
 
-    pthread_mutex_destroy(&mutex);
+    pthread_barrier_destroy(&barrier);
 
-    // convert back into the original format
-    int ** x_matrix = gen_matrix(matrix_size, 0.5);  // multiplication: X = Y * Z
+    return total_products;
+}
 
-    for (int i = 0; i < matrix_size; ++i)
-        for (int j = 0; j < matrix_size; ++j)
-            x_matrix[i][j] = 0;
+#ifndef HARNESS  // harness.cc has its own main
+int main(int argc, char ** argv)
+{
+    // usage: ./sparse_coo.out [matrix size] [blocking factor] [threads number] [binding] [sparse factor]
+    // (the blocking factor is not used by the COO kernel)
+    assert(argc == 6);  // then, parse the parameters
+    int matrix_size = stoi(argv[1]);
+    int blocking_factor = stoi(argv[2]);
+    int threads_number = stoi(argv[3]);
+    int binding = stoi(argv[4]);
+    assert(matrix_size % blocking_factor == 0);
+
+    float sparse_factor = stod(argv[5]);
+
+    cout << "=== INPUT ===" << endl;
+    cout << "matrix size: " << matrix_size << " blocking factor: " << blocking_factor << " threads number: " << threads_number
+         << " binding: " << binding << " sparse factor: " << sparse_factor << endl << endl;
+
+    cout << "=== CPU_NUM ===" << endl;
+    cout << "system cpu number: " << sysconf(_SC_NPROCESSORS_CONF) << endl << endl;
+
+    srand(time(nullptr));  // matrix elements are random
 
-    from_COO(x_matrix, matrix_size, x_coo);
+    // generate both operands straight in COO
+    SparseMatrix * y_coo = gen_COO(matrix_size, sparse_factor);
+    cout << "=== Y_MATRIX === (" << y_coo->nnz << " non-zero elements)" << endl;
+    print_coo(y_coo);
+    cout << endl;
 
-    cout << "=== X_MATRIX ===" << endl;
-    print_matrix(x_matrix, matrix_size);
+    SparseMatrix * z_coo = gen_COO(matrix_size, sparse_factor);
+    cout << "=== Z_MATRIX === (" << z_coo->nnz << " non-zero elements)" << endl;
+    print_coo(z_coo);
     cout << endl;
 
-    assert(benchmark(matrix_size, x_matrix, y_matrix, z_matrix));
+    SparseMatrix * x_coo = new SparseMatrix(matrix_size, matrix_size, 0);  // multiplication: X = Y * Z
+
+    roi_begin(0);  // gem5 statistics of the multiply only
+    long long total_products = multiply(x_coo, y_coo, z_coo, threads_number, binding);
+    roi_end(0);
+
+    x_coo->print();
+    cout << "=== X_MATRIX === (" << x_coo->nnz << " non-zero elements, " << total_products << " products)" << endl;
+    print_coo(x_coo);
+    cout << endl;
 
-    destructor(x_matrix, matrix_size);
-    destructor(y_matrix, matrix_size);
-    destructor(z_matrix, matrix_size);
+    // the row buckets again, y_coo and z_coo are already sorted by row
+    vector<int> y_start, z_start;
+    bucket_rows(y_coo, y_start);
+    bucket_rows(z_coo, z_start);
+    assert(benchmark(x_coo, y_coo, z_coo, y_start, z_start));
 
     delete x_coo;
     delete y_coo;
@@ -318,3 +474,4 @@ int main(int argc, char ** argv)
 
     return 0;
 }
+#endif
@@ -5,87 +5,136 @@
 #include <pthread.h>
 #include <unistd.h>
 #include <stdio.h>
+#include <cstdlib>
 #include <cstring>
 
+#include <algorithm>
 #include <vector>
 
+#include "roi.hpp"
+
 using namespace std;
 
-// A structure to represent a sparse matrix in COO format
-struct SparseMatrix
+// matrices up to this size are printed (dense and CSC), larger ones are not
+const int PRINT_LIMIT = 32;
+// progress messages of the threads and destructors (off in harness.cc)
+bool verbose = true;
+
+// A structure to represent a sparse matrix in CSC format
+struct CscMatrix
 {
     int rows;                // number of rows
     int cols;                // number of columns
     int nnz;                 // number of non-zero elements
-    vector<int> row_indices; // row indices of non-zero elements
-    vector<int> col_indices; // column indices of non-zero elements
-    vector<int> values;      // values of non-zero elements
 
-    // Constructor to initialize a sparse matrix with given dimensions and nnz
-    SparseMatrix(int r, int c, int n)
+    int * A;                 // values of non-zero elements
+    int * IA;                // row number of non-zero elements, increasing in every column
+    int * JA;                // indices of the first non-zero element in every column, JA[cols] == nnz
+
+    CscMatrix(int r, int c, int n)
+    {
+        rows = r; cols = c; nnz = n;
+        A = new int [nnz];
+        IA = new int [nnz];
+        JA = new int [cols + 1];
+    }
+
+    ~CscMatrix()
+    {
+        if (verbose)
+            std::cout << "=== DELETE_CSC_MATRX ===" << endl;
+        delete [] A;
+        delete [] IA;
+        delete [] JA;
+    }
+
+    // reallocate A and IA for n non-zero elements (their content is lost)
+    void resize(int n)
     {
-        rows = r;
-        cols = c;
+        delete [] A;
+        delete [] IA;
         nnz = n;
-        row_indices.resize(nnz);
-        col_indices.resize(nnz);
-        values.resize(nnz);
+        A = new int [nnz];
+        IA = new int [nnz];
     }
 
-    // A function to print the sparse matrix in COO format
+    // A function to print the sparse matrix in CSC format
     void print()
     {
-        cout << "=== COO_SPARSE_MATRIX ===" << endl;
+        if (cols > PRINT_LIMIT)
+            return;
 
-        cout << "row_indices: ";
-        for (int i = 0; i < nnz; i++)
-            cout << row_indices[i] << " ";
-        cout << endl;
+        std::cout << "=== CSC_SPARSE_MATRIX ===" << endl;
 
-        cout << "col_indices: ";
+        std::cout << "values: ";
         for (int i = 0; i < nnz; i++)
-            cout << col_indices[i] << " ";
-        cout << endl;
+            std::cout << A[i] << " ";
+        std::cout << endl;
 
-        cout << "values: ";
+        std::cout << "row_indices: ";
         for (int i = 0; i < nnz; i++)
-            cout << values[i] << " ";
-        cout << endl << endl;
+            std::cout << IA[i] << " ";
+        std::cout << endl;
+
+        std::cout << "indices of the first non-zero element in every column: " << endl;
+        std::cout << "(which is corresponding to A and IA)" << endl;
+        for (int i = 0; i <= cols; i++)
+            std::cout << JA[i] << " ";
+        std::cout << endl << endl;
     }
 };
 
-SparseMatrix * to_COO(int ** matrix, int matrix_size) {
-    int nnz = 0;
-    for (int i = 0; i < matrix_size; ++i)
-        for (int j = 0; j < matrix_size; ++j)
-            if (matrix[i][j])
-                nnz++;
-    SparseMatrix * res = new SparseMatrix(matrix_size, matrix_size, nnz);  // should be deleted later
-    nnz = 0;
-    for (int i = 0; i < matrix_size; ++i)
-        for (int j = 0; j < matrix_size; ++j)
-            if (matrix[i][j]) {
-                res->row_indices[nnz] = i;
-                res->col_indices[nnz] = j;
-                res->values[nnz] = matrix[i][j];
-                nnz++;
-            }
+// a random matrix straight in CSC: every element is 1 with probability
+// sparse_factor, the gap to the next non-zero element (column by column) is
+// drawn (geometric distribution) instead of every element, so that the time
+// and memory are those of the non-zero elements
+CscMatrix * gen_CSC(int matrix_size, float sparse_factor)
+{
+    assert(sparse_factor > 0 && sparse_factor < 1);
+    vector<int> ia;
+    vector<int> ja(matrix_size + 1, 0);
+    double log_q = log(1.0 - sparse_factor);
+    long long position = -1;
+    long long total = (long long) matrix_size * matrix_size;
+    for (;;) {
+        double u = (rand() + 1.0) / (RAND_MAX + 2.0);  // (0, 1)
+        position += 1 + (long long) floor(log(u) / log_q);
+        if (position >= total)
+            break;
+        ia.push_back(position % matrix_size);
+        ja[position / matrix_size + 1]++;
+    }
+    assert(!ia.empty());  // assert that at least one non-zero element can be found
+
+    CscMatrix * res = new CscMatrix(matrix_size, matrix_size, ia.size());
+    res->JA[0] = 0;  // the first element in JA must be 0
+    for (int j = 0; j < matrix_size; ++j)
+        res->JA[j + 1] = res->JA[j] + ja[j + 1];
+    for (int i = 0; i < res->nnz; ++i) {
+        res->A[i] = 1;
+        res->IA[i] = ia[i];
+    }
+
     res->print();  // check
+
     return res;
 }
 
-void from_COO(int ** matrix, int matrix_size, SparseMatrix * mat_coo) {
-    for (int i = 0; i < mat_coo->nnz; ++i)
-        matrix[mat_coo->row_indices[i]][mat_coo->col_indices[i]] = mat_coo->values[i];
+void from_CSC(int ** matrix, int /* matrix_size */, CscMatrix * mat_csc) {
+    for (int j = 0; j < mat_csc->cols; ++j)
+        for (int nnz = mat_csc->JA[j]; nnz < mat_csc->JA[j + 1]; nnz++)
+            matrix[mat_csc->IA[nnz]][j] = mat_csc->A[nnz];
 }
 
-pthread_mutex_t mutex;
+// synchronizes the symbolic and the numeric pass of the threads
+pthread_barrier_t barrier;
 
 typedef struct _thread_arg {
-    SparseMatrix * x_coo;
-    SparseMatrix * y_coo;
-    SparseMatrix * z_coo;
-    int nnz_num_per_thread, thread_id, last;
+    CscMatrix * x_csc;
+    CscMatrix * y_csc;
+    CscMatrix * z_csc;
+    int start, end;  // columns of x_csc the thread computes, [start, end)
+    int thread_id;
 
     // for core binding:
     char tag[10];  // thread name(tag)
@@ -94,8 +143,8 @@ typedef struct _thread_arg {
     void * (* run)(void * args);  // thread routine(non-binding part)
 
     _thread_arg() {
-        x_coo = y_coo = z_coo = nullptr;
-        nnz_num_per_thread = thread_id = last = 0;
+        x_csc = y_csc = z_csc = nullptr;
+        start = end = thread_id = 0;
 
         // for core binding:
         run = nullptr;
@@ -103,21 +152,140 @@ typedef struct _thread_arg {
     };
 } thread_arg;
 
-int ** gen_matrix(int matrix_size, float sparse_factor)
+// Gustavson accumulator of a thread, by columns: the column of x_csc being
+// computed is the sum of the columns of y_csc picked by the non-zero elements
+// of the column of z_csc. A column with many products relative to the rows is
+// accumulated in a dense array, a column with few in an open-addressing hash
+// table, sized by its number of products, that stays in cache
+struct Accumulator
 {
-    bool flag = false;  // assert that at least one non-zero element can be found
-    int ** matrix = new int * [matrix_size];
-    for (int i = 0; i < matrix_size; ++i)
-        matrix[i] = new int [matrix_size];
-    for (int i = 0; i < matrix_size; ++i)
-        for (int j = 0; j < matrix_size; ++j) {
-            float possibility = rand() % 100 / (float) (100);
-            matrix[i][j] = (possibility < sparse_factor);
-            if (possibility < sparse_factor)
-                flag = true;
+    // dense: value and stamp of the column last stored of every row
+    vector<int> values;
+    vector<int> marks;
+    int stamp = -1;
+    // hash: row (-1 for free) and value of every slot
+    vector<int> keys;
+    vector<int> hash_values;
+    size_t mask = 0;
+    // rows stored for the current column, in no order
+    vector<int> rows;
+
+    Accumulator(int rows) : values(rows, 0), marks(rows, -1) {}
+
+    // a column uses the dense array once its products fill a sixteenth of it
+    bool dense(long long products, int rows) { return products * 16 >= rows; }
+
+    void reset_hash(long long products)
+    {
+        size_t size = 16;
+        while (size < 2 * (size_t) products)
+            size *= 2;
+        if (keys.size() < size) {
+            keys.resize(size);
+            hash_values.resize(size);
         }
-    assert(flag);  // assert that at least one non-zero element can be found
-    return matrix;
+        fill(keys.begin(), keys.begin() + size, -1);
+        mask = size - 1;
+    }
+
+    // start a column, a column accumulated twice (symbolic and numeric pass)
+    // gets two stamps
+    void reset(bool is_dense, long long products)
+    {
+        if (is_dense)
+            stamp++;
+        else
+            reset_hash(products);
+        rows.clear();
+    }
+
+    // add value to row row of the column
+    void add(bool is_dense, int row, int value)
+    {
+        if (is_dense) {
+            if (marks[row] != stamp) {
+                marks[row] = stamp;
+                values[row] = 0;
+                rows.push_back(row);
+            }
+            values[row] += value;
+            return;
+        }
+        size_t slot = ((unsigned) row * 2654435761u) & mask;
+        while (keys[slot] != row && keys[slot] != -1)
+            slot = (slot + 1) & mask;
+        if (keys[slot] == -1) {
+            keys[slot] = row;
+            hash_values[slot] = 0;
+            rows.push_back(row);
+        }
+        hash_values[slot] += value;
+    }
+
+    int get(bool is_dense, int row)
+    {
+        if (is_dense)
+            return values[row];
+        size_t slot = ((unsigned) row * 2654435761u) & mask;
+        while (keys[slot] != row)
+            slot = (slot + 1) & mask;
+        return hash_values[slot];
+    }
+};
+
+// number of products (multiply-adds) of column j of y_csc * z_csc
+long long col_products(CscMatrix * y_csc, CscMatrix * z_csc, int j)
+{
+    long long products = 0;
+    for (int k = z_csc->JA[j]; k < z_csc->JA[j + 1]; ++k)
+        products += y_csc->JA[z_csc->IA[k] + 1] - y_csc->JA[z_csc->IA[k]];
+    return products;
+}
+
+// accumulate column j of x = y * z, the rows stored are left in acc.rows
+void accumulate(Accumulator & acc, CscMatrix * y_csc, CscMatrix * z_csc, int j, bool & is_dense)
+{
+    long long products = col_products(y_csc, z_csc, j);
+    is_dense = acc.dense(products, y_csc->rows);
+    acc.reset(is_dense, products);
+    for (int k = z_csc->JA[j]; k < z_csc->JA[j + 1]; ++k) {
+        int z_value = z_csc->A[k];
+        int y_col = z_csc->IA[k];
+        for (int l = y_csc->JA[y_col]; l < y_csc->JA[y_col + 1]; ++l)
+            acc.add(is_dense, y_csc->IA[l], y_csc->A[l] * z_value);
+    }
+}
+
+// for correctness: every column again, one at a time with a plain dense
+// accumulator, against the columns computed by the threads
+bool benchmark(CscMatrix * x_csc, CscMatrix * y_csc, CscMatrix * z_csc)
+{
+    vector<int> col(y_csc->rows, 0);
+    vector<char> set(y_csc->rows, 0);
+    vector<int> rows;
+    for (int j = 0; j < z_csc->cols; ++j) {
+        rows.clear();
+        for (int k = z_csc->JA[j]; k < z_csc->JA[j + 1]; ++k)
+            for (int l = y_csc->JA[z_csc->IA[k]]; l < y_csc->JA[z_csc->IA[k] + 1]; ++l) {
+                if (!set[y_csc->IA[l]]) {
+                    set[y_csc->IA[l]] = 1;
+                    rows.push_back(y_csc->IA[l]);
+                }
+                col[y_csc->IA[l]] += y_csc->A[l] * z_csc->A[k];
+            }
+        sort(rows.begin(), rows.end());
+
+        bool same = (int) rows.size() == x_csc->JA[j + 1] - x_csc->JA[j];
+        for (size_t r = 0; same && r < rows.size(); ++r)
+            same = x_csc->IA[x_csc->JA[j] + r] == rows[r] && x_csc->A[x_csc->JA[j] + r] == col[rows[r]];
+        for (int row : rows) {
+            col[row] = 0;
+            set[row] = 0;
+        }
+        if (!same)
+            return false;
+    }
+    return true;
 }
 
 void destructor(int ** matrix, int matrix_size)
@@ -131,37 +299,22 @@ void print_matrix(int ** matrix, int matrix_size)
 {
     for (int i = 0; i < matrix_size; ++i) {
         for (int j = 0; j < matrix_size; ++j)
-            cout << matrix[i][j] << " ";
-        cout << endl;
+            std::cout << matrix[i][j] << " ";
+        std::cout << endl;
     }
 }
 
-// for correctness
-bool benchmark(int matrix_size, int ** x_matrix, int ** y_matrix, int ** z_matrix)
+// print a small CSC matrix densely
+void print_csc(CscMatrix * mat_csc)
 {
-    int ** benchmark_matrix = gen_matrix(matrix_size, 0.5);
-    for (int i = 0; i < matrix_size; ++i)
-        for (int j = 0; j < matrix_size; ++j) {
-            int r = 0;
-            for (int k = 0; k < matrix_size; ++k)
-                r += y_matrix[i][k] * z_matrix[k][j];
-            benchmark_matrix[i][j] = r;
-        }
-
-    cout << "=== BENCHMARK_MATRIX ===" << endl;
-    print_matrix(benchmark_matrix, matrix_size);
-    cout << endl;
-
-    for (int i = 0; i < matrix_size; ++i)
-        for (int j = 0; j < matrix_size; ++j)
-            if (benchmark_matrix[i][j] != x_matrix[i][j]) {
-                destructor(benchmark_matrix, matrix_size);
-                return false;
-            }
-
-    destructor(benchmark_matrix, matrix_size);
-
-    return true;
+    if (mat_csc->rows > PRINT_LIMIT)
+        return;
+    int ** matrix = new int * [mat_csc->rows];
+    for (int i = 0; i < mat_csc->rows; ++i)
+        matrix[i] = new int [mat_csc->cols]();
+    from_CSC(matrix, mat_csc->rows, mat_csc);
+    print_matrix(matrix, mat_csc->rows);
+    destructor(matrix, mat_csc->rows);
 }
 
 // wrapper in each thread for core binding
@@ -172,48 +325,50 @@ static void * wrapper(void * args) {
     CPU_ZERO(&cpuset);
     CPU_SET(obj->core_id, &cpuset);
     pthread_setaffinity_np(obj->pid, sizeof(cpu_set_t), &cpuset);
-    cout << obj->tag << " starts running..." << endl;
+    if (verbose)
+        std::cout << obj->tag << " starts running..." << endl;
     obj->run(args);
     return nullptr;
 }
 
 static void * thread_routine(void * arg) {
     thread_arg * argu = (thread_arg *) arg;  // parse the arguments
-    SparseMatrix * x_coo = argu->x_coo;
-    SparseMatrix * y_coo = argu->y_coo;
-    SparseMatrix * z_coo = argu->z_coo;
-    int nnz_num_per_thread = argu->nnz_num_per_thread;
-    int thread_id = argu->thread_id;
-    int last = argu->last;
-
-    int start = nnz_num_per_thread * thread_id;
-    int end = (last == 1) ? (y_coo->nnz - 1) : (nnz_num_per_thread * (thread_id + 1) - 1);
-
-    for (int i = start; i <= end; ++i)
-        for (int j = 0; j < z_coo->nnz; ++j)
-            if (y_coo->col_indices[i] == z_coo->row_indices[j]) {
-                int prod = y_coo->values[i] * z_coo->values[j];
-                int row = y_coo->row_indices[i], col = z_coo->col_indices[j];
-
-                pthread_mutex_lock(&mutex);
-
-                bool found = false;
-                for (int k = 0; k < x_coo->nnz; ++k)
-                    if (x_coo->row_indices[k] == row && x_coo->col_indices[k] == col) {
-                        found = true;
-                        x_coo->values[k] += prod;
-                        break;
-                    }
-                
-                if (!found) {
-                    x_coo->nnz++;
-                    x_coo->row_indices.push_back(row);
-                    x_coo->col_indices.push_back(col);
-                    x_coo->values.push_back(prod);
-                }
+    CscMatrix * x_csc = argu->x_csc;
+    CscMatrix * y_csc = argu->y_csc;
+    CscMatrix * z_csc = argu->z_csc;
+    int start = argu->start;
+    int end = argu->end;
+
+    Accumulator acc(y_csc->rows);
+    bool is_dense;
+
+    // symbolic pass: the number of non-zero elements of every column, kept in
+    // JA[j + 1] until the prefix sum
+    for (int j = start; j < end; ++j) {
+        accumulate(acc, y_csc, z_csc, j, is_dense);
+        x_csc->JA[j + 1] = acc.rows.size();
+    }
 
-                pthread_mutex_unlock(&mutex);
-            }
+    // one thread turns the sizes into offsets and allocates x_csc
+    if (pthread_barrier_wait(&barrier) == PTHREAD_BARRIER_SERIAL_THREAD) {
+        x_csc->JA[0] = 0;
+        for (int j = 0; j < x_csc->cols; ++j)
+            x_csc->JA[j + 1] += x_csc->JA[j];
+        x_csc->resize(x_csc->JA[x_csc->cols]);
+    }
+    pthread_barrier_wait(&barrier);
+
+    // numeric pass: every thread writes its columns, JA[start] to JA[end], no locking
+    for (int j = start; j < end; ++j) {
+        accumulate(acc, y_csc, z_csc, j, is_dense);
+        sort(acc.rows.begin(), acc.rows.end());
+        int nnz = x_csc->JA[j];
+        for (int row : acc.rows) {
+            x_csc->IA[nnz] = row;
+            x_csc->A[nnz] = acc.get(is_dense, row);
+            nnz++;
+        }
+    }
 
     // to check the correctness of core binding (use top)
     // for (;;)
@@ -222,58 +377,32 @@ static void * thread_routine(void * arg) {
     return nullptr;
 }
 
-int main(int argc, char ** argv)
+// X = Y * Z on threads_number threads, bound to cores if binding; x_csc is
+// replaced. Returns the number of products (multiply-adds)
+long long multiply(CscMatrix * x_csc, CscMatrix * y_csc, CscMatrix * z_csc, int threads_number, int binding)
 {
-    // usage: ./dense.out [matrix size] [blocking factor] [threads number] [binding] [sparse factor]
-    assert(argc == 6);  // then, parse the parameters
-    int matrix_size = stoi(argv[1]);
-    int blocking_factor = stoi(argv[2]);
-    int threads_number = stoi(argv[3]);
-    int binding = stoi(argv[4]);
-    assert(matrix_size % blocking_factor == 0);
-
-    // sparse factor input range: 0.01~0.49; if this factor equals 0.50, no sparse effect can be applied
-    float sparse_factor = stod(argv[5]);
-
-    cout << "=== INPUT ===" << endl;
-    cout << "matrix size: " << matrix_size << " blocking factor: " << blocking_factor << " threads number: " << threads_number
-         << " binding: " << binding << " sparse factor: " << sparse_factor << endl << endl;
-
-    cout << "=== CPU_NUM ===" << endl;
-    cout << "system cpu number: " << sysconf(_SC_NPROCESSORS_CONF) << endl << endl;
-
-    srand(time(nullptr));  // matrix elements are random
-
-    pthread_mutex_init(&mutex, nullptr);
-
-    int ** y_matrix = gen_matrix(matrix_size, sparse_factor);
-    cout << "=== Y_MATRIX ===" << endl;
-    print_matrix(y_matrix, matrix_size);
-    cout << endl;
+    pthread_barrier_init(&barrier, nullptr, threads_number);
 
-    int ** z_matrix = gen_matrix(matrix_size, sparse_factor);
-    cout << "=== Z_MATRIX ===" << endl;
-    print_matrix(z_matrix, matrix_size);
-    cout << endl;
-
-    // switch two-dimensional storage to COO
-    SparseMatrix * y_coo = to_COO(y_matrix, matrix_size);
-    SparseMatrix * z_coo = to_COO(z_matrix, matrix_size);
+    // contiguous columns per thread, with about as many products each
+    long long total_products = 0;
+    for (int j = 0; j < z_csc->cols; ++j)
+        total_products += col_products(y_csc, z_csc, j);
 
-    SparseMatrix * x_coo = new SparseMatrix(matrix_size, matrix_size, 0);
-
-    int nnz_per_thread = floor(y_coo->nnz / threads_number);
     thread_arg * args = new thread_arg [threads_number];  // thread argument
 
     // prepare arguments
+    int col = 0;
+    long long products = 0;
     for (int i = 0; i < threads_number; ++i) {
-        args[i].x_coo = x_coo;
-        args[i].y_coo = y_coo;
-        args[i].z_coo = z_coo;
+        args[i].x_csc = x_csc;
+        args[i].y_csc = y_csc;
+        args[i].z_csc = z_csc;
         args[i].thread_id = i;
-        args[i].nnz_num_per_thread = nnz_per_thread;
-        if (i == threads_number - 1)
-            args[i].last = 1;  // marks last thread in the group
+        args[i].start = col;
+        while (col < z_csc->cols && (i == threads_number - 1 ||
+               products < total_products * (i + 1) / threads_number))
+            products += col_products(y_csc, z_csc, col++);
+        args[i].end = col;
 
         // for core binding:
         args[i].run = thread_routine;
@@ -292,30 +421,63 @@ int main(int argc, char ** argv)
 
     delete [] args;
 
-    pthread_mutex_destroy(&mutex);
+    pthread_barrier_destroy(&barrier);
 
-    // convert back into the original format
-    int ** x_matrix = gen_matrix(matrix_size, 0.5);  // multiplication: X = Y * Z
+    return total_products;
+}
 
-    for (int i = 0; i < matrix_size; ++i)
-        for (int j = 0; j < matrix_size; ++j)
-            x_matrix[i][j] = 0;
+#ifndef HARNESS  // harness.cc has its own main
+int main(int argc, char ** argv)
+{
+    // usage: ./sparse_csc.out [matrix size] [blocking factor] [threads number] [binding] [sparse factor]
+    // (the blocking factor is not used by the CSC kernel)
+    assert(argc == 6);  // then, parse the parameters
+    int matrix_size = stoi(argv[1]);
+    int blocking_factor = stoi(argv[2]);
+    int threads_number = stoi(argv[3]);
+    int binding = stoi(argv[4]);
+    assert(matrix_size % blocking_factor == 0);
+
+    // sparse factor input range: 0.01~0.49; if this factor equals 0.50, no sparse effect can be applied
+    float sparse_factor = stod(argv[5]);
+
+    cout << "=== INPUT ===" << endl;
+    cout << "matrix size: " << matrix_size << " blocking factor: " << blocking_factor << " threads number: " << threads_number
+         << " binding: " << binding << " sparse factor: " << sparse_factor << endl << endl;
 
-    from_COO(x_matrix, matrix_size, x_coo);
+    cout << "=== CPU_NUM ===" << endl;
+    cout << "system cpu number: " << sysconf(_SC_NPROCESSORS_CONF) << endl << endl;
 
-    cout << "=== X_MATRIX ===" << endl;
-    print_matrix(x_matrix, matrix_size);
+    srand(time(nullptr));  // matrix elements are random
+
+    // generate both operands straight in CSC
+    CscMatrix * y_csc = gen_CSC(matrix_size, sparse_factor);
+    cout << "=== Y_MATRIX === (" << y_csc->nnz << " non-zero elements)" << endl;
+    print_csc(y_csc);
+    cout << endl;
+
+    CscMatrix * z_csc = gen_CSC(matrix_size, sparse_factor);
+    cout << "=== Z_MATRIX === (" << z_csc->nnz << " non-zero elements)" << endl;
+    print_csc(z_csc);
     cout << endl;
 
-    assert(benchmark(matrix_size, x_matrix, y_matrix, z_matrix));
+    CscMatrix * x_csc = new CscMatrix(matrix_size, matrix_size, 0);  // multiplication: X = Y * Z
+
+    roi_begin(0);  // gem5 statistics of the multiply only
+    long long total_products = multiply(x_csc, y_csc, z_csc, threads_number, binding);
+    roi_end(0);
+
+    x_csc->print();
+    cout << "=== X_MATRIX === (" << x_csc->nnz << " non-zero elements, " << total_products << " products)" << endl;
+    print_csc(x_csc);
+    cout << endl;
 
-    destructor(x_matrix, matrix_size);
-    destructor(y_matrix, matrix_size);
-    destructor(z_matrix, matrix_size);
+    assert(benchmark(x_csc, y_csc, z_csc));
 
-    delete x_coo;
-    delete y_coo;
-    delete z_coo;
+    delete x_csc;
+    delete y_csc;
+    delete z_csc;
 
     return 0;
 }
+#endif
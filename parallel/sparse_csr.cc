@@ -5,13 +5,22 @@
 #include <pthread.h>
 #include <unistd.h>
 #include <stdio.h>
+#include <cstdlib>
 #include <cstring>
 
+#include <algorithm>
 #include <vector>
 
+#include "roi.hpp"
+
 using namespace std;
 
-// A structure to represent a sparse matrix in COO format
+// matrices up to this size are printed (dense and CSR), larger ones are not
+const int PRINT_LIMIT = 32;
+// progress messages of the threads and destructors (off in harness.cc)
+bool verbose = true;
+
+// A structure to represent a sparse matrix in CSR format
 struct CsrMatrix
 {
     int rows;                // number of rows
@@ -19,28 +28,42 @@ struct CsrMatrix
     int nnz;                 // number of non-zero elements
 
     int * A;                 // values of non-zero elements
-    int * IA;                // indices of the first non-zero element in every row
-    int * JA;                // column number of non-zero elements
+    int * IA;                // indices of the first non-zero element in every row, IA[rows] == nnz
+    int * JA;                // column number of non-zero elements, increasing in every row
 
     CsrMatrix(int r, int c, int n)
     {
         rows = r; cols = c; nnz = n;
         A = new int [nnz];
         JA = new int [nnz];
-        IA = new int [rows];
+        IA = new int [rows + 1];
     }
 
     ~CsrMatrix()
     {
-        std::cout << "=== DELETE_CSR_MATRX ===" << endl;
+        if (verbose)
+            std::cout << "=== DELETE_CSR_MATRX ===" << endl;
         delete [] A;
         delete [] IA;
         delete [] JA;
     }
 
+    // reallocate A and JA for n non-zero elements (their content is lost)
+    void resize(int n)
+    {
+        delete [] A;
+        delete [] JA;
+        nnz = n;
+        A = new int [nnz];
+        JA = new int [nnz];
+    }
+
     // A function to print the sparse matrix in CSR format
     void print()
     {
+        if (rows > PRINT_LIMIT)
+            return;
+
         std::cout << "=== CSR_SPARSE_MATRIX ===" << endl;
 
         std::cout << "values: ";
@@ -55,59 +78,63 @@ struct CsrMatrix
 
         std::cout << "indices of the first non-zero element in every row: " << endl;
         std::cout << "(which is corresponding to A and JA)" << endl;
-        for (int i = 0; i < rows; i++)
+        for (int i = 0; i <= rows; i++)
             std::cout << IA[i] << " ";
         std::cout << endl << endl;
     }
 };
 
-CsrMatrix * to_CSR(int ** matrix, int matrix_size) {
-    int nnz = 0;
-    for (int i = 0; i < matrix_size; ++i)
-        for (int j = 0; j < matrix_size; ++j)
-            if (matrix[i][j])
-                nnz++;
-
-    CsrMatrix * res = new CsrMatrix(matrix_size, matrix_size, nnz);
+// a random matrix straight in CSR: every element is 1 with probability
+// sparse_factor, the gap to the next non-zero element is drawn (geometric
+// distribution) instead of every element, so that the time and memory are
+// those of the non-zero elements
+CsrMatrix * gen_CSR(int matrix_size, float sparse_factor)
+{
+    assert(sparse_factor > 0 && sparse_factor < 1);
+    vector<int> ja;
+    vector<int> ia(matrix_size + 1, 0);
+    double log_q = log(1.0 - sparse_factor);
+    long long position = -1;
+    long long total = (long long) matrix_size * matrix_size;
+    for (;;) {
+        double u = (rand() + 1.0) / (RAND_MAX + 2.0);  // (0, 1)
+        position += 1 + (long long) floor(log(u) / log_q);
+        if (position >= total)
+            break;
+        ja.push_back(position % matrix_size);
+        ia[position / matrix_size + 1]++;
+    }
+    assert(!ja.empty());  // assert that at least one non-zero element can be found
 
+    CsrMatrix * res = new CsrMatrix(matrix_size, matrix_size, ja.size());
     res->IA[0] = 0;  // the first element in IA must be 0
-
-    nnz = 0;
     for (int i = 0; i < matrix_size; ++i)
-        for (int j = 0; j < matrix_size; ++j) {
-            if (matrix[i][j]) {
-                res->A[nnz] = matrix[i][j];
-                res->JA[nnz] = j;
-                nnz++;
-            }
-            // update values: indices of the first non-zero element in every row
-            if ((j == matrix_size - 1) && (i != matrix_size - 1))
-                res->IA[i + 1] = nnz;
-        }
+        res->IA[i + 1] = res->IA[i] + ia[i + 1];
+    for (int i = 0; i < res->nnz; ++i) {
+        res->A[i] = 1;
+        res->JA[i] = ja[i];
+    }
 
     res->print();  // check
-    
+
     return res;
 }
 
-void from_CSR(int ** matrix, int matrix_size, CsrMatrix * mat_csr) {
-    int nnz = 0;
+void from_CSR(int ** matrix, int /* matrix_size */, CsrMatrix * mat_csr) {
     for (int i = 0; i < mat_csr->rows; ++i)
-        if (i != mat_csr->rows - 1)
-            for ( ; nnz < mat_csr->IA[i + 1]; nnz++)
-                matrix[i][mat_csr->JA[nnz]] = mat_csr->A[nnz];
-        else
-            for ( ; nnz < mat_csr->nnz; nnz++)
-                matrix[i][mat_csr->JA[nnz]] = mat_csr->A[nnz];
+        for (int nnz = mat_csr->IA[i]; nnz < mat_csr->IA[i + 1]; nnz++)
+            matrix[i][mat_csr->JA[nnz]] = mat_csr->A[nnz];
 }
 
-pthread_mutex_t mutex;
+// synchronizes the symbolic and the numeric pass of the threads
+pthread_barrier_t barrier;
 
 typedef struct _thread_arg {
     CsrMatrix * x_csr;
     CsrMatrix * y_csr;
     CsrMatrix * z_csr;
-    int rows_per_thread, thread_id, last;
+    int start, end;  // rows of x_csr the thread computes, [start, end)
+    int thread_id;
 
     // for core binding:
     char tag[10];  // thread name(tag)
@@ -117,7 +144,7 @@ typedef struct _thread_arg {
 
     _thread_arg() {
         x_csr = y_csr = z_csr = nullptr;
-        rows_per_thread = thread_id = last = 0;
+        start = end = thread_id = 0;
 
         // for core binding:
         run = nullptr;
@@ -125,21 +152,140 @@ typedef struct _thread_arg {
     };
 } thread_arg;
 
-int ** gen_matrix(int matrix_size, float sparse_factor)
+// Gustavson accumulator of a thread: the row of x_csr being computed is the
+// sum of the rows of z_csr picked by the non-zero elements of the row of
+// y_csr. A row with many products relative to the columns is accumulated in a
+// dense array, a row with few in an open-addressing hash table, sized by its
+// number of products, that stays in cache
+struct Accumulator
 {
-    bool flag = false;  // assert that at least one non-zero element can be found
-    int ** matrix = new int * [matrix_size];
-    for (int i = 0; i < matrix_size; ++i)
-        matrix[i] = new int [matrix_size];
-    for (int i = 0; i < matrix_size; ++i)
-        for (int j = 0; j < matrix_size; ++j) {
-            float possibility = rand() % 100 / (float) (100);
-            matrix[i][j] = (possibility < sparse_factor);
-            if (possibility < sparse_factor)
-                flag = true;
+    // dense: value and stamp of the row last stored of every column
+    vector<int> values;
+    vector<int> marks;
+    int stamp = -1;
+    // hash: column (-1 for free) and value of every slot
+    vector<int> keys;
+    vector<int> hash_values;
+    size_t mask = 0;
+    // columns stored for the current row, in no order
+    vector<int> columns;
+
+    Accumulator(int cols) : values(cols, 0), marks(cols, -1) {}
+
+    // a row uses the dense array once its products fill a sixteenth of it
+    bool dense(long long products, int cols) { return products * 16 >= cols; }
+
+    void reset_hash(long long products)
+    {
+        size_t size = 16;
+        while (size < 2 * (size_t) products)
+            size *= 2;
+        if (keys.size() < size) {
+            keys.resize(size);
+            hash_values.resize(size);
         }
-    assert(flag);  // assert that at least one non-zero element can be found
-    return matrix;
+        fill(keys.begin(), keys.begin() + size, -1);
+        mask = size - 1;
+    }
+
+    // start a row, a row accumulated twice (symbolic and numeric pass) gets
+    // two stamps
+    void reset(bool is_dense, long long products)
+    {
+        if (is_dense)
+            stamp++;
+        else
+            reset_hash(products);
+        columns.clear();
+    }
+
+    // add value to column col of the row
+    void add(bool is_dense, int col, int value)
+    {
+        if (is_dense) {
+            if (marks[col] != stamp) {
+                marks[col] = stamp;
+                values[col] = 0;
+                columns.push_back(col);
+            }
+            values[col] += value;
+            return;
+        }
+        size_t slot = ((unsigned) col * 2654435761u) & mask;
+        while (keys[slot] != col && keys[slot] != -1)
+            slot = (slot + 1) & mask;
+        if (keys[slot] == -1) {
+            keys[slot] = col;
+            hash_values[slot] = 0;
+            columns.push_back(col);
+        }
+        hash_values[slot] += value;
+    }
+
+    int get(bool is_dense, int col)
+    {
+        if (is_dense)
+            return values[col];
+        size_t slot = ((unsigned) col * 2654435761u) & mask;
+        while (keys[slot] != col)
+            slot = (slot + 1) & mask;
+        return hash_values[slot];
+    }
+};
+
+// number of products (multiply-adds) of row i of y_csr * z_csr
+long long row_products(CsrMatrix * y_csr, CsrMatrix * z_csr, int i)
+{
+    long long products = 0;
+    for (int k = y_csr->IA[i]; k < y_csr->IA[i + 1]; ++k)
+        products += z_csr->IA[y_csr->JA[k] + 1] - z_csr->IA[y_csr->JA[k]];
+    return products;
+}
+
+// accumulate row i of x = y * z, the columns stored are left in acc.columns
+void accumulate(Accumulator & acc, CsrMatrix * y_csr, CsrMatrix * z_csr, int i, bool & is_dense)
+{
+    long long products = row_products(y_csr, z_csr, i);
+    is_dense = acc.dense(products, z_csr->cols);
+    acc.reset(is_dense, products);
+    for (int k = y_csr->IA[i]; k < y_csr->IA[i + 1]; ++k) {
+        int y_value = y_csr->A[k];
+        int z_row = y_csr->JA[k];
+        for (int l = z_csr->IA[z_row]; l < z_csr->IA[z_row + 1]; ++l)
+            acc.add(is_dense, z_csr->JA[l], y_value * z_csr->A[l]);
+    }
+}
+
+// for correctness: every row again, one at a time with a plain dense
+// accumulator, against the rows computed by the threads
+bool benchmark(CsrMatrix * x_csr, CsrMatrix * y_csr, CsrMatrix * z_csr)
+{
+    vector<int> row(z_csr->cols, 0);
+    vector<char> set(z_csr->cols, 0);
+    vector<int> columns;
+    for (int i = 0; i < y_csr->rows; ++i) {
+        columns.clear();
+        for (int k = y_csr->IA[i]; k < y_csr->IA[i + 1]; ++k)
+            for (int l = z_csr->IA[y_csr->JA[k]]; l < z_csr->IA[y_csr->JA[k] + 1]; ++l) {
+                if (!set[z_csr->JA[l]]) {
+                    set[z_csr->JA[l]] = 1;
+                    columns.push_back(z_csr->JA[l]);
+                }
+                row[z_csr->JA[l]] += y_csr->A[k] * z_csr->A[l];
+            }
+        sort(columns.begin(), columns.end());
+
+        bool same = (int) columns.size() == x_csr->IA[i + 1] - x_csr->IA[i];
+        for (size_t c = 0; same && c < columns.size(); ++c)
+            same = x_csr->JA[x_csr->IA[i] + c] == columns[c] && x_csr->A[x_csr->IA[i] + c] == row[columns[c]];
+        for (int col : columns) {
+            row[col] = 0;
+            set[col] = 0;
+        }
+        if (!same)
+            return false;
+    }
+    return true;
 }
 
 void destructor(int ** matrix, int matrix_size)
@@ -158,32 +304,17 @@ void print_matrix(int ** matrix, int matrix_size)
     }
 }
 
-// for correctness
-bool benchmark(int matrix_size, int ** x_matrix, int ** y_matrix, int ** z_matrix)
+// print a small CSR matrix densely
+void print_csr(CsrMatrix * mat_csr)
 {
-    int ** benchmark_matrix = gen_matrix(matrix_size, 0.5);
-    for (int i = 0; i < matrix_size; ++i)
-        for (int j = 0; j < matrix_size; ++j) {
-            int r = 0;
-            for (int k = 0; k < matrix_size; ++k)
-                r += y_matrix[i][k] * z_matrix[k][j];
-            benchmark_matrix[i][j] = r;
-        }
-
-    std::cout << "=== BENCHMARK_MATRIX ===" << endl;
-    print_matrix(benchmark_matrix, matrix_size);
-    std::cout << endl;
-
-    for (int i = 0; i < matrix_size; ++i)
-        for (int j = 0; j < matrix_size; ++j)
-            if (benchmark_matrix[i][j] != x_matrix[i][j]) {
-                destructor(benchmark_matrix, matrix_size);
-                return false;
-            }
-
-    destructor(benchmark_matrix, matrix_size);
-
-    return true;
+    if (mat_csr->rows > PRINT_LIMIT)
+        return;
+    int ** matrix = new int * [mat_csr->rows];
+    for (int i = 0; i < mat_csr->rows; ++i)
+        matrix[i] = new int [mat_csr->cols]();
+    from_CSR(matrix, mat_csr->rows, mat_csr);
+    print_matrix(matrix, mat_csr->rows);
+    destructor(matrix, mat_csr->rows);
 }
 
 // wrapper in each thread for core binding
@@ -194,7 +325,8 @@ static void * wrapper(void * args) {
     CPU_ZERO(&cpuset);
     CPU_SET(obj->core_id, &cpuset);
     pthread_setaffinity_np(obj->pid, sizeof(cpu_set_t), &cpuset);
-    std::cout << obj->tag << " starts running..." << endl;
+    if (verbose)
+        std::cout << obj->tag << " starts running..." << endl;
     obj->run(args);
     return nullptr;
 }
@@ -204,25 +336,37 @@ static void * thread_routine(void * arg) {
     CsrMatrix * x_csr = argu->x_csr;
     CsrMatrix * y_csr = argu->y_csr;
     CsrMatrix * z_csr = argu->z_csr;
-    int rows_per_thread = argu->rows_per_thread;
-    int thread_id = argu->thread_id;
-    int last = argu->last;
+    int start = argu->start;
+    int end = argu->end;
 
-    int start = rows_per_thread * thread_id;
-    int end = (last == 1) ? (y_csr->rows - 1) : (rows_per_thread * (thread_id + 1) - 1);
+    Accumulator acc(z_csr->cols);
+    bool is_dense;
 
-    x_csr->rows = x_csr->cols = y_csr->rows;
-    x_csr->nnz = 0;
-
-    // x_csr(before invocation of thread_routine):
-    // int * tmp_a = new int [y_csr->nnz * z_csr->nnz];
-    // int * tmp_ia = new int [y_csr->rows + 1];
-    // int * tmp_ja = new int [y_csr->nnz * z_csr->nnz];
+    // symbolic pass: the number of non-zero elements of every row, kept in
+    // IA[i + 1] until the prefix sum
+    for (int i = start; i < end; ++i) {
+        accumulate(acc, y_csr, z_csr, i, is_dense);
+        x_csr->IA[i + 1] = acc.columns.size();
+    }
 
-    for (int i = start; i <= end; ++i) {
-        x_csr->IA[i] = x_csr->nnz;
-        for (int j = 0; j < z_csr->cols; ++j) {
-            
+    // one thread turns the sizes into offsets and allocates x_csr
+    if (pthread_barrier_wait(&barrier) == PTHREAD_BARRIER_SERIAL_THREAD) {
+        x_csr->IA[0] = 0;
+        for (int i = 0; i < x_csr->rows; ++i)
+            x_csr->IA[i + 1] += x_csr->IA[i];
+        x_csr->resize(x_csr->IA[x_csr->rows]);
+    }
+    pthread_barrier_wait(&barrier);
+
+    // numeric pass: every thread writes its rows, IA[start] to IA[end], no locking
+    for (int i = start; i < end; ++i) {
+        accumulate(acc, y_csr, z_csr, i, is_dense);
+        sort(acc.columns.begin(), acc.columns.end());
+        int nnz = x_csr->IA[i];
+        for (int col : acc.columns) {
+            x_csr->JA[nnz] = col;
+            x_csr->A[nnz] = acc.get(is_dense, col);
+            nnz++;
         }
     }
 
@@ -233,58 +377,32 @@ static void * thread_routine(void * arg) {
     return nullptr;
 }
 
-int main(int argc, char ** argv)
+// X = Y * Z on threads_number threads, bound to cores if binding; x_csr is
+// replaced. Returns the number of products (multiply-adds)
+long long multiply(CsrMatrix * x_csr, CsrMatrix * y_csr, CsrMatrix * z_csr, int threads_number, int binding)
 {
-    // usage: ./dense.out [matrix size] [blocking factor] [threads number] [binding] [sparse factor]
-    assert(argc == 6);  // then, parse the parameters
-    int matrix_size = stoi(argv[1]);
-    int blocking_factor = stoi(argv[2]);
-    int threads_number = stoi(argv[3]);
-    int binding = stoi(argv[4]);
-    assert(matrix_size % blocking_factor == 0);
-
-    // sparse factor input range: 0.01~0.49; if this factor equals 0.50, no sparse effect can be applied
-    float sparse_factor = stod(argv[5]);
-
-    cout << "=== INPUT ===" << endl;
-    cout << "matrix size: " << matrix_size << " blocking factor: " << blocking_factor << " threads number: " << threads_number
-         << " binding: " << binding << " sparse factor: " << sparse_factor << endl << endl;
+    pthread_barrier_init(&barrier, nullptr, threads_number);
 
-    cout << "=== CPU_NUM ===" << endl;
-    cout << "system cpu number: " << sysconf(_SC_NPROCESSORS_CONF) << endl << endl;
-
-    srand(time(nullptr));  // matrix elements are random
-
-    pthread_mutex_init(&mutex, nullptr);
-
-    int ** y_matrix = gen_matrix(matrix_size, sparse_factor);
-    cout << "=== Y_MATRIX ===" << endl;
-    print_matrix(y_matrix, matrix_size);
-    cout << endl;
-
-    int ** z_matrix = gen_matrix(matrix_size, sparse_factor);
-    cout << "=== Z_MATRIX ===" << endl;
-    print_matrix(z_matrix, matrix_size);
-    cout << endl;
+    // contiguous rows per thread, with about as many products each
+    long long total_products = 0;
+    for (int i = 0; i < y_csr->rows; ++i)
+        total_products += row_products(y_csr, z_csr, i);
 
-    // switch two-dimensional storage to COO
-    SparseMatrix * y_coo = to_COO(y_matrix, matrix_size);
-    SparseMatrix * z_coo = to_COO(z_matrix, matrix_size);
-
-    SparseMatrix * x_coo = new SparseMatrix(matrix_size, matrix_size, 0);
-
-    int nnz_per_thread = floor(y_coo->nnz / threads_number);
     thread_arg * args = new thread_arg [threads_number];  // thread argument
 
     // prepare arguments
+    int row = 0;
+    long long products = 0;
     for (int i = 0; i < threads_number; ++i) {
-        args[i].x_coo = x_coo;
-        args[i].y_coo = y_coo;
-        args[i].z_coo = z_coo;
+        args[i].x_csr = x_csr;
+        args[i].y_csr = y_csr;
+        args[i].z_csr = z_csr;
         args[i].thread_id = i;
-        args[i].nnz_num_per_thread = nnz_per_thread;
-        if (i == threads_number - 1)
-            args[i].last = 1;  // marks last thread in the group
+        args[i].start = row;
+        while (row < y_csr->rows && (i == threads_number - 1 ||
+               products < total_products * (i + 1) / threads_number))
+            products += row_products(y_csr, z_csr, row++);
+        args[i].end = row;
 
         // for core binding:
         args[i].run = thread_routine;
@@ -303,30 +421,63 @@ int main(int argc, char ** argv)
 
     delete [] args;
 
-    pthread_mutex_destroy(&mutex);
+    pthread_barrier_destroy(&barrier);
 
-    // convert back into the original format
-    int ** x_matrix = gen_matrix(matrix_size, 0.5);  // multiplication: X = Y * Z
+    return total_products;
+}
 
-    for (int i = 0; i < matrix_size; ++i)
-        for (int j = 0; j < matrix_size; ++j)
-            x_matrix[i][j] = 0;
+#ifndef HARNESS  // harness.cc has its own main
+int main(int argc, char ** argv)
+{
+    // usage: ./sparse_csr.out [matrix size] [blocking factor] [threads number] [binding] [sparse factor]
+    // (the blocking factor is not used by the CSR kernel)
+    assert(argc == 6);  // then, parse the parameters
+    int matrix_size = stoi(argv[1]);
+    int blocking_factor = stoi(argv[2]);
+    int threads_number = stoi(argv[3]);
+    int binding = stoi(argv[4]);
+    assert(matrix_size % blocking_factor == 0);
 
-    from_COO(x_matrix, matrix_size, x_coo);
+    // sparse factor input range: 0.01~0.49; if this factor equals 0.50, no sparse effect can be applied
+    float sparse_factor = stod(argv[5]);
 
-    cout << "=== X_MATRIX ===" << endl;
-    print_matrix(x_matrix, matrix_size);
+    cout << "=== INPUT ===" << endl;
+    cout << "matrix size: " << matrix_size << " blocking factor: " << blocking_factor << " threads number: " << threads_number
+         << " binding: " << binding << " sparse factor: " << sparse_factor << endl << endl;
+
+    cout << "=== CPU_NUM ===" << endl;
+    cout << "system cpu number: " << sysconf(_SC_NPROCESSORS_CONF) << endl << endl;
+
+    srand(time(nullptr));  // matrix elements are random
+
+    // generate both operands straight in CSR
+    CsrMatrix * y_csr = gen_CSR(matrix_size, sparse_factor);
+    cout << "=== Y_MATRIX === (" << y_csr->nnz << " non-zero elements)" << endl;
+    print_csr(y_csr);
+    cout << endl;
+
+    CsrMatrix * z_csr = gen_CSR(matrix_size, sparse_factor);
+    cout << "=== Z_MATRIX === (" << z_csr->nnz << " non-zero elements)" << endl;
+    print_csr(z_csr);
     cout << endl;
 
-    assert(benchmark(matrix_size, x_matrix, y_matrix, z_matrix));
+    CsrMatrix * x_csr = new CsrMatrix(matrix_size, matrix_size, 0);  // multiplication: X = Y * Z
+
+    roi_begin(0);  // gem5 statistics of the multiply only
+    long long total_products = multiply(x_csr, y_csr, z_csr, threads_number, binding);
+    roi_end(0);
+
+    x_csr->print();
+    cout << "=== X_MATRIX === (" << x_csr->nnz << " non-zero elements, " << total_products << " products)" << endl;
+    print_csr(x_csr);
+    cout << endl;
 
-    destructor(x_matrix, matrix_size);
-    destructor(y_matrix, matrix_size);
-    destructor(z_matrix, matrix_size);
+    assert(benchmark(x_csr, y_csr, z_csr));
 
-    delete x_coo;
-    delete y_coo;
-    delete z_coo;
+    delete x_csr;
+    delete y_csr;
+    delete z_csr;
 
     return 0;
 }
+#endif
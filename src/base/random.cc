@@ -98,4 +98,28 @@ Random::unserialize(CheckpointIn &cp)
 
 Random random_mt;
 
+namespace
+{
+
+uint32_t baseSeed = 5489;
+
+} // anonymous namespace
+
+void
+seedRandom(uint32_t seed)
+{
+    baseSeed = seed;
+    random_mt.init(seed);
+}
+
+uint32_t
+objectSeed(const std::string &name)
+{
+    // FNV-1a, which unlike std::hash gives the same seeds on every host
+    uint32_t seed = 2166136261u ^ baseSeed;
+    for (unsigned char c : name)
+        seed = (seed ^ c) * 16777619u;
+    return seed;
+}
+
 } // namespace gem5
@@ -125,6 +125,22 @@ class Random : public Serializable
  */
 extern Random random_mt;
 
+/**
+ * Seed random_mt, and the generators of the objects created afterwards
+ * (see objectSeed()).
+ */
+void seedRandom(uint32_t seed);
+
+/**
+ * The seed of the generator of an object of the given name, from the
+ * name and the seed last given to seedRandom(). The objects of a
+ * parallel simulation which draw random numbers use generators of their
+ * own, seeded so, rather than random_mt: their draws then depend neither
+ * on the other objects nor on the event queue or host thread simulating
+ * them.
+ */
+uint32_t objectSeed(const std::string &name);
+
 } // namespace gem5
 
 #endif // __BASE_RANDOM_HH__
@@ -50,6 +50,7 @@ namespace gem5
 MinorCPU::MinorCPU(const MinorCPUParams &params) :
     BaseCPU(params),
     threadPolicy(params.threadPolicy),
+    rng(objectSeed(name())),
     stats(this)
 {
     /* This is only written for one thread at the moment */
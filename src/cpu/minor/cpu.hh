@@ -118,6 +118,10 @@ class MinorCPU : public BaseCPU
 
     /** Thread Scheduling Policy (RoundRobin, Random, etc) */
     enums::ThreadPolicy threadPolicy;
+
+    /** Generator of the Random thread policy, of its own (see
+     *  objectSeed()) */
+    Random rng;
   protected:
      /** Return a reference to the data port. */
     Port &getDataPort() override;
@@ -187,7 +191,7 @@ class MinorCPU : public BaseCPU
         }
 
         std::shuffle(prio_list.begin(), prio_list.end(),
-                     random_mt.gen);
+                     rng.gen);
 
         return prio_list;
     }
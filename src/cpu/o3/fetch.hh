@@ -43,6 +43,7 @@
 
 #include "arch/generic/decoder.hh"
 #include "arch/generic/mmu.hh"
+#include "base/random.hh"
 #include "base/statistics.hh"
 #include "config/the_isa.hh"
 #include "cpu/o3/comm.hh"
@@ -528,6 +529,11 @@ class Fetch
     /** Event used to delay fault generation of translation faults */
     FinishTranslationEvent finishTranslationEvent;
 
+    /** Generator picking the thread to start sending instructions to
+     * decode from, of its own (see objectSeed()).
+     */
+    Random rng;
+
   protected:
     struct FetchStatGroup : public statistics::Group
     {
@@ -67,7 +67,8 @@ BPredUnit::BPredUnit(const Params &params)
       RAS(numThreads),
       iPred(params.indirectBranchPred),
       stats(this),
-      instShiftAmt(params.instShiftAmt)
+      instShiftAmt(params.instShiftAmt),
+      rng(objectSeed(name()))
 {
     for (auto& r : RAS)
         r.init(params.RASSize);
@@ -44,6 +44,7 @@
 
 #include <deque>
 
+#include "base/random.hh"
 #include "base/statistics.hh"
 #include "base/types.hh"
 #include "cpu/pred/btb.hh"
@@ -337,6 +338,13 @@ class BPredUnit : public SimObject
     /** Number of bits to shift instructions by for predictor addresses. */
     const unsigned instShiftAmt;
 
+    /**
+     * Generator of the predictors which draw random numbers, of their own
+     * so that their draws do not depend on the other objects (see
+     * objectSeed()).
+     */
+    Random rng;
+
     /**
      * @{
      * @name PMU Probe points.
@@ -34,6 +34,7 @@
 #ifndef __CPU_PRED_LOOP_PREDICTOR_HH__
 #define __CPU_PRED_LOOP_PREDICTOR_HH__
 
+#include "base/random.hh"
 #include "base/statistics.hh"
 #include "base/types.hh"
 #include "sim/sim_object.hh"
@@ -89,6 +90,13 @@ class LoopPredictor : public SimObject
     const unsigned initialLoopAge;
     const bool optionalAgeReset;
 
+    /**
+     * Generator of the loop predictor, of its own so that its draws do
+     * not depend on the other objects (see objectSeed()). Mutable, as
+     * optionalAgeInc() draws from it.
+     */
+    mutable Random rng;
+
     struct LoopPredictorStats : public statistics::Group
     {
         LoopPredictorStats(statistics::Group *parent);
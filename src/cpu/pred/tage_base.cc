@@ -70,6 +70,7 @@ TAGEBase::TAGEBase(const TAGEBaseParams &p)
      speculativeHistUpdate(p.speculativeHistUpdate),
      instShiftAmt(p.instShiftAmt),
      initialized(false),
+     rng(objectSeed(name())),
      stats(this, nHistoryTables)
 {
     if (noSkip.empty()) {
@@ -50,6 +50,7 @@
 
 #include <vector>
 
+#include "base/random.hh"
 #include "base/statistics.hh"
 #include "cpu/null_static_inst.hh"
 #include "cpu/static_inst.hh"
@@ -491,6 +492,12 @@ class TAGEBase : public SimObject
 
     bool initialized;
 
+    /**
+     * Generator of the TAGE tables, of their own so that their draws do
+     * not depend on the other objects (see objectSeed()).
+     */
+    Random rng;
+
     struct TAGEBaseStats : public statistics::Group
     {
         TAGEBaseStats(statistics::Group *parent, unsigned nHistoryTables);
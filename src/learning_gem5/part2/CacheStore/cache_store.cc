@@ -1,71 +1,290 @@
 #include "learning_gem5/part2/CacheStore/cache_store.hh"
+
+#include <zlib.h>
+
 #include <algorithm>
-#include <iterator>
+#include <new>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include "base/bitfield.hh"
+#include "debug/Checkpoint.hh"
+#include "sim/cur_tick.hh"
+
 namespace gem5
 {
 
-  CacheStore::CacheStore(int s, int E, int b) : s(s), E(E), b(b)
+namespace
+{
+  /**
+   * The ways among the E line_tags equal to tag, branch-free so that the
+   * compiler can still vectorize it
+   */
+  uint64_t match_ways_scalar(const uint64_t *line_tags, int E, uint64_t tag,
+                             int i = 0)
+  {
+    uint64_t mask = 0;
+    for (; i < E; ++i)
+      mask |= (uint64_t)(line_tags[i] == tag) << i;
+    return mask;
+  }
+
+#if defined(__x86_64__)
+  // Only these functions are compiled for the extensions, the binary still
+  // runs on baseline x86-64 hosts
+
+  /** four ways per compare: cmpeq sets all 64 bits of a matching lane, and
+   *  movemask_pd gathers the sign bit of each lane into a 4-bit mask */
+  __attribute__((target("avx2")))
+  uint64_t match_ways_avx2(const uint64_t *line_tags, int E, uint64_t tag)
+  {
+    uint64_t mask = 0;
+    int i = 0;
+    const __m256i key = _mm256_set1_epi64x(tag);
+    for (; i + 4 <= E; i += 4)
+    {
+      __m256i lanes = _mm256_loadu_si256((const __m256i *)(line_tags + i));
+      __m256i eq = _mm256_cmpeq_epi64(lanes, key);
+      mask |= (uint64_t)_mm256_movemask_pd(_mm256_castsi256_pd(eq)) << i;
+    }
+    return mask | match_ways_scalar(line_tags, E, tag, i);
+  }
+
+  /** two ways per compare */
+  __attribute__((target("sse4.1")))
+  uint64_t match_ways_sse4_1(const uint64_t *line_tags, int E, uint64_t tag)
+  {
+    uint64_t mask = 0;
+    int i = 0;
+    const __m128i key = _mm_set1_epi64x(tag);
+    for (; i + 2 <= E; i += 2)
+    {
+      __m128i lanes = _mm_loadu_si128((const __m128i *)(line_tags + i));
+      __m128i eq = _mm_cmpeq_epi64(lanes, key);
+      mask |= (uint64_t)_mm_movemask_pd(_mm_castsi128_pd(eq)) << i;
+    }
+    return mask | match_ways_scalar(line_tags, E, tag, i);
+  }
+#endif
+
+  /** The widest compare the host supports, chosen once at start up */
+  uint64_t (*select_match_ways())(const uint64_t *, int, uint64_t)
+  {
+#if defined(__x86_64__)
+    // static initializers run before the CPU model is known otherwise
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+      return match_ways_avx2;
+    if (__builtin_cpu_supports("sse4.1"))
+      return match_ways_sse4_1;
+#endif
+    return [](const uint64_t *line_tags, int E, uint64_t tag) {
+      return match_ways_scalar(line_tags, E, tag);
+    };
+  }
+
+  uint64_t (*const match_ways)(const uint64_t *, int, uint64_t) =
+      select_match_ways();
+}
+
+
+  CacheStore::CacheStore(int s, int E, int b, replacement_policy::Base *rp,
+                         const std::string &indexing_name,
+                         compression::Base *compressor, int c)
+      : s(s), E(E << c), b(b), c(c), prefetched_first(false), access_count(0), replacementPolicy(rp),
+        indexing_name(indexing_name), indexing(SetIndexing::create(indexing_name, s, E)),
+        compressor(compressor)
   {
+    fatal_if(this->replacementPolicy == nullptr, "CacheStore needs a replacement policy");
+    fatal_if(this->c < 0 || this->c > 5 || (this->c > 0 && this->compressor == nullptr),
+             "super-blocks need a compressor and hold up to 32 blocks");
+    // the valid bits of a set (all the slots of its super-blocks) are kept in one 64-bit mask
+    fatal_if(E < 1 || this->E > 64, "line number per set (times the blocks per super-block) "
+             "should be within [1, 64]");
+
+    full_mask = (this->E == 64) ? ~(uint64_t)0 : (((uint64_t)1 << this->E) - 1);
+
+    // the ways of slot k are k, k + C, k + 2C...
+    for (int k = 0; k < (1 << this->c); k++)
+    {
+      uint64_t slot_mask = 0;
+      for (int j = k; j < this->E; j += 1 << this->c)
+        slot_mask |= (uint64_t)1 << j;
+      slot_masks.push_back(slot_mask);
+    }
+
     // allocate the heap space for the cache simulator
-    cache_store = new cache_line *[1 << this->s];
+    int lines = (1 << this->s) * this->E;
+    tags.assign(lines, 0);
+    valid.assign(1 << this->s, 0); // 0 means invalid
+    dirty.assign(1 << this->s, 0); // 0 means clean
+    prefetched.assign(1 << this->s, 0); // 0 means demand-filled (or used)
+    last_touch.assign(lines, 0);
+    last_access.assign(lines, 0);
+    owner.assign(lines, -1); // -1 means no partition
+    occupancy_count.assign(1, 0);
+    comp_bits.assign(lines, 8 << this->b); // uncompressed
+    decomp_cycles.assign(lines, 0);
+    entries.resize(lines);
+
+    // a single arena holds the data of every line, aligned to the host cache
+    // line so that blocks never straddle two host lines
+    arena_size = (size_t)lines << this->b;
+    arena = new (std::align_val_t(64)) uint8_t[arena_size];
+
+    // the replacement data must be instantiated set by set, way by way: some
+    // policies (e.g. TreePLRU) share their state among the lines of a set
     for (int i = 0; i < (1 << this->s); ++i)
     {
-      cache_store[i] = new cache_line[this->E];
       for (int j = 0; j < this->E; ++j)
-        cache_store[i][j].block = new uint8_t[1 << this->b];
+      {
+        entries[i * this->E + j].setPosition(i, j);
+        entries[i * this->E + j].replacementData = this->replacementPolicy->instantiateEntry();
+      }
     }
 
     DPRINTF(CacheStore, "Finish Constructing CacheStore...\n");
-    DPRINTF(CacheStore, "set no: %d, line no: %d, block no: %d\n", (1 << this->s), this->E, (1 << this->b));
+    DPRINTF(CacheStore, "set no: %d, line no: %d, block no: %d, indexing: %s, blocks per way: %d\n",
+            (1 << this->s), this->E, (1 << this->b), this->indexing_name, (1 << this->c));
   }
 
   CacheStore::~CacheStore()
   {
-    for (int i = 0; i < (1 << this->s); ++i)
-    {
-      for (int j = 0; j < this->E; ++j)
-        delete[] cache_store[i][j].block;
-      delete[] this->cache_store[i];
-    }
-    delete[] this->cache_store;
+    operator delete[](this->arena, std::align_val_t(64));
 
     DPRINTF(CacheStore, "Finish Destructing CacheStore...\n");
   }
 
-  // Function 'find' in simple_cache.cc has been replaced by CacheStore
-  std::pair<gem5::Addr, uint8_t *> CacheStore::find(Addr block_addr)
+  int CacheStore::parse(gem5::Addr block_addr, uint64_t &tag) const
   {
-    DPRINTF(CacheStore, "whether or not addr %#x can be found\n", block_addr);
-
-    // step 01: parse the block_addr and find the target set
     panic_if(this->b >= 32, "non-negative int has 31 bits at most");
     int block = block_addr & ((1 << this->b) - 1); // block offset
-    assert(block == 0);                            // block address is aligned in this function
+    assert(block == 0);                            // block address is aligned in CacheStore
+
+    // the indexing function maps the super-block number to a set and a tag
+    uint64_t super_block = block_addr >> (this->b + this->c);
+    tag = this->indexing->tag_of(super_block);
+    return this->indexing->set_of(super_block, 0);
+  }
+
+  int CacheStore::set_in(gem5::Addr block_addr, int set, int way) const
+  {
+    if (!this->indexing->skewed())
+      return set;
+    return this->indexing->set_of(block_addr >> (this->b + this->c), way);
+  }
+
+  bool CacheStore::fits(int set, int way, int slot, uint64_t tag, int size_bits) const
+  {
+    // the slots of the physical way holding a block
+    int first = way << this->c;
+    uint64_t slots = (this->valid[set] >> first) & (((uint64_t)1 << (1 << this->c)) - 1);
+    if ((slots >> slot) & 1)
+      return false;
+    if (slots == 0)
+      return true;
+
+    // the blocks of one super-block share the way if each fits in its slot
+    int slot_bits = (8 << this->b) >> this->c;
+    if (size_bits > slot_bits)
+      return false;
+    for (; slots != 0; slots &= slots - 1)
+    {
+      int i = set * this->E + first + findLsbSet(slots);
+      if (this->tags[i] != tag || this->comp_bits[i] > slot_bits)
+        return false;
+    }
+    return true;
+  }
+
+  int CacheStore::lookup(gem5::Addr block_addr, int &set) const
+  {
+    uint64_t tag;
+    set = parse(block_addr, tag);
+
+    int slot = slot_of(block_addr);
+    if (!this->indexing->skewed())
+    {
+      // every way of the block is in the same set: compare them all at once,
+      // only the ways of its slot can hold it
+      uint64_t hit = match_tag(set, tag) & this->slot_masks[slot];
+      return (hit != 0) ? findLsbSet(hit) : -1;
+    }
+
+    // skewed: the block may be in a different set in each physical way
+    for (int j = slot; j < this->E; j += 1 << this->c)
+    {
+      int set_j = set_in(block_addr, set, j >> this->c);
+      if (((this->valid[set_j] >> j) & 1) && this->tags[set_j * this->E + j] == tag)
+      {
+        set = set_j;
+        return j;
+      }
+    }
+    return -1;
+  }
+
+  int CacheStore::line_of(gem5::Addr block_addr, int set, int way) const
+  {
+    return set_in(block_addr, set, way >> this->c) * this->E + way;
+  }
+
+  void CacheStore::release(int i)
+  {
+    this->occupancy_count[partition_index(this->owner[i])]--;
+    this->owner[i] = -1;
+  }
 
-    panic_if(this->s >= 32, "non-negative int has 31 bits at most");
-    int set = (block_addr & (((1 << this->s) - 1) << this->b)) >> this->b; // set number
+  // Function 'find' in simple_cache.cc has been replaced by CacheStore
+  std::pair<gem5::Addr, uint8_t *> CacheStore::find(Addr block_addr, const PacketPtr pkt,
+                                                    AccessInfo *info)
+  {
+    DPRINTF(CacheStore, "whether or not addr %#x can be found\n", block_addr);
 
-    uint64_t tag = block_addr >> (this->s + this->b);
+    // step 01: parse the block_addr and find the line among the ways of the block
+    // (only a valid line whose tag matches is found)
+    int set;
+    int way = lookup(block_addr, set);
 
-    DPRINTF(CacheStore, "parsing result: (block set tag) %d %d %#x\n", block, set, tag);
+    DPRINTF(CacheStore, "lookup result: (set way) %d %d\n", set, way);
 
-    // step 02: find the cache line according to block, set and tag
-    cache_line *target = this->cache_store[set];
+    // step 02: update the state of the line found
     std::pair<gem5::Addr, uint8_t *> res(block_addr, nullptr);
-    for (int i = 0; i < this->E; ++i)
+    if (way >= 0)
     {
-      if (target[i].valid_bit == 0)
-        continue; // this is not a valid line
-      // if tag matches, then the cache line is found
-      if (target[i].tag == tag)
+      int i = set * this->E + way;
+      res.second = block_of(set, way);
+      DPRINTF(CacheStore, "!!!Cache hit!!!\n");
+      // remember to update the replacement state of the line when visited
+      this->replacementPolicy->touch(this->entries[i].replacementData, pkt);
+      this->last_touch[i] = curTick();
+
+      if (info != nullptr)
       {
-        res.second = target[i].block;
-        DPRINTF(CacheStore, "!!!Cache hit!!!\n");
-        // remember to update the counter of every cache line when visited (LRU)
-        target[i].counter = curTick();
-        break;
+        // count the valid lines the block could be in accessed after this one
+        int distance = 0;
+        for (int j = 0; j < this->E; j++)
+        {
+          int k = line_of(block_addr, set, j);
+          if ((this->valid[k / this->E] >> j) & 1)
+            distance += this->last_access[k] > this->last_access[i];
+        }
+        info->way = way;
+        info->stack_distance = distance;
+        info->decompression_latency = Cycles(this->decomp_cycles[i]);
       }
+      this->last_access[i] = ++this->access_count;
+    }
+    else if (info != nullptr)
+    {
+      info->way = -1;
+      info->stack_distance = -1;
+      info->decompression_latency = Cycles(0);
     }
+    if (info != nullptr)
+      info->set = set;
 
     // step 03: exit the cycle, nullptr marks no cache line can be found
     return res;
@@ -73,66 +292,122 @@ namespace gem5
 
   // Function 'set' in simple_cache.cc has been replaced by CacheStore
   // handle response, store data into the cache line (vacancy can be assured in this function)
-  void CacheStore::set(gem5::Addr address, uint8_t *data)
+  uint8_t *CacheStore::set(gem5::Addr address, const PacketPtr pkt, int partition,
+                           int size_bits, Cycles decomp_lat)
   {
     DPRINTF(CacheStore, "set addr %#x into CacheStore\n", address);
 
-    // step 01: parse the target address into three parts
-    panic_if(this->b >= 32, "non-negative int has 31 bits at most");
-    int block = address & ((1 << this->b) - 1); // block offset
-    assert(block == 0);                         // block address is aligned in this function
-
-    panic_if(this->s >= 32, "non-negative int has 31 bits at most");
-    int set = (address & (((1 << this->s) - 1) << this->b)) >> this->b; // set number
+    // step 01: parse the target address into set and tag
+    uint64_t tag;
+    int set = parse(address, tag);
 
-    uint64_t tag = address >> (this->s + this->b);
-
-    DPRINTF(CacheStore, "parsing result: (block set tag) %d %d %#x\n", block, set, tag);
+    DPRINTF(CacheStore, "parsing result: (set tag) %d %#x\n", set, tag);
 
     // step 02: determine the line number to be stored (cache miss but there must be one vacant line)
-    cache_line *target = this->cache_store[set];
-    int i = 0, j = -1; // j is used to record the line number in the set, -1 means not found
-    for (; i < this->E; ++i)
+    int hit_set;
+    panic_if(lookup(address, hit_set) >= 0, "cache line should not hit!");
+    if (size_bits < 0)
+      size_bits = 8 << this->b;
+    int slot = slot_of(address);
+    uint64_t mask = way_mask(partition);
+    int j = -1;
+    for (int shared = 1; shared >= 0 && j < 0; shared--)
     {
-      if (target[i].valid_bit == 1 && target[i].tag == tag)
-        panic("cache line should not hit!");
-      if (target[i].valid_bit == 0 && j == -1) // this line can be replaced if j = -1
-        j = i;
+      // the first vacant line among the ways of the block the partition may
+      // fill, next to the other blocks of its super-block first
+      for (int k = slot; k < this->E && j < 0; k += 1 << this->c)
+      {
+        int way_set = set_in(address, set, k >> this->c);
+        uint64_t slots = (this->valid[way_set] >> (k - slot)) & (((uint64_t)1 << (1 << this->c)) - 1);
+        if (((mask >> k) & 1) && (slots != 0) == shared &&
+            fits(way_set, k >> this->c, slot, tag, size_bits))
+        {
+          set = way_set;
+          j = k;
+        }
+      }
     }
-    panic_if(j == -1, "no vacant line can be found");
+    panic_if(j < 0, "no vacant line can be found");
 
-    DPRINTF(CacheStore, "the line number chosen to place the address: %d\n", j);
+    DPRINTF(CacheStore, "the line chosen to place the address: (set way) %d %d\n", set, j);
 
     // step 03: modify the cache line in CacheStore
-    target[j].valid_bit = 1;
-    target[j].tag = tag;
-    target[j].block = data;              // data has not been written into the cache line block
-    target[j].creation_time = curTick(); // current tick when the cache line is set for FIFO
-    target[j].counter = curTick();       // current tick when the cache line is set
+    int i = set * this->E + j;
+    this->valid[set] |= (uint64_t)1 << j;
+    this->dirty[set] &= ~((uint64_t)1 << j); // the new content matches memory
+    this->prefetched[set] &= ~((uint64_t)1 << j); // the caller marks a prefetch
+    this->tags[i] = tag;
+    this->replacementPolicy->reset(this->entries[i].replacementData, pkt);
+    this->last_touch[i] = curTick();
+    this->last_access[i] = ++this->access_count;
+    this->owner[i] = partition;
+    this->occupancy_count[partition_index(partition)]++;
+    this->comp_bits[i] = size_bits;
+    this->decomp_cycles[i] = (size_bits < (8 << this->b)) ? (uint64_t)decomp_lat : 0;
+
+    // data has not been written into the cache line block, the caller copies it
+    return block_of(set, j);
   }
 
-  bool CacheStore::isFull(gem5::Addr address)
+  uint8_t *CacheStore::data_of(gem5::Addr block_addr) const
   {
-    DPRINTF(CacheStore, "Is addr %#x in a full set?\n", address);
+    int set;
+    int way = lookup(block_addr, set);
+    return (way >= 0) ? block_of(set, way) : nullptr;
+  }
 
-    // return true iff all cache lines in that set are valid
-    panic_if(this->b >= 32, "non-negative int has 31 bits at most");
-    int block = address & ((1 << this->b) - 1); // block offset
-    assert(block == 0);                         // block address is aligned in this function
+  void CacheStore::set_dirty(gem5::Addr block_addr)
+  {
+    DPRINTF(CacheStore, "mark addr %#x as dirty\n", block_addr);
 
-    panic_if(this->s >= 32, "non-negative int has 31 bits at most");
-    int set = (address & (((1 << this->s) - 1) << this->b)) >> this->b; // set number
-    cache_line *target = this->cache_store[set];
+    int set;
+    int way = lookup(block_addr, set);
+    panic_if(way < 0, "cannot mark a line that is not in CacheStore as dirty");
+    this->dirty[set] |= (uint64_t)1 << way;
+  }
 
-    bool flag = true; // switch to false if valid bit == 0
-    for (int i = 0; i < this->E; ++i)
-    {
-      if (target[i].valid_bit == 0)
-      {
-        flag = false;
-        break;
-      }
-    }
+  bool CacheStore::is_dirty(gem5::Addr block_addr)
+  {
+    int set;
+    int way = lookup(block_addr, set);
+    return way >= 0 && ((this->dirty[set] >> way) & 1);
+  }
+
+  void CacheStore::set_prefetched(gem5::Addr block_addr, bool prefetched)
+  {
+    DPRINTF(CacheStore, "mark addr %#x as %s\n", block_addr, prefetched ? "prefetched" : "used");
+
+    int set;
+    int way = lookup(block_addr, set);
+    panic_if(way < 0, "cannot mark a line that is not in CacheStore as prefetched");
+    if (prefetched)
+      this->prefetched[set] |= (uint64_t)1 << way;
+    else
+      this->prefetched[set] &= ~((uint64_t)1 << way);
+  }
+
+  bool CacheStore::is_prefetched(gem5::Addr block_addr) const
+  {
+    int set;
+    int way = lookup(block_addr, set);
+    return way >= 0 && ((this->prefetched[set] >> way) & 1);
+  }
+
+  bool CacheStore::isFull(gem5::Addr address, int partition, int size_bits)
+  {
+    DPRINTF(CacheStore, "Is addr %#x in a full set?\n", address);
+
+    // return true iff the block fits in none of the physical ways it could go to
+    uint64_t tag;
+    int set = parse(address, tag);
+    int slot = slot_of(address);
+    uint64_t mask = way_mask(partition);
+    if (size_bits < 0)
+      size_bits = 8 << this->b;
+
+    bool flag = true; // false if the block fits in any way
+    for (int j = slot; j < this->E && flag; j += 1 << this->c)
+      flag = !((mask >> j) & 1) || !fits(set_in(address, set, j >> this->c), j >> this->c, slot, tag, size_bits);
 
     if (flag)
       DPRINTF(CacheStore, "The set is full!\n");
@@ -147,57 +422,290 @@ namespace gem5
     DPRINTF(CacheStore, "erase cache line at addr %#x\n", address);
 
     // by simply setting the valid_bit to be 0, we can erase the cache_line
-    panic_if(this->b >= 32, "non-negative int has 31 bits at most");
-    int block = address & ((1 << this->b) - 1); // block offset
-    assert(block == 0);                         // block address is aligned in this function
+    int set;
+    int i = lookup(address, set);
+    if (i >= 0) // having found the line to be deleted
+    {
+      release(set * this->E + i);
+      this->valid[set] &= ~((uint64_t)1 << i);
+      this->dirty[set] &= ~((uint64_t)1 << i);
+      this->prefetched[set] &= ~((uint64_t)1 << i);
+      this->replacementPolicy->invalidate(this->entries[set * this->E + i].replacementData);
+      DPRINTF(CacheStore, "setting the valid_bit at line %d to be zero\n", i);
+    }
+  }
+
+  int CacheStore::set_of(gem5::Addr address) const
+  {
+    // the set of the super-block, as parse() finds it
+    return this->indexing->set_of(address >> (this->b + this->c), 0);
+  }
 
-    panic_if(this->s >= 32, "non-negative int has 31 bits at most");
-    int set = (address & (((1 << this->s) - 1) << this->b)) >> this->b; // set number
+  void CacheStore::clean(gem5::Addr block_addr)
+  {
+    DPRINTF(CacheStore, "mark addr %#x as clean\n", block_addr);
 
-    uint64_t tag = address >> (this->s + this->b);
+    int set;
+    int way = lookup(block_addr, set);
+    panic_if(way < 0, "cannot mark a line that is not in CacheStore as clean");
+    this->dirty[set] &= ~((uint64_t)1 << way);
+  }
 
-    cache_line *target = this->cache_store[set];
-    for (int i = 0; i < this->E; ++i)
+  void CacheStore::for_each_line(const std::function<void(gem5::Addr, uint8_t *, bool)> &visit)
+  {
+    for (int i = 0; i < (1 << this->s); i++)
     {
-      // when this function is called, all of the cache lines should be occupied
-      assert(target[i].valid_bit == 1);
-      if (target[i].tag == tag) // having found the line to be deleted
+      // only the valid ways of the set are visited
+      uint64_t ways = this->valid[i];
+      while (ways != 0)
       {
-        target[i].valid_bit = 0;
-        DPRINTF(CacheStore, "setting the valid_bit at line %d to be zero\n", i);
+        int j = findLsbSet(ways);
+        ways &= ways - 1;
+        Addr addr = combine(this->tags[i * this->E + j], i, j);
+        visit(addr, block_of(i, j), (this->dirty[i] >> j) & 1);
       }
     }
   }
 
-  std::pair<gem5::Addr, uint8_t *> CacheStore::pick_line(gem5::Addr address)
+  void CacheStore::invalidate_all()
   {
-    DPRINTF(CacheStore, "The addr of a new pkt to be inserted: %#x\n", address);
+    DPRINTF(CacheStore, "invalidate all the lines\n");
 
-    panic_if(this->b >= 32, "non-negative int has 31 bits at most");
-    int block = address & ((1 << this->b) - 1); // block offset
-    assert(block == 0);                         // block address is aligned in this function
+    for (int i = 0; i < (1 << this->s); i++)
+    {
+      uint64_t ways = this->valid[i];
+      while (ways != 0)
+      {
+        int j = findLsbSet(ways);
+        ways &= ways - 1;
+        release(i * this->E + j);
+        this->replacementPolicy->invalidate(this->entries[i * this->E + j].replacementData);
+      }
+      this->valid[i] = 0;
+      this->dirty[i] = 0;
+      this->prefetched[i] = 0;
+    }
+  }
 
-    panic_if(this->s >= 32, "non-negative int has 31 bits at most");
-    int set = (address & (((1 << this->s) - 1) << this->b)) >> this->b; // set number
-    cache_line *target = this->cache_store[set];
+  std::pair<gem5::Addr, uint8_t *> CacheStore::pick_line(gem5::Addr address, int partition)
+  {
+    DPRINTF(CacheStore, "The addr of a new pkt to be inserted: %#x\n", address);
 
-    // introduce the replacement policy to pick a line in the selected set
-    int line_number = policy_LRU(target);
-    DPRINTF(CacheStore, "Line %d will be erased later\n", line_number);
-    Addr addr = combine(target[line_number].tag, set, block);
-    DPRINTF(CacheStore, "Line %d starts at addr %#x\n", line_number, addr);
+    // introduce the replacement policy to pick a line among the ways of the block
+    ReplaceableEntry *victim = pick_victim(address, partition);
+    int set = victim->getSet();
+    int way = victim->getWay();
+    DPRINTF(CacheStore, "Line (set way) %d %d will be erased later\n", set, way);
+    Addr addr = combine(this->tags[set * this->E + way], set, way);
+    DPRINTF(CacheStore, "Line %d starts at addr %#x\n", way, addr);
 
-    std::pair<gem5::Addr, uint8_t *> res(addr, target[line_number].block);
+    std::pair<gem5::Addr, uint8_t *> res(addr, block_of(set, way));
     return res;
   }
 
-  gem5::Addr CacheStore::combine(uint64_t tag, int set, int block)
+  gem5::Addr CacheStore::combine(uint64_t tag, int set, int way)
+  {
+    DPRINTF(CacheStore, "before combining: (way set tag) %d %d %#x\n", way, set, tag);
+
+    uint64_t super_block = this->indexing->block_number(tag, set, way >> this->c);
+    return ((super_block << this->c) | (way & ((1 << this->c) - 1))) << this->b;
+  }
+
+  uint64_t CacheStore::num_blocks() const
+  {
+    uint64_t blocks = 0;
+    for (uint64_t count : this->occupancy_count)
+      blocks += count;
+    return blocks;
+  }
+
+  int CacheStore::compress(const uint8_t *data, Cycles &decomp_lat)
+  {
+    decomp_lat = Cycles(0);
+    if (this->compressor == nullptr)
+      return 8 << this->b;
+
+    // the compressor gives the size back as uncompressed if it is not worth it
+    Cycles comp_lat(0);
+    int size_bits = this->compressor->compress((const uint64_t *)data, comp_lat, decomp_lat)->getSizeBits();
+    if (size_bits >= (8 << this->b))
+      decomp_lat = Cycles(0);
+    return size_bits;
+  }
+
+  std::vector<gem5::Addr> CacheStore::recompress(gem5::Addr block_addr)
+  {
+    std::vector<gem5::Addr> evicted;
+    if (this->compressor == nullptr)
+      return evicted;
+
+    int set;
+    int way = lookup(block_addr, set);
+    panic_if(way < 0, "cannot compress a line that is not in CacheStore");
+    int i = set * this->E + way;
+    Cycles decomp_lat;
+    this->comp_bits[i] = compress(block_of(set, way), decomp_lat);
+    this->decomp_cycles[i] = decomp_lat;
+    if (this->comp_bits[i] <= ((8 << this->b) >> this->c))
+      return evicted;
+
+    // the line has grown out of its slot: it keeps the physical way alone
+    int first = (way >> this->c) << this->c;
+    for (int j = first; j < first + (1 << this->c); j++)
+      if (j != way && ((this->valid[set] >> j) & 1))
+        evicted.push_back(combine(this->tags[set * this->E + j], set, j));
+    DPRINTF(CacheStore, "addr %#x grew to %d bits, %d lines have to go\n", block_addr,
+            this->comp_bits[i], evicted.size());
+    return evicted;
+  }
+
+  void CacheStore::serialize(CheckpointOut &cp) const
   {
-    DPRINTF(CacheStore, "before combining: (block set tag) %d %d %#x\n", block, set, tag);
+    // the geometry is checked on restore, the lines cannot be moved to another one
+    int s = this->s;
+    int E = this->E;
+    int b = this->b;
+    int c = this->c;
+    SERIALIZE_SCALAR(s);
+    SERIALIZE_SCALAR(E);
+    SERIALIZE_SCALAR(b);
+    SERIALIZE_SCALAR(c);
+    SERIALIZE_SCALAR(indexing_name);
+
+    SERIALIZE_CONTAINER(tags);
+    SERIALIZE_CONTAINER(valid);
+    SERIALIZE_CONTAINER(dirty);
+    SERIALIZE_CONTAINER(prefetched);
+    SERIALIZE_CONTAINER(last_touch);
+    SERIALIZE_CONTAINER(last_access);
+    SERIALIZE_SCALAR(access_count);
+    SERIALIZE_CONTAINER(owner);
+    SERIALIZE_CONTAINER(comp_bits);
+    SERIALIZE_CONTAINER(decomp_cycles);
+
+    // only the blocks of valid lines are written, set by set and way by way
+    std::string filename = Serializable::currentSection() + ".arena.gz";
+    SERIALIZE_SCALAR(filename);
+
+    DPRINTF(Checkpoint, "Serializing CacheStore data to %s\n", filename);
+
+    std::string filepath = CheckpointIn::dir() + "/" + filename;
+    gzFile data_file = gzopen(filepath.c_str(), "wb");
+    fatal_if(data_file == NULL, "Can't open CacheStore checkpoint file '%s'", filename);
+
+    for (int i = 0; i < (1 << this->s); i++)
+    {
+      for (int j = 0; j < this->E; j++)
+      {
+        if (((this->valid[i] >> j) & 1) == 0)
+          continue;
+        fatal_if(gzwrite(data_file, block_of(i, j), 1 << this->b) != (1 << this->b),
+                 "Write failed on CacheStore checkpoint file '%s'", filename);
+      }
+    }
 
-    assert(block == 0);
-    Addr addr = tag << (this->s + this->b);
-    return addr | (set << this->b);
+    fatal_if(gzclose(data_file) != Z_OK, "Close failed on CacheStore checkpoint file '%s'", filename);
+  }
+
+  void CacheStore::unserialize(CheckpointIn &cp)
+  {
+    int s, E, b;
+    UNSERIALIZE_SCALAR(s);
+    UNSERIALIZE_SCALAR(E);
+    UNSERIALIZE_SCALAR(b);
+    fatal_if(s != this->s || E != this->E || b != this->b,
+             "CacheStore geometry has changed! Saw (s E b) %d %d %d, expected %d %d %d",
+             s, E, b, this->s, this->E, this->b);
+
+    // checkpoints taken before compression have no super-blocks
+    int c = 0;
+    UNSERIALIZE_OPT_SCALAR(c);
+    fatal_if(c != this->c, "CacheStore blocks per way have changed! Saw %d, expected %d",
+             1 << c, 1 << this->c);
+
+    // checkpoints taken before the indexing could be chosen are set associative
+    std::string indexing_name = "SetAssociative";
+    UNSERIALIZE_OPT_SCALAR(indexing_name);
+    fatal_if(indexing_name != this->indexing_name, "CacheStore indexing has changed! Saw %s, expected %s",
+             indexing_name, this->indexing_name);
+
+    // drop whatever the store holds before restoring it
+    invalidate_all();
+
+    UNSERIALIZE_CONTAINER(tags);
+    UNSERIALIZE_CONTAINER(valid);
+    UNSERIALIZE_CONTAINER(dirty);
+    // checkpoints taken before prefetching have no prefetched lines
+    if (cp.entryExists(Serializable::currentSection(), "prefetched"))
+      UNSERIALIZE_CONTAINER(prefetched);
+    else
+      this->prefetched.assign(this->prefetched.size(), 0);
+    UNSERIALIZE_CONTAINER(last_touch);
+    UNSERIALIZE_CONTAINER(last_access);
+    UNSERIALIZE_SCALAR(access_count);
+
+    // checkpoints taken before partitioning have no owner
+    if (cp.entryExists(Serializable::currentSection(), "owner"))
+      UNSERIALIZE_CONTAINER(owner);
+    else
+      this->owner.assign(this->owner.size(), -1);
+    recount();
+
+    // the blocks were compressed when the checkpoint was taken, with the same geometry
+    if (cp.entryExists(Serializable::currentSection(), "comp_bits"))
+    {
+      UNSERIALIZE_CONTAINER(comp_bits);
+      UNSERIALIZE_CONTAINER(decomp_cycles);
+    }
+    else
+    {
+      this->comp_bits.assign(this->comp_bits.size(), 8 << this->b);
+      this->decomp_cycles.assign(this->decomp_cycles.size(), 0);
+    }
+
+    std::string filename;
+    UNSERIALIZE_SCALAR(filename);
+
+    DPRINTF(Checkpoint, "Unserializing CacheStore data from %s\n", filename);
+
+    std::string filepath = cp.getCptDir() + "/" + filename;
+    gzFile data_file = gzopen(filepath.c_str(), "rb");
+    fatal_if(data_file == NULL, "Can't open CacheStore checkpoint file '%s'", filename);
+
+    // the blocks come in the order they were written, and the valid lines are
+    // collected along the way for the replay below
+    std::vector<int> lines;
+    for (int i = 0; i < (1 << this->s); i++)
+    {
+      for (int j = 0; j < this->E; j++)
+      {
+        if (((this->valid[i] >> j) & 1) == 0)
+          continue;
+        fatal_if(gzread(data_file, block_of(i, j), 1 << this->b) != (1 << this->b),
+                 "Read failed on CacheStore checkpoint file '%s'", filename);
+        lines.push_back(i * this->E + j);
+      }
+    }
+
+    fatal_if(gzclose(data_file) != Z_OK, "Close failed on CacheStore checkpoint file '%s'", filename);
+
+    // the replacement data is specific to each policy and cannot be saved, so
+    // the lines are restored in the order of their last access, with the tick
+    // of that access. Recency based policies (LRU, MRU, TreePLRU...) get their
+    // exact state back, the others an approximation of it
+    std::sort(lines.begin(), lines.end(), [this](int x, int y)
+              { return this->last_access[x] < this->last_access[y]; });
+
+    for (int i : lines)
+    {
+      // some policies (e.g. SHiP) need an access to train on
+      Addr addr = combine(this->tags[i], i / this->E, i % this->E);
+      RequestPtr req = std::make_shared<Request>(addr, 1 << this->b, 0, 0);
+      Packet replay(req, MemCmd::ReadReq);
+
+      this->replacementPolicy->restore(this->entries[i].replacementData, &replay,
+                                       this->last_touch[i]);
+    }
   }
 
   void CacheStore::print_set(int set)
@@ -205,37 +713,121 @@ namespace gem5
     DPRINTF(CacheStore, "Printing info about set %d...\n", set);
     for (int i = 0; i < this->E; ++i)
     {
-      DPRINTF(CacheStore, "[Set %d Line %d] valid %d tag %#x\n", set, i, this->cache_store[set][i].valid_bit, this->cache_store[set][i].tag);
+      DPRINTF(CacheStore, "[Set %d Line %d] valid %d dirty %d tag %#x\n", set, i, (int)bits(this->valid[set], i),
+              (int)bits(this->dirty[set], i), this->tags[set * this->E + i]);
     }
   }
 
-  int CacheStore::policy_LRU(cache_line *lines)
+  ReplaceableEntry *CacheStore::pick_victim(gem5::Addr address, int partition)
   {
-    DPRINTF(CacheStore, "Replacement Policy: LRU...\n");
+    DPRINTF(CacheStore, "Replacement Policy: %s...\n", this->replacementPolicy->name());
+
+    // every physical way the block could go to in the ways of the partition
+    // is a candidate, through its most recently used line, and the policy
+    // picks the victim
+    uint64_t tag;
+    int set = parse(address, tag);
+    uint64_t mask = way_mask(partition);
+    ReplacementCandidates candidates;
+    candidates.reserve(this->E >> this->c);
+    for (int j = slot_of(address); j < this->E; j += 1 << this->c)
+    {
+      if (((mask >> j) & 1) == 0)
+        continue;
+      int way_set = set_in(address, set, j >> this->c);
+      int first = (j >> this->c) << this->c;
+      int mru = first;
+      for (int k = first; k < first + (1 << this->c); k++)
+        if (((this->valid[way_set] >> k) & 1) &&
+            (((this->valid[way_set] >> mru) & 1) == 0 ||
+             this->last_access[way_set * this->E + k] > this->last_access[way_set * this->E + mru]))
+          mru = k;
+      candidates.push_back(&this->entries[way_set * this->E + mru]);
+    }
 
-    int res = 0;                        // the line number that will be returned to the caller
-    gem5::Tick tick = lines[0].counter; // initialized to the first line in the set
-    // go through other lines and update the res if we find a smaller tick
+    // the unused prefetched lines go first: a prefetch that missed the
+    // working set should not push a demand-filled line out
+    if (this->prefetched_first)
+    {
+      ReplacementCandidates prefetched_lines;
+      for (ReplaceableEntry *candidate : candidates)
+        if ((this->prefetched[candidate->getSet()] >> candidate->getWay()) & 1)
+          prefetched_lines.push_back(candidate);
+      if (!prefetched_lines.empty())
+        candidates.swap(prefetched_lines);
+    }
+
+    ReplaceableEntry *victim = this->replacementPolicy->getVictim(candidates);
+    if (this->c == 0)
+      return victim;
+
+    // the least recently used line of the super-block goes first
+    int victim_set = victim->getSet();
+    int first = (victim->getWay() >> this->c) << this->c;
+    int lru = victim->getWay();
+    for (int k = first; k < first + (1 << this->c); k++)
+      if (((this->valid[victim_set] >> k) & 1) &&
+          this->last_access[victim_set * this->E + k] < this->last_access[victim_set * this->E + lru])
+        lru = k;
+    return &this->entries[victim_set * this->E + lru];
+  }
 
-    for (int i = 1; i < this->E; ++i)
+  void CacheStore::set_way_masks(const std::vector<uint64_t> &masks)
+  {
+    // the masks are given in physical ways, every slot of a way follows it
+    uint64_t ways_mask = this->full_mask >> (this->E - (this->E >> this->c));
+    this->way_masks.clear();
+    for (uint64_t mask : masks)
     {
-      if (lines[i].counter < tick)
-      {
-        tick = lines[i].counter;
-        res = i;
-      }
-    } // we find the stale cache line(res) in this set when exiting the cycle
+      fatal_if((mask & ways_mask) == 0, "a partition should be given at least one way");
+      uint64_t slots = 0;
+      for (int j = 0; j < this->E; j++)
+        slots |= ((mask >> (j >> this->c)) & 1) << j;
+      this->way_masks.push_back(slots);
+    }
 
-    return res;
+    if (this->occupancy_count.size() != this->way_masks.size() + 1)
+      recount();
+  }
+
+  uint64_t CacheStore::way_mask(int partition) const
+  {
+    if (partition < 0 || partition >= (int)this->way_masks.size())
+      return this->full_mask;
+    return this->way_masks[partition];
   }
 
-  // IMPLEMENTATION OF FIFO REPLACEMENT POLICY
-  int CacheStore::policy_FIFO(cache_line *lines)
+  int CacheStore::partition_index(int partition) const
   {
-    DPRINTF(CacheStore, "Replacement Policy: FIFO...\n");
+    // the lines of no partition (or of a partition without a mask) come first
+    if (partition < 0 || partition >= (int)this->way_masks.size())
+      return 0;
+    return partition + 1;
+  }
 
-    auto a = [=](cache_line a, cache_line b)
-    { return a.creation_time != 0 ? a.creation_time < b.creation_time : false; };
-    return std::distance(lines, std::min_element(lines, lines + this->E, a));
+  uint64_t CacheStore::occupancy(int partition) const
+  {
+    return this->occupancy_count[partition_index(partition)];
+  }
+
+  void CacheStore::recount()
+  {
+    this->occupancy_count.assign(this->way_masks.size() + 1, 0);
+    for (int i = 0; i < (1 << this->s); i++)
+    {
+      uint64_t ways = this->valid[i];
+      while (ways != 0)
+      {
+        int j = findLsbSet(ways);
+        ways &= ways - 1;
+        this->occupancy_count[partition_index(this->owner[i * this->E + j])]++;
+      }
+    }
+  }
+
+  uint64_t CacheStore::match_tag(int set, uint64_t tag) const
+  {
+    return match_ways(&this->tags[set * this->E], this->E, tag) &
+           this->valid[set];
   }
 }
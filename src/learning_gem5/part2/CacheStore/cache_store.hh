@@ -3,88 +3,352 @@
 
 #include <bits/types.h>
 
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
 #include "base/logging.hh"
 #include "base/types.hh"
 #include "base/trace.hh"
 #include "debug/CacheStore.hh"
+#include "learning_gem5/part2/CacheStore/set_indexing.hh"
+#include "mem/cache/compressors/base.hh"
+#include "mem/cache/replacement_policies/base.hh"
+#include "mem/packet.hh"
 #include "sim/cur_tick.hh"
+#include "sim/serialize.hh"
 
 typedef __uint64_t uint64_t;
 typedef unsigned char uint8_t;
 
-// cache_line structure:
-// **************************************
-// ** VALID ** TAG ** BLOCK ** COUNTER **
-// **************************************
-typedef struct line
-{
-  int valid_bit;            // valid bit
-  uint64_t tag;             // tag
-  uint8_t *block;           // data block
-  gem5::Tick counter;       // timestamp for the line
-  gem5::Tick creation_time; // timestamp for the line for FIFO
-  // constructors
-  line()
-  {
-    valid_bit = 0; // 0 means invalid
-    tag = 0;
-    block = nullptr;
-    counter = 0;
-  }
-
-  line(int B)
-  {
-    valid_bit = 0; // 0 means invalid
-    tag = 0;
-    block = new uint8_t[B];
-    counter = 0;
-    creation_time = 0;
-  }
-} cache_line;
+// CacheStore layout (structure of arrays):
+// ***************************************************************
+// ** TAGS:   set 0 [way 0 .. way E-1] | set 1 [...] | ...       **
+// ** VALID:  one bitmask per set, bit i stands for way i        **
+// ** DIRTY:  one bitmask per set, bit i stands for way i        **
+// ** PREFETCHED: one bitmask per set, bit i stands for way i    **
+// ** ARENA:  data blocks of all lines in one aligned allocation **
+// ** ENTRIES: replacement state of each line (ReplaceableEntry) **
+// ** TOUCH:  tick of the last access to each line               **
+// ** OWNER:  partition that filled each line                   **
+// ** SIZE:   compressed size of each line                       **
+// ***************************************************************
+// the tags of a set are contiguous, so that a lookup compares the tag
+// against all ways at once and combines the result with the valid mask
+// (with skewed indexing each way of a block is in its own set, and the
+// ways are compared one by one)
+//
+// with compression, a physical way holds a super-block: C = 2 ^ c adjacent
+// blocks sharing one tag, each in its own slot. Every slot is a line of its
+// own above (E counts the slots), and the blocks of a super-block only share
+// a physical way when each of them compresses to 1 / C of a block or less
+// (the data stays uncompressed in the arena, only the capacity is modelled)
 
 namespace gem5
 {
 
   // cache_store structure:
   // S sets in total, and E cache_lines in each set
-  class CacheStore
+  class CacheStore : public Serializable
   {
   private:
     // set number: S = 2 ^ s (sets)
     int s;
 
-    // line number per set: E
+    // line number per set: E (physical ways times C)
     int E;
 
     // bytes number per block: B = 2 ^ b (Bytes)
     int b;
 
-    // two-demension array: using set number and line number to locate a cache_line
-    cache_line **cache_store;
+    // blocks per physical way: C = 2 ^ c (1 without compression)
+    int c;
+
+    // tags of every line, set by set: tags[set * E + way]
+    std::vector<uint64_t> tags;
+
+    // valid bits of every set: bit i of valid[set] is the valid bit of way i
+    std::vector<uint64_t> valid;
+
+    // dirty bits of every set: bit i of dirty[set] is set once way i is
+    // written, so that only modified lines have to be written back
+    std::vector<uint64_t> dirty;
+
+    // prefetched bits of every set: bit i of prefetched[set] is set while way i
+    // holds a prefetched block that no demand access has used yet
+    std::vector<uint64_t> prefetched;
+
+    // the replacement policy picks among the unused prefetched lines first,
+    // when the block could go to any of them
+    bool prefetched_first;
+
+    // data blocks of every line in one cache-line-aligned allocation:
+    // the block of (set, way) starts at arena + ((set * E + way) << b)
+    uint8_t *arena;
+
+    // size of the arena in bytes
+    size_t arena_size;
+
+    // replacement state and position of every line: entries[set * E + way]
+    std::vector<ReplaceableEntry> entries;
+
+    // tick of the last access (fill or hit) to every line: last_touch[set * E + way]
+    // the replacement state is opaque to CacheStore, so a checkpoint keeps the
+    // access order and replays it into the policy on restore
+    std::vector<Tick> last_touch;
+
+    // order of the last access to every line: last_access[set * E + way] is the
+    // value of access_count when the line was last filled or hit
+    std::vector<uint64_t> last_access;
+
+    // number of fills and hits so far
+    uint64_t access_count;
+
+    // valid mask of a full set (the lowest E bits are set)
+    uint64_t full_mask;
+
+    // replacement policy used to pick a victim line in a full set
+    // (the policy is a SimObject owned by the python side, not by CacheStore)
+    replacement_policy::Base *replacementPolicy;
+
+    // name of the set indexing function
+    std::string indexing_name;
+
+    // maps a block to its set (and tag), owned by CacheStore
+    std::unique_ptr<SetIndexing> indexing;
+
+    // partition that filled every line: owner[set * E + way], -1 if none
+    std::vector<int> owner;
+
+    // ways each partition may fill: way_masks[partition], a block of any other
+    // partition (or of none) may go to any way
+    std::vector<uint64_t> way_masks;
+
+    // compresses the blocks, nullptr to store them uncompressed
+    // (a SimObject owned by the python side, like the replacement policy)
+    compression::Base *compressor;
+
+    // compressed size of every line in bits: comp_bits[set * E + way]
+    std::vector<int> comp_bits;
+
+    // cycles to decompress every line (0 if stored uncompressed): decomp_cycles[set * E + way]
+    std::vector<uint64_t> decomp_cycles;
+
+    // ways holding slot k of a super-block: slot_masks[k]
+    std::vector<uint64_t> slot_masks;
+
+    // number of valid lines filled by each partition: occupancy_count[0] for
+    // the lines of no partition, occupancy_count[partition + 1] otherwise
+    std::vector<uint64_t> occupancy_count;
+
+    /**
+     * @param block_addr block address(aligned)
+     * @param tag filled with the tag of the block (of its super-block)
+     * @return the set of the block (in way 0 for skewed indexing)
+     */
+    int parse(gem5::Addr block_addr, uint64_t &tag) const;
+
+    /**
+     * @param block_addr block address(aligned)
+     * @return slot of the block in its super-block
+     */
+    int slot_of(gem5::Addr block_addr) const
+    { return (block_addr >> this->b) & ((1 << this->c) - 1); }
+
+    /**
+     * @param block_addr block address(aligned)
+     * @param set the set of the block returned by parse()
+     * @param way a physical way
+     * @return the set the block maps to in that physical way
+     */
+    int set_in(gem5::Addr block_addr, int set, int way) const;
+
+    /**
+     * @param set a set
+     * @param way a physical way of the set
+     * @param slot slot of the block in its super-block
+     * @param tag tag of the block
+     * @param size_bits compressed size of the block
+     * @return true if the block can go to the physical way: the way is empty,
+     *         or it holds other blocks of the super-block and all of them
+     *         (the block included) are compressed enough to share it
+     */
+    bool fits(int set, int way, int slot, uint64_t tag, int size_bits) const;
+
+    /**
+     * @param block_addr block address(aligned)
+     * @param set filled with the set of the line holding the block, or the
+     *        set of the block (in way 0) on a miss
+     * @return the way of the line holding the block, -1 if not found
+     */
+    int lookup(gem5::Addr block_addr, int &set) const;
+
+    /**
+     * @param block_addr block address(aligned)
+     * @param set the set of the block returned by parse()
+     * @param way a way
+     * @return index (set * E + way) of the line the block goes to in that way
+     */
+    int line_of(gem5::Addr block_addr, int set, int way) const;
+
+    /**
+     * count the line (set * E + way) out of the occupancy of its owner,
+     * before it is invalidated
+     * @param i index of a valid line
+     */
+    void release(int i);
+
+    /**
+     * rebuild the occupancy of every partition from the owner of the valid lines
+     */
+    void recount();
+
+    /**
+     * @return index of the partition in occupancy_count
+     */
+    int partition_index(int partition) const;
 
   public:
-    CacheStore(int s, int E, int b);
+    // where a lookup landed, for the per-set statistics of the caller
+    struct AccessInfo
+    {
+      // set of the address
+      int set;
+      // way of the line found, -1 on a miss
+      int way;
+      // number of other lines of the set accessed since the line found was
+      // last accessed (0 for the most recently used line), -1 on a miss
+      int stack_distance;
+      // cycles to decompress the line found, 0 if it is stored uncompressed
+      Cycles decompression_latency;
+    };
+
+    /**
+     * @param indexing_name name of the set indexing function (see SetIndexing::create)
+     * @param compressor compresses the blocks, nullptr to store them uncompressed
+     * @param c up to C = 2 ^ c compressed blocks of a super-block share a physical way
+     */
+    CacheStore(int s, int E, int b, replacement_policy::Base *rp,
+               const std::string &indexing_name = "SetAssociative",
+               compression::Base *compressor = nullptr, int c = 0);
 
     ~CacheStore();
 
     /**
      * @param block_addr get block address(aligned), and find the content in cache
+     * @param info if not nullptr, filled with where the lookup landed
+     * @param pkt the packet accessing the block, passed on to the replacement policy
      * @return std::pair<gem5::Addr, uint8_t * > bytes stored in block_addr
      */
-    std::pair<gem5::Addr, uint8_t *> find(Addr block_addr);
+    std::pair<gem5::Addr, uint8_t *> find(Addr block_addr, const PacketPtr pkt,
+                                          AccessInfo *info = nullptr);
+
+    /**
+     * look a block up without touching its replacement state
+     * @param block_addr block address(aligned)
+     * @return the data block of the line holding the block, nullptr if not present
+     */
+    uint8_t *data_of(gem5::Addr block_addr) const;
+
+    /**
+     * @param address any address inside the block
+     * @return the set the block maps to (in way 0 for skewed indexing)
+     */
+    int set_of(gem5::Addr address) const;
+
+    /**
+     * @return number of sets
+     */
+    int num_sets() const { return 1 << this->s; }
+
+    /**
+     * @return number of lines per set (slots of the super-blocks with compression)
+     */
+    int assoc() const { return this->E; }
+
+    /**
+     * @return number of physical lines
+     */
+    int num_lines() const { return (1 << this->s) * (this->E >> this->c); }
+
+    /**
+     * @return number of blocks held (more than num_lines() with compression)
+     */
+    uint64_t num_blocks() const;
+
+    /**
+     * @param data a block
+     * @param decomp_lat filled with the cycles to decompress it, 0 if it is
+     *        stored uncompressed
+     * @return size of the block once compressed, in bits (B * 8 without a
+     *         compressor or if it does not compress well)
+     */
+    int compress(const uint8_t *data, Cycles &decomp_lat);
+
+    /**
+     * compress a line again once it has been written
+     * @param block_addr block address(aligned) of a line present in CacheStore
+     * @return the blocks sharing its physical way that have to be evicted, as
+     *         the line does not compress well enough any more
+     */
+    std::vector<gem5::Addr> recompress(gem5::Addr block_addr);
 
     /**
      * @param address block address(aligned), the starting address of the block to be stored
-     * @param data the data content of memory to be stored inside the cache
+     * @param pkt the packet filling the block, passed on to the replacement policy
+     * @param partition the partition filling the block (-1 for none), it only
+     *        fills the ways of its mask
+     * @param size_bits compressed size of the block from compress() (-1 for uncompressed)
+     * @param decomp_lat cycles to decompress the block from compress()
+     * @return the data block (inside the arena) the content of memory should be copied into
+     */
+    uint8_t *set(gem5::Addr address, const PacketPtr pkt, int partition = -1,
+                 int size_bits = -1, Cycles decomp_lat = Cycles(0));
+
+    /**
+     * mark the line holding the block as modified (the line must be present)
+     * @param block_addr block address(aligned) of the line written
+     * @return none
+     */
+    void set_dirty(gem5::Addr block_addr);
+
+    /**
+     * @param block_addr block address(aligned) of a line present in CacheStore
+     * @return true if the line has been written since it was set
+     */
+    bool is_dirty(gem5::Addr block_addr);
+
+    /**
+     * mark the line holding the block as prefetched (or used), the line must be present
+     * @param block_addr block address(aligned) of the line
+     * @param prefetched true for a line filled by a prefetch, false once a
+     *        demand access has used it
+     * @return none
+     */
+    void set_prefetched(gem5::Addr block_addr, bool prefetched);
+
+    /**
+     * @param block_addr block address(aligned)
+     * @return true if the block is present, was prefetched and has not been
+     *         used by a demand access yet
+     */
+    bool is_prefetched(gem5::Addr block_addr) const;
+
+    /**
+     * @param first true to victimize the unused prefetched lines before any
+     *        other line (they are inserted with the lowest priority)
      * @return none
      */
-    void set(gem5::Addr address, uint8_t *data);
+    void set_prefetched_first(bool first) { this->prefetched_first = first; }
 
     /**
      * @param address for the given address, the function checks whether the corresponding set is full
+     * @param partition only the ways of the mask of this partition count (-1 for all ways)
+     * @param size_bits compressed size of the block (-1 for uncompressed)
      * @return true means the set is full and involves replacement policy
      */
-    bool isFull(gem5::Addr address);
+    bool isFull(gem5::Addr address, int partition = -1, int size_bits = -1);
 
     /**
      * the address should be pre-determined and is not the packet address to be inserted
@@ -93,28 +357,103 @@ namespace gem5
      */
     void erase(gem5::Addr address);
 
+    /**
+     * mark the line holding the block as clean again, once memory has the data
+     * @param block_addr block address(aligned) of a line present in CacheStore
+     * @return none
+     */
+    void clean(gem5::Addr block_addr);
+
+    /**
+     * visit every valid line, set by set
+     * @param visit called with the block address, the data block and the dirty bit
+     * @return none
+     */
+    void for_each_line(const std::function<void(gem5::Addr, uint8_t *, bool)> &visit);
+
+    /**
+     * erase every line (dirty data is dropped, write it back first)
+     * @return none
+     */
+    void invalidate_all();
+
     /**
      * @param address should be the address of a new packet to be inserted into CacheStore
-     * @return std::pair<gem5::Addr, uint8_t * > the line picked to be replaced
+     * @param partition the victim is picked among the ways of the mask of this
+     *        partition (-1 for all ways)
+     * With compression, evicting the line may not make enough room: the
+     * caller picks lines until isFull() is false
+     * @return std::pair<gem5::Addr, uint8_t * > the line picked to be replaced, the data
+     *         block is borrowed from the arena and is only valid until the line is set again
+     */
+    std::pair<gem5::Addr, uint8_t *> pick_line(gem5::Addr address, int partition = -1);
+
+    /**
+     * @return combine the tag and the position of a line into the gem5 address
+     *         of its block
      */
-    std::pair<gem5::Addr, uint8_t *> pick_line(gem5::Addr address);
+    gem5::Addr combine(uint64_t tag, int set, int way);
 
     /**
-     * @return combine three parameters into the gem5 address
+     * @return the data block of the line (set, way) inside the arena
      */
-    gem5::Addr combine(uint64_t tag, int set, int block);
+    uint8_t *block_of(int set, int way) const
+    { return this->arena + ((size_t)(set * this->E + way) << this->b); }
 
     /**
-     * @param lines the set where we choose a cache line from
-     * @return the line number we choose based on the LRU replacement policy
+     * @param address the block to make room for
+     * @param partition only the ways of the mask of this partition are candidates
+     * @return the line chosen by the replacement policy among the lines
+     *         the block could go to. With compression the policy chooses among
+     *         the super-blocks (through their most recently used line), and the
+     *         least recently used line of the super-block chosen is returned.
+     *         With set_prefetched_first(true), only the unused prefetched
+     *         lines are candidates if there is any
      */
-    int policy_LRU(cache_line *lines);
+    ReplaceableEntry *pick_victim(gem5::Addr address, int partition = -1);
 
     /**
-     * @param lines the set where we choose a cache line from
-     * @return the line number we choose based on the FIFO replacement policy
+     * restrict the ways each partition fills (way partitioning), lookups still
+     * hit in every way. Lines already outside the new masks stay until evicted
+     * @param masks one mask per partition (bit i stands for physical way i), none empty
      */
-    int policy_FIFO(cache_line *lines);
+    void set_way_masks(const std::vector<uint64_t> &masks);
+
+    /**
+     * @return the ways the partition may fill, every way for -1 or a
+     *         partition without a mask
+     */
+    uint64_t way_mask(int partition) const;
+
+    /**
+     * @return number of valid lines filled by the partition, or by no
+     *         partition (nor one without a mask) for -1
+     */
+    uint64_t occupancy(int partition) const;
+
+    /**
+     * Compare the tag against every way of the set at once (SIMD when the
+     * host supports it), only valid lines can match
+     * @param set the set to search
+     * @param tag the tag to look for
+     * @return bitmask of the matching ways (bit i stands for way i)
+     */
+    uint64_t match_tag(int set, uint64_t tag) const;
+
+    /**
+     * write the tags, valid, dirty and prefetched bits and access order into the checkpoint,
+     * the data of the valid lines goes to a compressed side file
+     * @param cp the checkpoint section of CacheStore
+     */
+    void serialize(CheckpointOut &cp) const override;
+
+    /**
+     * restore the lines from the checkpoint and rebuild the replacement state
+     * by replaying the accesses in their original order
+     * @param cp the checkpoint section of CacheStore
+     */
+    void unserialize(CheckpointIn &cp) override;
+
     /**
      * For debugging...
      * @param set print out the info about all the lines in this set
@@ -0,0 +1,167 @@
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "learning_gem5/part2/CacheStore/cache_store.hh"
+#include "mem/cache/compressors/perfect.hh"
+#include "mem/cache/replacement_policies/lru_rp.hh"
+#include "params/LRURP.hh"
+#include "params/PerfectCompressor.hh"
+#include "sim/eventq.hh"
+#include "sim/serialize.hh"
+
+using namespace gem5;
+
+namespace
+{
+
+  /**
+   * a CacheStore of 64-byte blocks, 16 sets and 2 ways of super-blocks of
+   * (1 << c) blocks, built without the python side
+   */
+  class CacheStoreTest : public testing::TestWithParam<std::string>
+  {
+    protected:
+      LRURPParams rp_params;
+      PerfectCompressorParams compressor_params;
+      std::unique_ptr<replacement_policy::LRU> rp;
+      std::unique_ptr<compression::Perfect> compressor;
+
+      CacheStoreTest()
+      {
+        // the lines remember the tick they are filled at
+        curEventQueue(getEventQueue(0));
+
+        rp_params.name = "rp";
+        rp_params.eventq_index = 0;
+        rp.reset(new replacement_policy::LRU(rp_params));
+
+        compressor_params.name = "compressor";
+        compressor_params.eventq_index = 0;
+        compressor_params.block_size = 64;
+        compressor_params.chunk_size_bits = 64;
+        compressor_params.size_threshold_percentage = 50;
+        compressor_params.comp_chunks_per_cycle = 8;
+        compressor_params.decomp_chunks_per_cycle = 8;
+        compressor_params.max_compression_ratio = 2;
+        compressor.reset(new compression::Perfect(compressor_params));
+      }
+
+      std::unique_ptr<CacheStore> make_store(int c)
+      {
+        return std::make_unique<CacheStore>(4, 2, 6, rp.get(), GetParam(),
+                                            compressor.get(), c);
+      }
+  };
+
+} // anonymous namespace
+
+/**
+ * set_of() must give the set find() looks the block up in, from any address
+ * of the block, whatever the size of the super-blocks
+ */
+TEST_P(CacheStoreTest, SetOfMatchesFind)
+{
+  for (int c = 0; c <= 2; c++)
+  {
+    auto store = make_store(c);
+    for (Addr block_addr = 0; block_addr < 0x10000; block_addr += 64)
+    {
+      CacheStore::AccessInfo info;
+      store->find(block_addr, nullptr, &info);
+      ASSERT_EQ(store->set_of(block_addr), info.set) << "c " << c;
+      ASSERT_EQ(store->set_of(block_addr + 63), info.set) << "c " << c;
+    }
+  }
+}
+
+/** The blocks of a super-block share its set */
+TEST_P(CacheStoreTest, SuperBlockInOneSet)
+{
+  auto store = make_store(2);
+  for (Addr super_block = 0; super_block < 0x10000; super_block += 256)
+  {
+    for (Addr offset = 64; offset < 256; offset += 64)
+      ASSERT_EQ(store->set_of(super_block + offset), store->set_of(super_block));
+  }
+}
+
+/**
+ * The tag match finds every block of a full set, and only these, whatever
+ * compare the host runs (6 ways: a 4-way and a 2-way compare with AVX2)
+ */
+TEST_P(CacheStoreTest, TagMatch)
+{
+  CacheStore store(4, 6, 6, rp.get(), GetParam());
+  // blocks with the tags 0 to 9 in set 5 (for set associative indexing)
+  auto block_of = [](int i) { return (Addr)(i << 10 | 5 << 6); };
+  for (int i = 0; i < 6; i++)
+    store.set(block_of(i), nullptr);
+
+  for (int i = 0; i < 10; i++)
+  {
+    if (store.set_of(block_of(i)) != store.set_of(block_of(0)))
+      continue;
+    CacheStore::AccessInfo info;
+    auto res = store.find(block_of(i), nullptr, &info);
+    ASSERT_EQ(res.second != nullptr, i < 6) << "block " << i;
+    if (i < 6)
+    {
+      ASSERT_EQ(res.second, store.data_of(block_of(i)));
+    }
+  }
+}
+
+/**
+ * A restored store evicts its lines in the order the original one would,
+ * without the restore moving the simulated time
+ */
+TEST_P(CacheStoreTest, RestoreKeepsRecency)
+{
+  EventQueue *eventq = curEventQueue();
+  auto store = make_store(0);
+
+  // three blocks of a set, the first two fill it
+  std::vector<Addr> blocks;
+  for (int i = 0; blocks.size() < 3; i++)
+  {
+    Addr block = (Addr)(i << 10 | 5 << 6);
+    if (blocks.empty() || store->set_of(block) == store->set_of(blocks[0]))
+      blocks.push_back(block);
+  }
+  eventq->setCurTick(10);
+  store->set(blocks[0], nullptr);
+  eventq->setCurTick(20);
+  store->set(blocks[1], nullptr);
+  eventq->setCurTick(30);
+  store->find(blocks[0], nullptr);
+
+  std::ofstream cpt_out;
+  Serializable::generateCheckpointOut(
+      testing::TempDir() + "cache_store_cpt_" + GetParam(), cpt_out);
+  store->serializeSection(cpt_out, "store");
+  cpt_out.close();
+
+  eventq->setCurTick(100);
+  auto restored = make_store(0);
+  CheckpointIn cpt_in(CheckpointIn::dir());
+  restored->unserializeSection(cpt_in, "store");
+  Tick restored_at = curTick();
+  Addr victim = restored->pick_line(blocks[2]).first;
+
+  std::remove((CheckpointIn::dir() + CheckpointIn::baseFilename).c_str());
+  std::remove((CheckpointIn::dir() + "store.arena.gz").c_str());
+  rmdir(CheckpointIn::dir().c_str());
+
+  ASSERT_EQ(restored_at, 100);
+  ASSERT_EQ(victim, blocks[1]);
+}
+
+INSTANTIATE_TEST_SUITE_P(Indexing, CacheStoreTest,
+                         testing::Values("SetAssociative", "XORFold",
+                                         "PrimeModulo"));
@@ -0,0 +1,624 @@
+#include <fcntl.h>
+#include <getopt.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "base/logging.hh"
+#include "base/types.hh"
+#include "config/have_protobuf.hh"
+#include "learning_gem5/part2/CacheStore/cache_store.hh"
+#include "learning_gem5/part2/CacheStore/replacement_policy_defaults.hh"
+#include "learning_gem5/part2/CacheStore/set_indexing.hh"
+#include "mem/cache/replacement_policies/bip_rp.hh"
+#include "mem/cache/replacement_policies/brrip_rp.hh"
+#include "mem/cache/replacement_policies/fifo_rp.hh"
+#include "mem/cache/replacement_policies/lfu_rp.hh"
+#include "mem/cache/replacement_policies/lru_rp.hh"
+#include "mem/cache/replacement_policies/mru_rp.hh"
+#include "mem/cache/replacement_policies/random_rp.hh"
+#include "mem/cache/replacement_policies/second_chance_rp.hh"
+#include "mem/cache/replacement_policies/ship_rp.hh"
+#include "mem/cache/replacement_policies/tree_plru_rp.hh"
+#include "mem/packet.hh"
+#include "mem/request.hh"
+#include "sim/eventq.hh"
+
+#if HAVE_PROTOBUF
+#include "proto/packet.pb.h"
+#include "proto/protoio.hh"
+#endif
+
+// cache_store_sim: replay a memory trace through many CacheStore configurations
+// ***************************************************************
+// ** TRACE:  a gem5 packet trace (MemTraceProbe protobuf,       **
+// **         gzipped or not) or its ASCII dump written by       **
+// **         util/decode_packet_trace.py                        **
+// ** REPLAY: the trace is converted once into 8-byte records    **
+// **         (address with bit 0 as the write bit) in a replay  **
+// **         file, memory-mapped and shared by every thread     **
+// ** CONFIG: s,E,b,policy[,indexing], one CacheStore each, the  **
+// **         threads take the configurations one at a time and  **
+// **         each replays the whole trace through its own       **
+// ** CURVE:  s_min:s_max,E_max,b[,indexing], the LRU hit ratios **
+// **         of every s in the range and every E up to E_max in **
+// **         one pass, from the stack distance of the accesses  **
+// **         in each set (a hit in E ways iff it is below E)    **
+// ***************************************************************
+// only hit rates are modelled: no timing, no MSHRs, and an access is counted
+// once, on the block of its first byte
+//
+// usage: cache_store_sim.opt [-j threads] [-r replay] [-c s,E,b,policy[,indexing] ...]
+//                            [-l s_min:s_max,E_max,b[,indexing] ...] trace
+// (-c and -l may be given many times, -f reads one configuration per line from a file)
+// pass the replay file instead of the trace to skip the conversion next time
+
+namespace gem5
+{
+
+  namespace
+  {
+
+    // first bytes of a replay file, followed by the number of records
+    const char replay_magic[8] = {'C', 'S', 'R', 'E', 'P', 'L', 'A', 'Y'};
+
+    // a replacement policy and the params it keeps a reference to
+    struct PolicyHolder
+    {
+      std::unique_ptr<SimObjectParams> params;
+      std::unique_ptr<replacement_policy::Base> policy;
+    };
+
+    // one CacheStore configuration and what its replay counted
+    struct Config
+    {
+      std::string spec;
+      int s;
+      int E;
+      int b;
+      std::string policy;
+      std::string indexing;
+
+      uint64_t hits = 0;
+      uint64_t misses = 0;
+      uint64_t evictions = 0;
+      uint64_t writebacks = 0;
+      double seconds = 0;
+    };
+
+    // LRU hit ratio curves of a range of set numbers and what their pass counted
+    struct Curve
+    {
+      std::string spec;
+      int s_min;
+      int s_max;
+      int E_max;
+      int b;
+      std::string indexing;
+
+      // accesses per stack distance of every s, distances from E_max on
+      // (and the first accesses to a block) in the last bucket
+      std::vector<std::vector<uint64_t>> distances;
+      double seconds = 0;
+    };
+
+    /**
+     * build a replacement policy without the python side
+     * @param holder filled with the policy and its params
+     * @param defaults sets the defaults of ReplacementPolicies.py, generated
+     *        from it at build time
+     * @param setup sets the parameters without a default, the SimObject ones are set here
+     */
+    template <class Policy, class Params>
+    void build(PolicyHolder &holder, const std::string &name,
+               void (*defaults)(Params &),
+               const std::function<void(Params &)> &setup = nullptr)
+    {
+      Params *params = new Params();
+      params->name = name;
+      params->eventq_index = 0;
+      defaults(*params);
+      if (setup)
+        setup(*params);
+      holder.params.reset(params);
+      holder.policy.reset(new Policy(*params));
+    }
+
+    /**
+     * @param name python name of the policy (LRURP, BRRIPRP...), built with
+     *        the defaults of ReplacementPolicies.py
+     * @param E line number per set, the leaves of TreePLRURP
+     */
+    PolicyHolder make_policy(const std::string &name, int E)
+    {
+      using namespace replacement_policy;
+      PolicyHolder holder;
+
+      if (name == "LRURP")
+        build<LRU>(holder, name, LRURPDefaults);
+      else if (name == "FIFORP")
+        build<FIFO>(holder, name, FIFORPDefaults);
+      else if (name == "SecondChanceRP")
+        build<SecondChance>(holder, name, SecondChanceRPDefaults);
+      else if (name == "LFURP")
+        build<LFU>(holder, name, LFURPDefaults);
+      else if (name == "MRURP")
+        build<MRU>(holder, name, MRURPDefaults);
+      else if (name == "RandomRP")
+        build<replacement_policy::Random>(holder, name, RandomRPDefaults);
+      else if (name == "BIPRP")
+        build<BIP>(holder, name, BIPRPDefaults);
+      else if (name == "LIPRP")
+        build<BIP>(holder, name, LIPRPDefaults);
+      else if (name == "BRRIPRP")
+        build<BRRIP>(holder, name, BRRIPRPDefaults);
+      else if (name == "RRIPRP")
+        build<BRRIP>(holder, name, RRIPRPDefaults);
+      else if (name == "NRURP")
+        build<BRRIP>(holder, name, NRURPDefaults);
+      else if (name == "SHiPMemRP")
+        build<SHiPMem>(holder, name, SHiPMemRPDefaults);
+      else if (name == "TreePLRURP")
+        build<TreePLRU, TreePLRURPParams>(holder, name, TreePLRURPDefaults,
+                                          [E](TreePLRURPParams &p) { p.num_leaves = E; });
+      else
+        fatal("unknown replacement policy %s, expected one of LRURP FIFORP SecondChanceRP "
+              "LFURP MRURP RandomRP BIPRP LIPRP BRRIPRP RRIPRP NRURP SHiPMemRP TreePLRURP", name);
+      return holder;
+    }
+
+    /**
+     * @param spec s,E,b,policy[,indexing]
+     */
+    Config parse_config(const std::string &spec)
+    {
+      Config config;
+      config.spec = spec;
+      config.indexing = "SetAssociative";
+
+      std::vector<std::string> fields;
+      std::stringstream stream(spec);
+      std::string field;
+      while (std::getline(stream, field, ','))
+        fields.push_back(field);
+      fatal_if(fields.size() != 4 && fields.size() != 5,
+               "configuration '%s' should be s,E,b,policy[,indexing]", spec);
+
+      config.s = std::stoi(fields[0]);
+      config.E = std::stoi(fields[1]);
+      config.b = std::stoi(fields[2]);
+      config.policy = fields[3];
+      if (fields.size() == 5)
+        config.indexing = fields[4];
+      // bit 0 of a record is the write bit, it is never part of a block address
+      fatal_if(config.b < 1 || config.b > 12, "configuration '%s': b should be within [1, 12]", spec);
+      fatal_if(config.s < 0 || config.s > 24, "configuration '%s': s should be within [0, 24]", spec);
+      return config;
+    }
+
+    /**
+     * @param spec s_min:s_max,E_max,b[,indexing] or s,E_max,b[,indexing]
+     */
+    Curve parse_curve(const std::string &spec)
+    {
+      Curve curve;
+      curve.spec = spec;
+      curve.indexing = "SetAssociative";
+
+      std::vector<std::string> fields;
+      std::stringstream stream(spec);
+      std::string field;
+      while (std::getline(stream, field, ','))
+        fields.push_back(field);
+      fatal_if(fields.size() != 3 && fields.size() != 4,
+               "curve '%s' should be s_min:s_max,E_max,b[,indexing]", spec);
+
+      size_t colon = fields[0].find(':');
+      curve.s_min = std::stoi(fields[0].substr(0, colon));
+      curve.s_max = (colon == std::string::npos) ? curve.s_min : std::stoi(fields[0].substr(colon + 1));
+      curve.E_max = std::stoi(fields[1]);
+      curve.b = std::stoi(fields[2]);
+      if (fields.size() == 4)
+        curve.indexing = fields[3];
+      fatal_if(curve.s_min < 0 || curve.s_max > 24 || curve.s_min > curve.s_max,
+               "curve '%s': s should be a range within [0, 24]", spec);
+      fatal_if(curve.E_max < 1 || curve.E_max > 64, "curve '%s': E should be within [1, 64]", spec);
+      fatal_if(curve.b < 1 || curve.b > 12, "curve '%s': b should be within [1, 12]", spec);
+      // a block maps to one set whatever the associativity, except with skewing
+      std::unique_ptr<SetIndexing> indexing(SetIndexing::create(curve.indexing, curve.s_min, curve.E_max));
+      fatal_if(indexing->skewed(), "curve '%s': skewed caches have no stack property", spec);
+      return curve;
+    }
+
+    /**
+     * convert a trace into a replay file
+     * @param trace a protobuf packet trace or its ASCII dump
+     * @param replay the replay file to write
+     */
+    void convert(const std::string &trace, const std::string &replay)
+    {
+      FILE *out = std::fopen(replay.c_str(), "wb");
+      fatal_if(out == nullptr, "cannot open replay file '%s'", replay);
+
+      // step 01: the header, the count is written once known
+      uint64_t count = 0;
+      std::fwrite(replay_magic, sizeof(replay_magic), 1, out);
+      std::fwrite(&count, sizeof(count), 1, out);
+
+      std::vector<uint64_t> buffer;
+      buffer.reserve(1 << 16);
+      auto emit = [&](Addr addr, bool write)
+      {
+        buffer.push_back((addr & ~(Addr)1) | (write ? 1 : 0));
+        if (buffer.size() == buffer.capacity())
+        {
+          std::fwrite(buffer.data(), sizeof(uint64_t), buffer.size(), out);
+          count += buffer.size();
+          buffer.clear();
+        }
+      };
+
+      // step 02: the records, reads and writes only
+      unsigned char magic[4] = {0, 0, 0, 0};
+      std::ifstream probe(trace, std::ios::binary);
+      fatal_if(!probe, "cannot open trace '%s'", trace);
+      probe.read((char *)magic, sizeof(magic));
+      probe.close();
+      bool protobuf = std::memcmp(magic, "gem5", 4) == 0 || (magic[0] == 0x1f && magic[1] == 0x8b);
+
+      if (protobuf)
+      {
+#if HAVE_PROTOBUF
+        ProtoInputStream input(trace);
+        ProtoMessage::PacketHeader header;
+        fatal_if(!input.read(header), "cannot read the packet header of '%s'", trace);
+        ProtoMessage::Packet pkt_msg;
+        while (input.read(pkt_msg))
+        {
+          MemCmd cmd((int)pkt_msg.cmd());
+          if (cmd.isRead() || cmd.isWrite())
+            emit(pkt_msg.addr(), cmd.isWrite());
+        }
+#else
+        fatal("'%s' is a protobuf trace, but gem5 was built without protobuf: "
+              "convert it with util/decode_packet_trace.py first", trace);
+#endif
+      }
+      else
+      {
+        // [id,]cmd,addr,size,... with cmd r, w or u (neither)
+        FILE *input = std::fopen(trace.c_str(), "r");
+        fatal_if(input == nullptr, "cannot open trace '%s'", trace);
+        char line[256];
+        while (std::fgets(line, sizeof(line), input) != nullptr)
+        {
+          const char *cmd = line;
+          if (*cmd >= '0' && *cmd <= '9')
+          {
+            cmd = std::strchr(line, ',');
+            if (cmd == nullptr)
+              continue;
+            cmd++;
+          }
+          if ((*cmd != 'r' && *cmd != 'w') || cmd[1] != ',')
+            continue;
+          emit(std::strtoull(cmd + 2, nullptr, 0), *cmd == 'w');
+        }
+        std::fclose(input);
+      }
+
+      std::fwrite(buffer.data(), sizeof(uint64_t), buffer.size(), out);
+      count += buffer.size();
+      std::fseek(out, sizeof(replay_magic), SEEK_SET);
+      std::fwrite(&count, sizeof(count), 1, out);
+      fatal_if(std::fclose(out) != 0, "cannot write replay file '%s'", replay);
+
+      std::cerr << "converted " << count << " accesses of " << trace << " into " << replay << std::endl;
+    }
+
+    /**
+     * @param path a file
+     * @return true if it is a replay file
+     */
+    bool is_replay(const std::string &path)
+    {
+      char magic[sizeof(replay_magic)];
+      std::ifstream input(path, std::ios::binary);
+      return input.read(magic, sizeof(magic)) && std::memcmp(magic, replay_magic, sizeof(magic)) == 0;
+    }
+
+    /**
+     * replay the records through a CacheStore of the configuration
+     * @param rp replacement policy of the configuration, used by no other thread
+     * @param eq event queue of the thread, its tick advances with every access
+     *        so that the recency based policies see the order of the accesses
+     */
+    void replay(Config &config, replacement_policy::Base *rp, const uint64_t *records,
+                uint64_t count, EventQueue *eq)
+    {
+      CacheStore store(config.s, config.E, config.b, rp, config.indexing);
+
+      // one packet for every access, as the policies only look at its address
+      RequestPtr req = std::make_shared<Request>(0, 1 << config.b, 0, 0);
+      Packet pkt(req, MemCmd::ReadReq);
+      Addr block_mask = ~(Addr)((1 << config.b) - 1);
+
+      auto start = std::chrono::steady_clock::now();
+      for (uint64_t i = 0; i < count; i++)
+      {
+        Addr block_addr = records[i] & block_mask;
+        bool write = records[i] & 1;
+        eq->setCurTick(i + 1);
+        pkt.setAddr(block_addr);
+        pkt.cmd = write ? MemCmd::WriteReq : MemCmd::ReadReq;
+
+        // step 01: a hit only updates the replacement state
+        if (store.find(block_addr, &pkt).second != nullptr)
+        {
+          config.hits++;
+        }
+        else
+        {
+          // step 02: a miss evicts the victim of a full set, and fills the block
+          config.misses++;
+          if (store.isFull(block_addr))
+          {
+            Addr victim = store.pick_line(block_addr).first;
+            config.evictions++;
+            config.writebacks += store.is_dirty(victim);
+            store.erase(victim);
+          }
+          store.set(block_addr, &pkt);
+        }
+
+        if (write)
+          store.set_dirty(block_addr);
+      }
+      config.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    /**
+     * one pass of the records through an LRU stack of E_max blocks per set for
+     * every set number of the curve: a block found at depth d of its stack hits
+     * in the caches of more than d lines per set
+     */
+    void trace_curve(Curve &curve, const uint64_t *records, uint64_t count)
+    {
+      int n = curve.s_max - curve.s_min + 1;
+      const int E = curve.E_max;
+      std::vector<std::unique_ptr<SetIndexing>> indexing;
+      // the stack of a set of the k-th set number is stacks[k][set * E, set * E + depth[k][set]),
+      // most recently used first. The stacks are mapped without a reservation, so
+      // that only the pages of the sets the trace accesses ever take memory
+      std::vector<uint64_t *> stacks;
+      std::vector<size_t> stack_bytes;
+      std::vector<std::vector<uint8_t>> depth;
+      curve.distances.assign(n, std::vector<uint64_t>(E + 1, 0));
+      for (int k = 0; k < n; k++)
+      {
+        size_t sets = (size_t)1 << (curve.s_min + k);
+        indexing.emplace_back(SetIndexing::create(curve.indexing, curve.s_min + k, E));
+        stack_bytes.push_back(sets * E * sizeof(uint64_t));
+        void *stack = mmap(nullptr, stack_bytes[k], PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        fatal_if(stack == MAP_FAILED, "curve '%s': cannot map the LRU stacks of 2^%d sets",
+                 curve.spec, curve.s_min + k);
+        stacks.push_back((uint64_t *)stack);
+        depth.emplace_back(sets, 0);
+      }
+
+      auto start = std::chrono::steady_clock::now();
+      for (uint64_t i = 0; i < count; i++)
+      {
+        uint64_t block_number = records[i] >> curve.b;
+        for (int k = 0; k < n; k++)
+        {
+          int set = indexing[k]->set_of(block_number, 0);
+          uint64_t *stack = stacks[k] + (size_t)set * E;
+          int size = depth[k][set];
+          int d = 0;
+          while (d < size && stack[d] != block_number)
+            d++;
+          // a miss in every cache of the curve, the least recently used block
+          // falls off a full stack
+          curve.distances[k][d < size ? d : E]++;
+          if (d == size)
+          {
+            if (size < E)
+              depth[k][set]++;
+            else
+              d = E - 1;
+          }
+          for (; d > 0; d--)
+            stack[d] = stack[d - 1];
+          stack[0] = block_number;
+        }
+      }
+      curve.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+      for (int k = 0; k < n; k++)
+        munmap(stacks[k], stack_bytes[k]);
+    }
+
+    void usage(const char *program)
+    {
+      std::cerr << "usage: " << program << " [-j threads] [-r replay] [-c s,E,b,policy[,indexing] ...] "
+                << "[-l s_min:s_max,E_max,b[,indexing] ...] [-f configs] trace" << std::endl
+                << "  -c  a CacheStore configuration: 2^s sets of E lines of 2^b bytes, the" << std::endl
+                << "      python name of the replacement policy and the set indexing function" << std::endl
+                << "      (SetAssociative, SkewedAssociative, XORFold or PrimeModulo)" << std::endl
+                << "  -l  LRU hit ratios of 2^s sets, s in [s_min, s_max], of 1 to E_max lines" << std::endl
+                << "      of 2^b bytes in a single pass" << std::endl
+                << "  -f  a file with one configuration per line (# starts a comment)" << std::endl
+                << "  -j  number of threads (default: one per host thread)" << std::endl
+                << "  -r  replay file to write (default: trace.replay)" << std::endl;
+      std::exit(1);
+    }
+
+  }
+
+}
+
+int main(int argc, char **argv)
+{
+  using namespace gem5;
+
+  // step 01: the options
+  std::vector<Config> configs;
+  std::vector<Curve> curves;
+  unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+  std::string replay_path;
+  int opt;
+  while ((opt = getopt(argc, argv, "c:f:j:l:r:h")) != -1)
+  {
+    switch (opt)
+    {
+    case 'c':
+      configs.push_back(parse_config(optarg));
+      break;
+    case 'f':
+    {
+      std::ifstream input(optarg);
+      fatal_if(!input, "cannot open configuration file '%s'", optarg);
+      std::string line;
+      while (std::getline(input, line))
+      {
+        line = line.substr(0, line.find('#'));
+        line.erase(0, line.find_first_not_of(" \t"));
+        line.erase(line.find_last_not_of(" \t\r") + 1);
+        if (!line.empty())
+          configs.push_back(parse_config(line));
+      }
+      break;
+    }
+    case 'l':
+      curves.push_back(parse_curve(optarg));
+      break;
+    case 'j':
+      threads = std::max(1, std::atoi(optarg));
+      break;
+    case 'r':
+      replay_path = optarg;
+      break;
+    default:
+      usage(argv[0]);
+    }
+  }
+  if (optind != argc - 1 || (configs.empty() && curves.empty()))
+    usage(argv[0]);
+
+  // step 02: the replay file, converted from the trace if needed
+  std::string trace = argv[optind];
+  if (is_replay(trace))
+  {
+    replay_path = trace;
+  }
+  else
+  {
+    if (replay_path.empty())
+      replay_path = trace + ".replay";
+    convert(trace, replay_path);
+  }
+
+  int fd = open(replay_path.c_str(), O_RDONLY);
+  fatal_if(fd < 0, "cannot open replay file '%s'", replay_path);
+  struct stat st;
+  fatal_if(fstat(fd, &st) != 0, "cannot stat replay file '%s'", replay_path);
+  void *map = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  fatal_if(map == MAP_FAILED, "cannot map replay file '%s'", replay_path);
+  close(fd);
+  madvise(map, st.st_size, MADV_SEQUENTIAL | MADV_WILLNEED);
+
+  uint64_t count;
+  std::memcpy(&count, (const char *)map + sizeof(replay_magic), sizeof(count));
+  fatal_if(sizeof(replay_magic) + sizeof(count) + count * sizeof(uint64_t) > (uint64_t)st.st_size,
+           "replay file '%s' is truncated", replay_path);
+  const uint64_t *records = (const uint64_t *)((const char *)map + sizeof(replay_magic) + sizeof(count));
+
+  // step 03: the threads, each with an event queue of its own for curTick().
+  // The policies are SimObjects and the queues are created here, once, as
+  // neither can be created concurrently
+  size_t tasks = configs.size() + curves.size();
+  threads = std::min<unsigned>(threads, tasks);
+  curEventQueue(getEventQueue(0));
+  std::vector<EventQueue *> queues;
+  for (unsigned t = 0; t < threads; t++)
+    queues.push_back(getEventQueue(t + 1));
+  std::vector<PolicyHolder> policies;
+  for (const Config &config : configs)
+    policies.push_back(make_policy(config.policy, config.E));
+
+  // the policies draw from generators of their own, so that the results
+  // do not depend on the threads. The curves come after the configurations
+  std::atomic<size_t> next(0);
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> workers;
+  for (unsigned t = 0; t < threads; t++)
+  {
+    workers.emplace_back([&, t]()
+    {
+      curEventQueue(queues[t]);
+      for (size_t i = next++; i < tasks; i = next++)
+      {
+        if (i >= configs.size())
+        {
+          trace_curve(curves[i - configs.size()], records, count);
+        }
+        else
+        {
+          replay(configs[i], policies[i].policy.get(), records, count, queues[t]);
+        }
+      }
+    });
+  }
+  for (auto &worker : workers)
+    worker.join();
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  // step 04: one CSV line per configuration, in the order given, then the curves
+  std::cout << "config,s,E,b,policy,indexing,accesses,hits,misses,hit_ratio,evictions,"
+            << "writebacks,seconds,maccesses_per_second" << std::endl;
+  for (const Config &config : configs)
+  {
+    std::cout << "\"" << config.spec << "\"," << config.s << "," << config.E << "," << config.b << ","
+              << config.policy << "," << config.indexing << "," << count << "," << config.hits << ","
+              << config.misses << "," << (count ? (double)config.hits / count : 0) << ","
+              << config.evictions << "," << config.writebacks << "," << config.seconds << ","
+              << (config.seconds > 0 ? count / config.seconds / 1e6 : 0) << std::endl;
+  }
+  // a curve has a line per (s, E), the LRU evictions and writebacks are not tracked
+  for (const Curve &curve : curves)
+  {
+    for (int k = 0; k <= curve.s_max - curve.s_min; k++)
+    {
+      uint64_t hits = 0;
+      for (int E = 1; E <= curve.E_max; E++)
+      {
+        hits += curve.distances[k][E - 1];
+        std::cout << "\"" << curve.spec << "\"," << curve.s_min + k << "," << E << "," << curve.b
+                  << ",LRURP," << curve.indexing << "," << count << "," << hits << "," << count - hits << ","
+                  << (count ? (double)hits / count : 0) << ",,," << curve.seconds << ","
+                  << (curve.seconds > 0 ? count / curve.seconds / 1e6 : 0) << std::endl;
+      }
+    }
+  }
+  std::cerr << configs.size() << " configurations and " << curves.size() << " curves of " << count
+            << " accesses in " << seconds << " s with " << threads << " threads: "
+            << (seconds > 0 ? tasks * count / seconds / 1e6 : 0) << " M accesses/s" << std::endl;
+
+  munmap(map, st.st_size);
+  return 0;
+}
@@ -0,0 +1,184 @@
+#include "learning_gem5/part2/CacheStore/set_indexing.hh"
+
+#include "base/bitfield.hh"
+#include "base/logging.hh"
+
+namespace gem5
+{
+
+  SetIndexing::SetIndexing(int s, int E) : s(s), E(E)
+  {
+    fatal_if(this->s < 0 || this->s >= 32, "set bits should be within [0, 31]");
+    this->set_mask = ((uint64_t)1 << this->s) - 1;
+  }
+
+  SetIndexing *SetIndexing::create(const std::string &name, int s, int E)
+  {
+    if (name == "SetAssociative")
+      return new SetAssociativeIndexing(s, E);
+    if (name == "SkewedAssociative")
+      return new SkewedIndexing(s, E);
+    if (name == "XORFold")
+      return new XORFoldIndexing(s, E);
+    if (name == "PrimeModulo")
+      return new PrimeModuloIndexing(s, E);
+    fatal("unknown set indexing '%s'", name);
+  }
+
+  int SetAssociativeIndexing::set_of(uint64_t block_number, int way) const
+  {
+    return block_number & this->set_mask;
+  }
+
+  uint64_t SetAssociativeIndexing::block_number(uint64_t tag, int set, int way) const
+  {
+    return (tag << this->s) | set;
+  }
+
+  uint64_t XORFoldIndexing::fold(uint64_t tag) const
+  {
+    if (this->s == 0)
+      return 0;
+
+    uint64_t folded = 0;
+    for (; tag != 0; tag >>= this->s)
+      folded ^= tag & this->set_mask;
+    return folded;
+  }
+
+  int XORFoldIndexing::set_of(uint64_t block_number, int way) const
+  {
+    return (block_number & this->set_mask) ^ fold(tag_of(block_number));
+  }
+
+  uint64_t XORFoldIndexing::block_number(uint64_t tag, int set, int way) const
+  {
+    // XOR is its own inverse: the set bits come back by folding the tag again
+    return (tag << this->s) | (set ^ fold(tag));
+  }
+
+  PrimeModuloIndexing::PrimeModuloIndexing(int s, int E) : SetIndexing(s, E)
+  {
+    fatal_if(this->s < 1, "prime modulo indexing needs at least two sets");
+
+    // the largest prime that does not exceed the number of sets
+    for (this->prime = (uint64_t)1 << this->s; this->prime > 2; this->prime--)
+    {
+      bool is_prime = true;
+      for (uint64_t d = 2; d * d <= this->prime && is_prime; d++)
+        is_prime = (this->prime % d) != 0;
+      if (is_prime)
+        break;
+    }
+  }
+
+  int PrimeModuloIndexing::set_of(uint64_t block_number, int way) const
+  {
+    return block_number % this->prime;
+  }
+
+  uint64_t PrimeModuloIndexing::tag_of(uint64_t block_number) const
+  {
+    return block_number / this->prime;
+  }
+
+  uint64_t PrimeModuloIndexing::block_number(uint64_t tag, int set, int way) const
+  {
+    return tag * this->prime + set;
+  }
+
+  SkewedIndexing::SkewedIndexing(int s, int E) : SetIndexing(s, E), msb_shift(s - 1)
+  {
+    if (this->E > NUM_SKEWING_FUNCTIONS)
+      warn_once("Associativity higher than number of skewing functions. "
+                "Expect sub-optimal skewing.\n");
+
+    // with two sets or less, the MSB and LSB are the same bit and the xor of
+    // them is always 0
+    fatal_if(this->s <= 1, "The number of sets must be greater than 2");
+  }
+
+  uint64_t SkewedIndexing::hash(uint64_t addr) const
+  {
+    // shift-off LSB and set new MSB as xor of old LSB and MSB
+    const uint8_t lsb = bits<uint64_t>(addr, 0);
+    const uint8_t msb = bits<uint64_t>(addr, this->msb_shift);
+    return insertBits<uint64_t, uint8_t>(addr >> 1, this->msb_shift, msb ^ lsb);
+  }
+
+  uint64_t SkewedIndexing::dehash(uint64_t addr) const
+  {
+    // the original MSB is one bit away from the current one (the XOR bit), the
+    // original LSB comes back by inverting the xor
+    const uint8_t msb = bits<uint64_t>(addr, this->msb_shift - 1);
+    const uint8_t xor_bit = bits<uint64_t>(addr, this->msb_shift);
+    const uint64_t addr_no_msb = mbits<uint64_t>(addr, this->msb_shift - 1, 0);
+    return insertBits<uint64_t, uint8_t>(addr_no_msb << 1, 0, msb ^ xor_bit);
+  }
+
+  uint64_t SkewedIndexing::skew(uint64_t addr, int way) const
+  {
+    // addr1: the set bits of a conventional cache, addr2: the next s bits
+    uint64_t addr1 = bits<uint64_t>(addr, this->msb_shift, 0);
+    const uint64_t addr2 = bits<uint64_t>(addr, 2 * (this->msb_shift + 1) - 1, this->msb_shift + 1);
+
+    switch (way % NUM_SKEWING_FUNCTIONS)
+    {
+    case 0: addr1 = hash(addr1) ^ hash(addr2) ^ addr2; break;
+    case 1: addr1 = hash(addr1) ^ hash(addr2) ^ addr1; break;
+    case 2: addr1 = hash(addr1) ^ dehash(addr2) ^ addr2; break;
+    case 3: addr1 = hash(addr1) ^ dehash(addr2) ^ addr1; break;
+    case 4: addr1 = dehash(addr1) ^ hash(addr2) ^ addr2; break;
+    case 5: addr1 = dehash(addr1) ^ hash(addr2) ^ addr1; break;
+    case 6: addr1 = dehash(addr1) ^ dehash(addr2) ^ addr2; break;
+    case 7: addr1 = dehash(addr1) ^ dehash(addr2) ^ addr1; break;
+    }
+
+    // more than 8 ways: pile the hashes up
+    for (int i = 0; i < way / NUM_SKEWING_FUNCTIONS; i++)
+      addr1 = hash(addr1);
+
+    return addr1;
+  }
+
+  uint64_t SkewedIndexing::deskew(uint64_t addr, int way) const
+  {
+    uint64_t addr1 = bits<uint64_t>(addr, this->msb_shift, 0);
+    const uint64_t addr2 = bits<uint64_t>(addr, 2 * (this->msb_shift + 1) - 1, this->msb_shift + 1);
+
+    // unpile the hashes of the ways above 8
+    for (int i = 0; i < way / NUM_SKEWING_FUNCTIONS; i++)
+      addr1 = dehash(addr1);
+
+    switch (way % NUM_SKEWING_FUNCTIONS)
+    {
+    case 0: return dehash(addr1 ^ hash(addr2) ^ addr2);
+    case 2: return dehash(addr1 ^ dehash(addr2) ^ addr2);
+    case 4: return hash(addr1 ^ hash(addr2) ^ addr2);
+    case 6: return hash(addr1 ^ dehash(addr2) ^ addr2);
+    case 1:
+    case 3:
+    case 5:
+    case 7:
+    default:
+      // the skewing function XORs addr1 back in, which is undone by hashing
+      // the result again msb_shift times (msb_shift + 1 for dehash)
+      addr1 ^= (way % 4 == 1) ? hash(addr2) : dehash(addr2);
+      for (int i = 0; i < this->msb_shift + (way % 8 >= 4); i++)
+        addr1 = hash(addr1);
+      return addr1;
+    }
+  }
+
+  int SkewedIndexing::set_of(uint64_t block_number, int way) const
+  {
+    return skew(block_number, way) & this->set_mask;
+  }
+
+  uint64_t SkewedIndexing::block_number(uint64_t tag, int set, int way) const
+  {
+    const uint64_t addr_set = (tag << (this->msb_shift + 1)) | set;
+    return (tag << this->s) | (deskew(addr_set, way) & this->set_mask);
+  }
+
+}
@@ -0,0 +1,138 @@
+#ifndef __SET_INDEXING_HH__
+#define __SET_INDEXING_HH__
+
+#include <cstdint>
+#include <string>
+
+// SetIndexing maps a block number (address >> b) to a set of CacheStore:
+// ***************************************************************
+// ** set_of:       block number (and way) -> set                **
+// ** tag_of:       block number -> tag stored in the line       **
+// ** block_number: (tag, set, way) -> block number (inverse)    **
+// ***************************************************************
+// the tag and the set must identify the block, so that CacheStore can give
+// back the address of a victim line without storing it
+
+namespace gem5
+{
+
+  class SetIndexing
+  {
+  protected:
+    // set number: S = 2 ^ s (sets)
+    int s;
+
+    // line number per set: E
+    int E;
+
+    // mask of the lowest s bits
+    uint64_t set_mask;
+
+  public:
+    SetIndexing(int s, int E);
+
+    virtual ~SetIndexing() = default;
+
+    /**
+     * @param block_number the address without the block offset
+     * @param way the way looked up, only skewed indexing depends on it
+     * @return the set the block maps to in that way
+     */
+    virtual int set_of(uint64_t block_number, int way) const = 0;
+
+    /**
+     * @param block_number the address without the block offset
+     * @return the tag stored in the line holding the block
+     */
+    virtual uint64_t tag_of(uint64_t block_number) const { return block_number >> this->s; }
+
+    /**
+     * @param tag the tag of a line
+     * @param set the set of the line
+     * @param way the way of the line
+     * @return the block number the line holds
+     */
+    virtual uint64_t block_number(uint64_t tag, int set, int way) const = 0;
+
+    /**
+     * @return true if a block maps to a different set in each way, so that
+     *         the ways of a lookup are not the ways of one set
+     */
+    virtual bool skewed() const { return false; }
+
+    /**
+     * @param name one of SetAssociative, SkewedAssociative, XORFold, PrimeModulo
+     * @return a new indexing function of that kind, owned by the caller
+     */
+    static SetIndexing *create(const std::string &name, int s, int E);
+  };
+
+  // conventional indexing: the set is the lowest s bits of the block number
+  class SetAssociativeIndexing : public SetIndexing
+  {
+  public:
+    SetAssociativeIndexing(int s, int E) : SetIndexing(s, E) {}
+
+    int set_of(uint64_t block_number, int way) const override;
+    uint64_t block_number(uint64_t tag, int set, int way) const override;
+  };
+
+  // the set bits are XORed with every s-bit chunk of the tag, so that
+  // power-of-two strides spread over all the sets
+  class XORFoldIndexing : public SetIndexing
+  {
+  private:
+    // XOR of all the s-bit chunks of the tag
+    uint64_t fold(uint64_t tag) const;
+
+  public:
+    XORFoldIndexing(int s, int E) : SetIndexing(s, E) {}
+
+    int set_of(uint64_t block_number, int way) const override;
+    uint64_t block_number(uint64_t tag, int set, int way) const override;
+  };
+
+  // the set is the block number modulo the largest prime below 2 ^ s, the
+  // remaining sets are left unused
+  class PrimeModuloIndexing : public SetIndexing
+  {
+  private:
+    // number of sets actually used
+    uint64_t prime;
+
+  public:
+    PrimeModuloIndexing(int s, int E);
+
+    int set_of(uint64_t block_number, int way) const override;
+    uint64_t tag_of(uint64_t block_number) const override;
+    uint64_t block_number(uint64_t tag, int set, int way) const override;
+  };
+
+  // skewed-associative indexing (Seznec), with the skewing functions of
+  // mem/cache/tags/indexing_policies/skewed_associative.cc: each way hashes
+  // the set bits with the lowest tag bits differently
+  class SkewedIndexing : public SetIndexing
+  {
+  private:
+    // number of skewing functions, more ways pile the hash up
+    static const int NUM_SKEWING_FUNCTIONS = 8;
+
+    // position of the most significant set bit
+    int msb_shift;
+
+    uint64_t hash(uint64_t addr) const;
+    uint64_t dehash(uint64_t addr) const;
+    uint64_t skew(uint64_t addr, int way) const;
+    uint64_t deskew(uint64_t addr, int way) const;
+
+  public:
+    SkewedIndexing(int s, int E);
+
+    int set_of(uint64_t block_number, int way) const override;
+    uint64_t block_number(uint64_t tag, int set, int way) const override;
+    bool skewed() const override { return true; }
+  };
+
+}
+
+#endif // __SET_INDEXING_HH__
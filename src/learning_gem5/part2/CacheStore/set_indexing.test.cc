@@ -0,0 +1,73 @@
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "learning_gem5/part2/CacheStore/set_indexing.hh"
+
+using namespace gem5;
+
+namespace
+{
+
+  /**
+   * the first block numbers, the ones around the powers of two and
+   * scattered ones up to 48 bits
+   */
+  std::vector<uint64_t> block_numbers()
+  {
+    std::vector<uint64_t> numbers;
+    for (uint64_t i = 0; i < 1024; i++)
+      numbers.push_back(i);
+    for (int bit = 10; bit < 48; bit++)
+    {
+      numbers.push_back((uint64_t)1 << bit);
+      numbers.push_back(((uint64_t)1 << bit) - 1);
+    }
+    uint64_t x = 1;
+    for (int i = 0; i < 1024; i++)
+    {
+      x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+      numbers.push_back(x >> 16);
+    }
+    return numbers;
+  }
+
+  class SetIndexingTest : public testing::TestWithParam<std::string>
+  {
+  };
+
+} // anonymous namespace
+
+/**
+ * CacheStore gives back the address of a victim from the tag and the
+ * position of its line: block_number() must invert tag_of() and set_of()
+ * in every way, for every number of sets (from 4, as skewed indexing needs
+ * more than 2) and more ways than skewing functions
+ */
+
+TEST_P(SetIndexingTest, BlockNumberInvertsSetAndTag)
+{
+  const int E = 12;
+  for (int s : {2, 4, 7, 10})
+  {
+    std::unique_ptr<SetIndexing> indexing(SetIndexing::create(GetParam(), s, E));
+    for (uint64_t bn : block_numbers())
+    {
+      uint64_t tag = indexing->tag_of(bn);
+      for (int way = 0; way < E; way++)
+      {
+        int set = indexing->set_of(bn, way);
+        ASSERT_GE(set, 0);
+        ASSERT_LT(set, 1 << s);
+        ASSERT_EQ(indexing->block_number(tag, set, way), bn)
+            << "s " << s << " way " << way << " set " << set;
+      }
+    }
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(Indexing, SetIndexingTest,
+                         testing::Values("SetAssociative", "SkewedAssociative",
+                                         "XORFold", "PrimeModulo"));
@@ -0,0 +1,118 @@
+#include "learning_gem5/part2/CacheStore/utility_partitioning.hh"
+
+#include <algorithm>
+
+#include "base/logging.hh"
+
+namespace gem5
+{
+
+  UtilityPartitioning::UtilityPartitioning(int partitions, int s, int E, int sample_shift)
+      : partitions(partitions), s(s), E(E), sample_shift(sample_shift)
+  {
+    fatal_if(this->partitions < 1, "utility partitioning needs a partition at least");
+    fatal_if(this->partitions > this->E, "every partition should get one way at least, "
+             "%d partitions do not fit in %d ways", this->partitions, this->E);
+    fatal_if(this->sample_shift < 0 || this->sample_shift >= 32, "sample shift should be within [0, 31]");
+
+    this->shadow.resize(this->partitions * sampled());
+    this->hits.assign(this->partitions * this->E, 0);
+
+    // until the first repartition the ways are shared out evenly
+    this->allocation.assign(this->partitions, this->E / this->partitions);
+    for (int p = 0; p < this->E % this->partitions; p++)
+      this->allocation[p]++;
+  }
+
+  int UtilityPartitioning::sampled() const
+  {
+    return std::max(1, (1 << this->s) >> this->sample_shift);
+  }
+
+  uint64_t UtilityPartitioning::utility(int partition, int ways) const
+  {
+    uint64_t total = 0;
+    for (int i = 0; i < ways; i++)
+      total += this->hits[partition * this->E + i];
+    return total;
+  }
+
+  void UtilityPartitioning::observe(int partition, int set, uint64_t block_number)
+  {
+    if (partition < 0 || partition >= this->partitions)
+      return;
+    // only the sets whose lowest sample_shift bits are 0 are monitored
+    if ((set & ((1 << this->sample_shift) - 1)) != 0)
+      return;
+    int index = std::min(set >> this->sample_shift, sampled() - 1);
+
+    // step 01: look the block up in the LRU stack of the partition
+    std::vector<uint64_t> &stack = this->shadow[partition * sampled() + index];
+    auto it = std::find(stack.begin(), stack.end(), block_number);
+
+    // step 02: a hit at position i would have hit with i + 1 ways or more
+    if (it != stack.end())
+    {
+      this->hits[partition * this->E + (it - stack.begin())]++;
+      stack.erase(it);
+    }
+    else if ((int)stack.size() == this->E)
+    {
+      stack.pop_back();
+    }
+
+    // step 03: the block becomes the most recently used one
+    stack.insert(stack.begin(), block_number);
+  }
+
+  std::vector<uint64_t> UtilityPartitioning::repartition()
+  {
+    // step 01: lookahead, every partition starts with one way and the
+    // remaining ways go, a few at a time, to the partition with the highest
+    // marginal utility (hits gained per way)
+    std::vector<int> alloc(this->partitions, 1);
+    int balance = this->E - this->partitions;
+    while (balance > 0)
+    {
+      int best = -1;
+      int best_ways = 0;
+      double best_utility = -1;
+      for (int p = 0; p < this->partitions; p++)
+      {
+        uint64_t base = utility(p, alloc[p]);
+        for (int k = 1; k <= balance; k++)
+        {
+          double marginal = (double)(utility(p, alloc[p] + k) - base) / k;
+          // on a tie, the partition with fewer ways wins
+          if (marginal > best_utility ||
+              (marginal == best_utility && alloc[p] < alloc[best]))
+          {
+            best = p;
+            best_ways = k;
+            best_utility = marginal;
+          }
+        }
+      }
+      alloc[best] += best_ways;
+      balance -= best_ways;
+    }
+    this->allocation = alloc;
+
+    // step 02: the ways of a partition are contiguous
+    std::vector<uint64_t> masks;
+    int first = 0;
+    for (int p = 0; p < this->partitions; p++)
+    {
+      uint64_t mask = (alloc[p] == 64) ? ~(uint64_t)0 : (((uint64_t)1 << alloc[p]) - 1);
+      masks.push_back(mask << first);
+      first += alloc[p];
+    }
+
+    // step 03: age the counters
+    for (uint64_t &count : this->hits)
+      count /= 2;
+
+    return masks;
+  }
+
+}
@@ -0,0 +1,89 @@
+#ifndef __UTILITY_PARTITIONING_HH__
+#define __UTILITY_PARTITIONING_HH__
+
+#include <cstdint>
+#include <vector>
+
+// UtilityPartitioning: utility-based cache partitioning (Qureshi and Patt, UCP)
+// ***************************************************************
+// ** UMON:   shadow tags of a few sampled sets, one LRU stack   **
+// **         per partition as if it had the whole cache         **
+// ** HITS:   hits of each partition at each stack position:     **
+// **         a partition with w ways would have hit the hits    **
+// **         of the positions [0, w)                            **
+// ** ALLOC:  the lookahead algorithm hands the ways out by      **
+// **         marginal utility, at least one way per partition   **
+// ***************************************************************
+// the ways are given out as contiguous way masks for CacheStore::set_way_masks
+
+namespace gem5
+{
+
+  class UtilityPartitioning
+  {
+  private:
+    // number of partitions
+    int partitions;
+
+    // set number: S = 2 ^ s (sets)
+    int s;
+
+    // line number per set: E
+    int E;
+
+    // one set out of 2 ^ sample_shift is monitored
+    int sample_shift;
+
+    // shadow tags of the sampled sets, most recently used first:
+    // shadow[partition * sampled + sampled set] holds up to E block numbers
+    std::vector<std::vector<uint64_t>> shadow;
+
+    // hits of every partition at every stack position: hits[partition * E + position]
+    std::vector<uint64_t> hits;
+
+    // ways of every partition, from the last call to repartition()
+    std::vector<int> allocation;
+
+    /**
+     * @return number of sampled sets
+     */
+    int sampled() const;
+
+    /**
+     * @param partition a partition
+     * @param ways number of ways
+     * @return hits the partition would have had with that many ways
+     */
+    uint64_t utility(int partition, int ways) const;
+
+  public:
+    /**
+     * @param partitions number of partitions, at most E
+     * @param sample_shift one set out of 2 ^ sample_shift is monitored
+     */
+    UtilityPartitioning(int partitions, int s, int E, int sample_shift);
+
+    /**
+     * record an access in the shadow tags of its partition, if its set is sampled
+     * @param partition the partition accessing the block
+     * @param set the set of the block in CacheStore
+     * @param block_number the address without the block offset
+     */
+    void observe(int partition, int set, uint64_t block_number);
+
+    /**
+     * hand the ways out with the lookahead algorithm, then halve the hit
+     * counters so that older phases weigh less
+     * @return one contiguous way mask per partition
+     */
+    std::vector<uint64_t> repartition();
+
+    /**
+     * @return ways of the partition since the last repartition
+     */
+    int ways_of(int partition) const { return this->allocation[partition]; }
+  };
+
+}
+
+#endif // __UTILITY_PARTITIONING_HH__
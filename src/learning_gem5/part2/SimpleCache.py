@@ -28,6 +28,18 @@
 from m5.params import *
 from m5.proxy import *
 from m5.objects.ClockedObject import ClockedObject
+from m5.objects.Compressors import BaseCacheCompressor
+from m5.objects.Prefetcher import BasePrefetcher
+from m5.objects.ReplacementPolicies import *
+
+class CacheStoreIndexing(Enum):
+    vals = ['SetAssociative', 'SkewedAssociative', 'XORFold', 'PrimeModulo']
+
+class SimpleCacheInclusion(Enum):
+    vals = ['NINE', 'Inclusive', 'Exclusive']
+
+class SimpleCachePartitioning(Enum):
+    vals = ['NoPartitioning', 'StaticWays', 'UCP']
 
 class SimpleCache(ClockedObject):
     type = 'SimpleCache'
@@ -41,8 +53,93 @@ class SimpleCache(ClockedObject):
 
     latency = Param.Cycles(1, "Cycles taken on a hit or to resolve a miss")
 
+    mshrs = Param.Unsigned(4, "Number of MSHRs (max outstanding misses)")
+    tgts_per_mshr = Param.Unsigned(8, "Max number of accesses per MSHR")
+    write_buffers = Param.Unsigned(8, "Number of writebacks that can be "
+        "queued for the memory side")
+
     system = Param.System(Parent.any, "The system this cache is part of")
 
     line_per_set = Param.Int(4, "The number of lines in each set of CacheStore")
 
     param_for_set = Param.Int(2, "The number of sets in CacheStore is: (1 << this->s)")
+
+    indexing = Param.CacheStoreIndexing('SetAssociative',
+        "How CacheStore maps a block to a set: bit slice, skewed (one hash "
+        "per way), XOR of the tag folded into the set bits, or modulo the "
+        "largest prime below the number of sets")
+
+    replacement_policy = Param.BaseReplacementPolicy(LRURP(),
+        "Replacement policy used by CacheStore to pick a victim line")
+
+    send_clean_evict = Param.Bool(False, "Send a CleanEvict to the memory "
+        "side when a clean line is evicted, instead of dropping it silently")
+
+    writeback_clean = Param.Bool(False, "Write clean lines back with their "
+        "data when they are evicted (needed above an exclusive cache)")
+
+    # Hierarchy of SimpleCaches: a level below the L1s takes their
+    # writebacks and keeps them inclusive, exclusive or neither
+    inclusion = Param.SimpleCacheInclusion('NINE', "Inclusion policy with "
+        "respect to the caches above: NINE (non-inclusive non-exclusive), "
+        "Inclusive (back-invalidate upper_caches on eviction) or Exclusive "
+        "(victim cache, blocks move up on a hit)")
+    upper_caches = VectorParam.SimpleCache([], "SimpleCaches directly above "
+        "this one, back-invalidated by an inclusive cache")
+
+    # Policies sized by the associativity (e.g. TreePLRURP) look it up
+    # through Parent.assoc, so export it from the CacheStore geometry
+    assoc = Param.Int(Self.line_per_set, "Associativity seen by the policies")
+
+    # Split instruction and data stores: fetches (requests flagged
+    # INST_FETCH) get a CacheStore and MSHRs of their own
+    split_inst_data = Param.Bool(False, "Keep instruction fetches in a "
+        "separate CacheStore with its own geometry and MSHRs")
+    inst_line_per_set = Param.Int(4, "The number of lines in each set of the "
+        "instruction CacheStore")
+    inst_param_for_set = Param.Int(2, "The number of sets in the instruction "
+        "CacheStore is: (1 << this->s)")
+    inst_replacement_policy = Param.BaseReplacementPolicy(LRURP(),
+        "Replacement policy of the instruction CacheStore")
+    inst_mshrs = Param.Unsigned(2, "Number of MSHRs for instruction fetches")
+
+    # Way partitioning among the requestors (e.g. the cores of a multi-core
+    # run): each partition only fills the ways of its mask, hits are shared
+    partitioning = Param.SimpleCachePartitioning('NoPartitioning',
+        "How the ways are partitioned among partition_requestors: not at "
+        "all, with the fixed way_masks (StaticWays), or by utility (UCP, "
+        "shadow tags)")
+    partition_requestors = VectorParam.String([], "Name prefix of the "
+        "requestors of each partition, e.g. system.cpu0 for the instruction "
+        "and data requestors of cpu0 (system.cpu0.inst, system.cpu0.data). "
+        "Other requestors fill any way")
+    way_masks = VectorParam.UInt64([], "Ways each partition may fill with "
+        "StaticWays partitioning, one mask per partition (bit i is way i)")
+    ucp_epoch = Param.Unsigned(100000, "Accesses between two UCP "
+        "repartitions")
+    ucp_sample_shift = Param.Unsigned(2, "UCP monitors one set out of "
+        "2^ucp_sample_shift in its shadow tags")
+
+    # Compression of the data store: the blocks of a super-block share a
+    # physical way when they compress well enough
+    compressor = Param.BaseCacheCompressor(NULL, "Compressor of the data "
+        "store (e.g. BDI, CPack, FPC, ZeroCompressor, Multi), none to store "
+        "the blocks uncompressed")
+    max_compression_ratio = Param.Int(2, "Number of blocks of a super-block "
+        "a physical way can hold with a compressor (a power of two). The "
+        "replacement policy sees line_per_set * max_compression_ratio "
+        "lines per set, set assoc accordingly for TreePLRURP")
+
+    # Hardware prefetching into the data store: the prefetcher listens to
+    # the Hit, Miss and Fill probe points of the cache, like with a Cache
+    prefetcher = Param.BasePrefetcher(NULL, "Prefetcher filling the data "
+        "store (e.g. StridePrefetcher, BOPPrefetcher, AMPMPrefetcher, "
+        "SignaturePathPrefetcher, IndirectMemoryPrefetcher)")
+    prefetch_on_access = Param.Bool(False, "Notify the hardware prefetcher "
+        "on every access (not just misses)")
+    prefetch_on_pf_hit = Param.Bool(False, "Notify the hardware prefetcher "
+        "on hit on prefetched lines")
+    prefetch_reserved_mshrs = Param.Unsigned(1, "MSHRs kept for demand "
+        "misses: a prefetch is only issued while more are free")
+    prefetched_first = Param.Bool(False, "Evict the prefetched lines no "
+        "demand access has used yet before any other line")
@@ -0,0 +1,81 @@
+#include "learning_gem5/part2/SimpleMSHR/simple_mshr.hh"
+
+#include "base/logging.hh"
+
+namespace gem5
+{
+
+  SimpleMSHRQueue::SimpleMSHRQueue(unsigned num_entries, unsigned tgts_per_mshr)
+      : entries(num_entries), tgts_per_mshr(tgts_per_mshr)
+  {
+    fatal_if(num_entries == 0, "SimpleMSHRQueue needs at least one entry");
+    fatal_if(tgts_per_mshr == 0, "an MSHR needs at least one target");
+
+    for (auto &entry : entries)
+      free_list.push_back(&entry);
+  }
+
+  SimpleMSHR *SimpleMSHRQueue::findMatch(Addr block_addr) const
+  {
+    // the file is small, a linear search over the entries in use is enough
+    for (auto mshr : alloc_list)
+    {
+      if (mshr->block_addr == block_addr)
+        return mshr;
+    }
+    return nullptr;
+  }
+
+  SimpleMSHR *SimpleMSHRQueue::allocate(Addr block_addr, PacketPtr pkt, int port_id, Tick when)
+  {
+    panic_if(isFull(), "no free MSHR to allocate");
+    panic_if(findMatch(block_addr) != nullptr, "block %#x already has an MSHR", block_addr);
+
+    SimpleMSHR *mshr = free_list.front();
+    free_list.pop_front();
+    alloc_list.push_back(mshr);
+
+    mshr->block_addr = block_addr;
+    mshr->alloc_tick = when;
+    mshr->in_use = true;
+    mshr->invalidated = false;
+    assert(mshr->targets.empty());
+    mshr->targets.emplace_back(pkt, port_id, when);
+
+    return mshr;
+  }
+
+  bool SimpleMSHRQueue::allocateTarget(SimpleMSHR *mshr, PacketPtr pkt, int port_id, Tick when)
+  {
+    assert(mshr->in_use);
+    if (mshr->targets.size() >= tgts_per_mshr)
+      return false;
+
+    mshr->targets.emplace_back(pkt, port_id, when);
+    return true;
+  }
+
+  void SimpleMSHRQueue::deallocate(SimpleMSHR *mshr)
+  {
+    assert(mshr->in_use);
+    mshr->targets.clear();
+    mshr->in_use = false;
+    mshr->block_addr = MaxAddr;
+
+    alloc_list.remove(mshr);
+    free_list.push_back(mshr);
+  }
+
+  void SimpleMSHRQueue::trySatisfyFunctional(PacketPtr pkt)
+  {
+    for (auto mshr : alloc_list)
+    {
+      for (auto &target : mshr->targets)
+      {
+        if (target.pkt->isWrite())
+          pkt->trySatisfyFunctional(target.pkt);
+      }
+    }
+  }
+
+}
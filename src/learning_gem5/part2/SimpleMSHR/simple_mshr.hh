@@ -0,0 +1,123 @@
+#ifndef __SIMPLE_MSHR_HH__
+#define __SIMPLE_MSHR_HH__
+
+#include <list>
+#include <vector>
+
+#include "base/types.hh"
+#include "mem/packet.hh"
+
+namespace gem5
+{
+
+  /**
+   * A miss status holding register: one outstanding fill of a block, and the
+   * requests (targets) waiting for that block. A cut-down version of the
+   * MSHR in mem/cache/mshr.hh: no coherence state, no deferred targets.
+   */
+  class SimpleMSHR
+  {
+  public:
+    /// A request waiting for the block
+    struct Target
+    {
+      PacketPtr pkt; // the request to respond to once the block arrives
+      int port_id;   // the CPU-side port the response goes to
+      Tick recv_tick; // when the miss was detected (for miss latency)
+
+      Target(PacketPtr pkt, int port_id, Tick recv_tick)
+          : pkt(pkt), port_id(port_id), recv_tick(recv_tick)
+      {}
+    };
+
+    /// Block address(aligned) this MSHR is fetching
+    Addr block_addr;
+
+    /// When the MSHR was allocated
+    Tick alloc_tick;
+
+    /// Requests to service when the fill arrives, in arrival order
+    std::list<Target> targets;
+
+    /// True if this entry is allocated
+    bool in_use;
+
+    /// True if an inclusive cache below evicted the block while it was
+    /// being fetched: the fill must not be installed
+    bool invalidated;
+
+    SimpleMSHR()
+        : block_addr(MaxAddr), alloc_tick(0), in_use(false),
+          invalidated(false)
+    {}
+  };
+
+  /**
+   * A fixed-size file of MSHRs, in the spirit of mem/cache/mshr_queue.hh.
+   * Entries are looked up by block address; each entry merges up to
+   * 'tgts_per_mshr' requests to the same block.
+   */
+  class SimpleMSHRQueue
+  {
+  private:
+    /// All entries, allocated or not
+    std::vector<SimpleMSHR> entries;
+
+    /// Entries that are not in use
+    std::list<SimpleMSHR *> free_list;
+
+    /// Entries in use, in allocation order
+    std::list<SimpleMSHR *> alloc_list;
+
+    /// Number of targets an entry can hold
+    const unsigned tgts_per_mshr;
+
+  public:
+    SimpleMSHRQueue(unsigned num_entries, unsigned tgts_per_mshr);
+
+    /**
+     * @param block_addr block address(aligned) to look for
+     * @return the MSHR fetching the block, nullptr if there is none
+     */
+    SimpleMSHR *findMatch(Addr block_addr) const;
+
+    /**
+     * Allocate an entry for a block and add the first target to it.
+     * The queue must not be full.
+     * @return the new MSHR
+     */
+    SimpleMSHR *allocate(Addr block_addr, PacketPtr pkt, int port_id, Tick when);
+
+    /**
+     * Add a target to an MSHR
+     * @return false if the MSHR cannot take more targets
+     */
+    bool allocateTarget(SimpleMSHR *mshr, PacketPtr pkt, int port_id, Tick when);
+
+    /**
+     * Release an entry (its targets must have been serviced)
+     */
+    void deallocate(SimpleMSHR *mshr);
+
+    /**
+     * Let a functional access see the data of the writes still waiting in
+     * the MSHRs, the youngest values of those bytes
+     */
+    void trySatisfyFunctional(PacketPtr pkt);
+
+    /// @return true if no entry is free
+    bool isFull() const { return free_list.empty(); }
+
+    /// @return true if no entry is in use
+    bool isEmpty() const { return alloc_list.empty(); }
+
+    /// @return the number of entries in use
+    unsigned numInUse() const { return alloc_list.size(); }
+
+    /// @return the number of entries not in use
+    unsigned numFree() const { return free_list.size(); }
+  };
+
+}
+
+#endif // __SIMPLE_MSHR_HH__
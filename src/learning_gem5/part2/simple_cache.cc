@@ -28,8 +28,13 @@
 
 #include "learning_gem5/part2/simple_cache.hh"
 
+#include <cstring>
+
+#include "base/bitfield.hh"
 #include "base/compiler.hh"
+#include "base/intmath.hh"
 #include "base/random.hh"
+#include "debug/Drain.hh"
 #include "debug/SimpleCache.hh"
 #include "sim/system.hh"
 
@@ -40,8 +45,26 @@ SimpleCache::SimpleCache(const SimpleCacheParams &params) :
     ClockedObject(params),
     latency(params.latency),
     blockSize(params.system->cacheLineSize()),
+    sendCleanEvict(params.send_clean_evict),
+    writebackClean(params.writeback_clean),
+    inclusion(params.inclusion),
+    upperCaches(params.upper_caches),
     memPort(params.name + ".mem_side", this),
-    blocked(false), originalPacket(nullptr), waitingPortId(-1), stats(this)
+    mshrQueue(params.mshrs, params.tgts_per_mshr),
+    instMshrQueue(params.inst_mshrs, params.tgts_per_mshr),
+    writeBuffers(params.write_buffers), pendingAccesses(0),
+    partitioning(params.partitioning),
+    partitionRequestors(params.partition_requestors),
+    system(params.system), ucpEpoch(params.ucp_epoch), ucpAccesses(0),
+    prefetcher(params.prefetcher),
+    prefetchReservedMshrs(params.prefetch_reserved_mshrs),
+    prefetchEvent([this]{ issuePrefetches(); }, name() + ".prefetchEvent"),
+    ppHit(nullptr), ppMiss(nullptr), ppFill(nullptr),
+    stats(this, 1 << params.param_for_set,
+          params.line_per_set * (params.compressor ?
+                                 params.max_compression_ratio : 1),
+          params.partition_requestors.size(),
+          (1 << params.param_for_set) * params.line_per_set)
 {
     // Since the CPU side ports are a vector of ports, create an instance of
     // the CPUSidePort for each connection. This member of params is
@@ -62,13 +85,69 @@ SimpleCache::SimpleCache(const SimpleCacheParams &params) :
         tmp = tmp >> 1;
     }  // when exiting the cycle, 'b' stores bits number needed for block param
 
-    cache_store = new CacheStore(params.param_for_set, params.line_per_set, b);
+    // With a compressor, a physical way holds up to max_compression_ratio
+    // blocks of a super-block
+    int c = 0;
+    if (params.compressor) {
+        fatal_if(!isPowerOf2(params.max_compression_ratio),
+                 "%s: max_compression_ratio should be a power of two",
+                 name());
+        c = floorLog2(params.max_compression_ratio);
+    }
+    cache_store = new CacheStore(params.param_for_set, params.line_per_set, b,
+                                 params.replacement_policy,
+                                 enums::CacheStoreIndexingStrings[params.indexing],
+                                 params.compressor, c);
+
+    // instruction fetches get a store of their own, with its own geometry
+    inst_store = nullptr;
+    if (params.split_inst_data) {
+        inst_store = new CacheStore(params.inst_param_for_set,
+                                    params.inst_line_per_set, b,
+                                    params.inst_replacement_policy,
+                                    enums::CacheStoreIndexingStrings[params.indexing]);
+    }
+
+    // Way partitioning applies to the data store
+    int num_partitions = partitionRequestors.size();
+    if (partitioning == enums::StaticWays) {
+        fatal_if(params.way_masks.size() != num_partitions,
+                 "%s: %d way masks for %d partitions", name(),
+                 params.way_masks.size(), num_partitions);
+        cache_store->set_way_masks(params.way_masks);
+    } else if (partitioning == enums::UCP) {
+        ucp.reset(new UtilityPartitioning(num_partitions,
+                                          params.param_for_set,
+                                          params.line_per_set,
+                                          params.ucp_sample_shift));
+        // Start from an even split until the shadow tags have seen an epoch
+        std::vector<uint64_t> masks;
+        int first = 0;
+        for (int p = 0; p < num_partitions; p++) {
+            masks.push_back(mask(ucp->ways_of(p)) << first);
+            first += ucp->ways_of(p);
+            stats.partitionWays[p] = ucp->ways_of(p);
+        }
+        cache_store->set_way_masks(masks);
+    }
+
+    // Prefetches fill the data store, and demand misses always keep a few
+    // MSHRs for themselves
+    cache_store->set_prefetched_first(params.prefetched_first);
+    if (prefetcher) {
+        fatal_if(prefetchReservedMshrs >= params.mshrs,
+                 "%s: prefetch_reserved_mshrs leaves no MSHR to prefetch",
+                 name());
+        prefetcher->setParentInfo(system, getProbeManager(), this,
+                                  blockSize);
+    }
 }
 
 SimpleCache::~SimpleCache()
 {
     // destruct the cache_store object here
     delete cache_store;
+    delete inst_store;
 }
 
 Port &
@@ -89,17 +168,46 @@ SimpleCache::getPort(const std::string &if_name, PortID idx)
 }
 
 void
-SimpleCache::CPUSidePort::sendPacket(PacketPtr pkt)
+SimpleCache::regProbePoints()
 {
-    // Note: This flow control is very simple since the cache is blocking.
+    ppHit = new ProbePointArg<PacketPtr>(getProbeManager(), "Hit");
+    ppMiss = new ProbePointArg<PacketPtr>(getProbeManager(), "Miss");
+    ppFill = new ProbePointArg<PacketPtr>(getProbeManager(), "Fill");
+}
 
-    panic_if(blockedPacket != nullptr, "Should never try to send if blocked!");
+bool
+SimpleCache::inCache(Addr addr, bool is_secure) const
+{
+    return cache_store->data_of(addr & ~Addr(blockSize - 1)) != nullptr;
+}
+
+bool
+SimpleCache::hasBeenPrefetched(Addr addr, bool is_secure) const
+{
+    return cache_store->is_prefetched(addr & ~Addr(blockSize - 1));
+}
+
+bool
+SimpleCache::inMissQueue(Addr addr, bool is_secure) const
+{
+    return mshrQueue.findMatch(addr & ~Addr(blockSize - 1)) != nullptr;
+}
+
+void
+SimpleCache::CPUSidePort::sendPacket(PacketPtr pkt)
+{
+    // Responses have to leave in order, so queue behind any blocked one.
+    if (!blockedPackets.empty()) {
+        DPRINTF(CacheStore, "Queueing %s to CPU\n", pkt->print());
+        blockedPackets.push_back(pkt);
+        return;
+    }
 
     // If we can't send the packet across the port, store it for later.
     DPRINTF(CacheStore, "Sending %s to CPU\n", pkt->print());
     if (!sendTimingResp(pkt)) {
         DPRINTF(CacheStore, "failed!\n");
-        blockedPacket = pkt;
+        blockedPackets.push_back(pkt);
     }
 }
 
@@ -112,7 +220,7 @@ SimpleCache::CPUSidePort::getAddrRanges() const
 void
 SimpleCache::CPUSidePort::trySendRetry()
 {
-    if (needRetry && blockedPacket == nullptr) {
+    if (needRetry && blockedPackets.empty()) {
         // Only send a retry if the port is now completely free
         needRetry = false;
         DPRINTF(CacheStore, "Sending retry req.\n");
@@ -127,12 +235,19 @@ SimpleCache::CPUSidePort::recvFunctional(PacketPtr pkt)
     return owner->handleFunctional(pkt);
 }
 
+Tick
+SimpleCache::CPUSidePort::recvAtomic(PacketPtr pkt)
+{
+    // Just forward to the cache.
+    return owner->handleAtomic(pkt);
+}
+
 bool
 SimpleCache::CPUSidePort::recvTimingReq(PacketPtr pkt)
 {
     DPRINTF(CacheStore, "Got request %s\n", pkt->print());
 
-    if (blockedPacket || needRetry) {
+    if (!blockedPackets.empty() || needRetry) {
         // The cache may not be able to send a reply if this is blocked
         DPRINTF(CacheStore, "Request blocked\n");
         needRetry = true;
@@ -154,31 +269,74 @@ void
 SimpleCache::CPUSidePort::recvRespRetry()
 {
     // We should have a blocked packet if this function is called.
-    assert(blockedPacket != nullptr);
-
-    // Grab the blocked packet.
-    PacketPtr pkt = blockedPacket;
-    blockedPacket = nullptr;
-
-    DPRINTF(CacheStore, "Retrying response pkt %s\n", pkt->print());
-    // Try to resend it. It's possible that it fails again.
-    sendPacket(pkt);
+    assert(!blockedPackets.empty());
+
+    // Send as many of the queued responses as the peer takes.
+    while (!blockedPackets.empty()) {
+        PacketPtr pkt = blockedPackets.front();
+        DPRINTF(CacheStore, "Retrying response pkt %s\n", pkt->print());
+        if (!sendTimingResp(pkt)) {
+            // It's possible that it fails again.
+            return;
+        }
+        blockedPackets.pop_front();
+    }
 
     // We may now be able to accept new packets
     trySendRetry();
+
+    owner->tryDrainDone();
 }
 
 void
 SimpleCache::MemSidePort::sendPacket(PacketPtr pkt)
 {
-    // Note: This flow control is very simple since the cache is blocking.
+    // If we can't send the packet across the port, store it for later.
+    // Packets have to leave in order, so queue behind any blocked one.
+    if (!blockedPackets.empty() || !sendTimingReq(pkt)) {
+        if (pkt->isEviction())
+            numWritebacks++;
+        blockedPackets.push_back(pkt);
+    }
+}
 
-    panic_if(blockedPacket != nullptr, "Should never try to send if blocked!");
+bool
+SimpleCache::MemSidePort::trySatisfyFunctional(PacketPtr pkt)
+{
+    // Newest first: a later writeback of the same block has newer data
+    for (auto it = blockedPackets.rbegin(); it != blockedPackets.rend();
+         ++it) {
+        if ((*it)->isEviction() && pkt->trySatisfyFunctional(*it))
+            return true;
+    }
+    return false;
+}
 
-    // If we can't send the packet across the port, store it for later.
-    if (!sendTimingReq(pkt)) {
-        blockedPacket = pkt;
+unsigned
+SimpleCache::MemSidePort::squashEvictions(Addr block_addr, uint8_t *data,
+                                          bool &dirty)
+{
+    // Newest first, so that the most recent dirty data is the one kept
+    unsigned squashed = 0;
+    for (auto it = blockedPackets.rbegin(); it != blockedPackets.rend();) {
+        PacketPtr pkt = *it;
+        if (!pkt->isEviction() ||
+            pkt->getBlockAddr(owner->blockSize) != block_addr) {
+            ++it;
+            continue;
+        }
+        if (!dirty && pkt->cmd == MemCmd::WritebackDirty) {
+            std::memcpy(data, pkt->getConstPtr<uint8_t>(), owner->blockSize);
+            dirty = true;
+        }
+        DPRINTF(CacheStore, "Squashing queued %s\n", pkt->print());
+        it = std::make_reverse_iterator(
+            blockedPackets.erase(std::next(it).base()));
+        numWritebacks--;
+        squashed++;
+        delete pkt;
     }
+    return squashed;
 }
 
 bool
@@ -191,15 +349,31 @@ SimpleCache::MemSidePort::recvTimingResp(PacketPtr pkt)
 void
 SimpleCache::MemSidePort::recvReqRetry()
 {
-    // We should have a blocked packet if this function is called.
-    assert(blockedPacket != nullptr);
+    // The refused packet may have been squashed by a back-invalidation
+    // since, in which case there may be nothing left to send
+    bool freed_writeback = false;
+    while (!blockedPackets.empty()) {
+        PacketPtr pkt = blockedPackets.front();
+        // The receiver may free a writeback as soon as it takes it
+        bool is_writeback = pkt->isEviction();
+        // Try to resend it. It's possible that it fails again.
+        if (!sendTimingReq(pkt))
+            break;
+        blockedPackets.pop_front();
+        if (is_writeback) {
+            numWritebacks--;
+            freed_writeback = true;
+        }
+    }
+
+    // A write buffer entry is free again, the cache may take new requests
+    if (freed_writeback)
+        owner->unblock();
 
-    // Grab the blocked packet.
-    PacketPtr pkt = blockedPacket;
-    blockedPacket = nullptr;
+    // Prefetches wait for the memory side to be idle
+    owner->schedulePrefetch();
 
-    // Try to resend it. It's possible that it fails again.
-    sendPacket(pkt);
+    owner->tryDrainDone();
 }
 
 void
@@ -211,22 +385,23 @@ SimpleCache::MemSidePort::recvRangeChange()
 bool
 SimpleCache::handleRequest(PacketPtr pkt, int port_id)
 {
-    if (blocked) {
-        // There is currently an outstanding request so we can't respond. Stall
+    if (isBlocked(pkt)) {
+        // No MSHR or write buffer entry left for a possible miss. Stall
+        stats.blockedRequests++;
         return false;
     }
 
     DPRINTF(CacheStore, "Got request for addr %#x\n", pkt->getAddr());
 
-    // This cache is now blocked waiting for the response to this packet.
-    blocked = true;
-
-    // Store the port for when we get the response
-    assert(waitingPortId == -1);
-    waitingPortId = port_id;
-
     // Schedule an event after cache access latency to actually access
-    schedule(new EventFunctionWrapper([this, pkt]{ accessTiming(pkt); },
+    pendingAccesses++;
+    schedule(new EventFunctionWrapper([this, pkt, port_id]
+                                      {
+                                          pendingAccesses--;
+                                          accessTiming(pkt, port_id);
+                                          schedulePrefetch();
+                                          tryDrainDone();
+                                      },
                                       name() + ".accessEvent", true),
              clockEdge(latency));
 
@@ -234,53 +409,255 @@ SimpleCache::handleRequest(PacketPtr pkt, int port_id)
 }
 
 bool
-SimpleCache::handleResponse(PacketPtr pkt)
+SimpleCache::isBlocked(PacketPtr pkt)
 {
-    assert(blocked);
-    DPRINTF(CacheStore, "Got response for addr %#x\n", pkt->getAddr());
+    return mshrsFor(pkt).isFull() ||
+           memPort.writeBufferSize() >= writeBuffers;
+}
 
-    // For now assume that inserts are off of the critical path and don't count
-    // for any added latency.
-    insert(pkt);
+bool
+SimpleCache::isInst(PacketPtr pkt) const
+{
+    return inst_store != nullptr && pkt->req->isInstFetch();
+}
 
-    stats.missLatency.sample(curTick() - missTime);
+CacheStore *
+SimpleCache::storeFor(PacketPtr pkt)
+{
+    return isInst(pkt) ? inst_store : cache_store;
+}
 
-    // If we had to upgrade the request packet to a full cache line, now we
-    // can use that packet to construct the response.
-    if (originalPacket != nullptr) {
-        DPRINTF(CacheStore, "Copying data from new packet to old\n");
-        // We had to upgrade a previous packet. We can functionally deal with
-        // the cache access now. It better be a hit.
-        [[maybe_unused]] bool hit = accessFunctional(originalPacket);
-        panic_if(!hit, "Should always hit after inserting");
-        originalPacket->makeResponse();
-        delete pkt; // We may need to delay this, I'm not sure.
-        pkt = originalPacket;
-        originalPacket = nullptr;
-    } // else, pkt contains the data it needs
+SimpleMSHRQueue &
+SimpleCache::mshrsFor(PacketPtr pkt)
+{
+    return isInst(pkt) ? instMshrQueue : mshrQueue;
+}
 
-    sendResponse(pkt);
+void
+SimpleCache::invalidateInst(Addr block_addr)
+{
+    // Keep fetches coherent with writes to the code
+    if (inst_store != nullptr && inst_store->data_of(block_addr) != nullptr) {
+        DPRINTF(CacheStore, "Invalidating written addr %#x in the "
+                "instruction store\n", block_addr);
+        inst_store->erase(block_addr);
+    }
+}
 
-    return true;
+void
+SimpleCache::recordHit(PacketPtr pkt, const CacheStore::AccessInfo &info)
+{
+    // The prefetcher sees the request, and the prefetched line is still
+    // marked so that it counts the prefetch as useful
+    ppHit->notify(pkt);
+    Addr block_addr = pkt->getBlockAddr(blockSize);
+    if (cache_store->is_prefetched(block_addr)) {
+        DPRINTF(SimpleCache, "Hit on prefetch for addr %#x\n", block_addr);
+        stats.prefetchUseful++;
+        cache_store->set_prefetched(block_addr, false);
+    }
+
+    stats.hits++; // update stats
+    stats.classHits[isInst(pkt)]++;
+    monitorPartition(pkt, true);
+    if (info.decompression_latency != 0) {
+        stats.decompressions++;
+        stats.decompressionCycles += info.decompression_latency;
+    }
+    if (!isInst(pkt)) {
+        // The heatmaps follow the geometry of the data store
+        stats.setHits[info.set]++;
+        stats.wayHits[info.way]++;
+        stats.setStackDistance[info.set][info.stack_distance]++;
+    }
 }
 
-void SimpleCache::sendResponse(PacketPtr pkt)
+void
+SimpleCache::recordMiss(PacketPtr pkt)
 {
-    assert(blocked);
-    DPRINTF(CacheStore, "Sending resp for addr %#x\n", pkt->getAddr());
+    ppMiss->notify(pkt);
 
-    int port = waitingPortId;
+    stats.misses++; // update stats
+    stats.classMisses[isInst(pkt)]++;
+    monitorPartition(pkt, false);
+    if (!isInst(pkt))
+        stats.setMisses[cache_store->set_of(pkt->getAddr())]++;
+}
+
+int
+SimpleCache::partitionOf(PacketPtr pkt)
+{
+    if (partitioning == enums::NoPartitioning)
+        return -1;
+
+    RequestorID id = pkt->req->requestorId();
+    auto it = requestorPartitions.find(id);
+    if (it != requestorPartitions.end())
+        return it->second;
+
+    // First access of this requestor, match its name once and for all
+    const std::string requestor = system->getRequestorName(id);
+    int partition = -1;
+    for (int p = 0; p < partitionRequestors.size() && partition < 0; p++) {
+        // The prefix is a whole object name: system.cpu1 is not system.cpu10
+        const std::string &prefix = partitionRequestors[p];
+        if (requestor == prefix ||
+            requestor.compare(0, prefix.size() + 1, prefix + ".") == 0) {
+            partition = p;
+        }
+    }
+    DPRINTF(SimpleCache, "Requestor %s is in partition %d\n", requestor,
+            partition);
+    requestorPartitions[id] = partition;
+    return partition;
+}
 
-    // The packet is now done. We're about to put it in the port, no need for
-    // this object to continue to stall.
-    // We need to free the resource before sending the packet in case the CPU
-    // tries to send another request immediately (e.g., in the same callchain).
-    blocked = false;
-    waitingPortId = -1;
+void
+SimpleCache::monitorPartition(PacketPtr pkt, bool hit)
+{
+    if (partitioning == enums::NoPartitioning || isInst(pkt))
+        return;
 
-    // Simply forward to the memory port
-    cpuPorts[port].sendPacket(pkt);
+    int partition = partitionOf(pkt);
+    // "other" is the last entry of the partition stats
+    int index = (partition < 0) ? partitionRequestors.size() : partition;
+    if (hit) {
+        stats.partitionHits[index]++;
+    } else {
+        stats.partitionMisses[index]++;
+    }
 
+    if (ucp) {
+        Addr block_addr = pkt->getBlockAddr(blockSize);
+        ucp->observe(partition, cache_store->set_of(block_addr),
+                     block_addr / blockSize);
+        if (++ucpAccesses >= ucpEpoch)
+            repartition();
+    }
+}
+
+void
+SimpleCache::repartition()
+{
+    ucpAccesses = 0;
+    cache_store->set_way_masks(ucp->repartition());
+    stats.repartitions++;
+    for (int p = 0; p < partitionRequestors.size(); p++) {
+        DPRINTF(SimpleCache, "Partition %d (%s) gets %d ways\n", p,
+                partitionRequestors[p], ucp->ways_of(p));
+        stats.partitionWays[p] = ucp->ways_of(p);
+    }
+}
+
+void
+SimpleCache::updateOccupancy()
+{
+    stats.storedBlocks = cache_store->num_blocks();
+    if (partitioning == enums::NoPartitioning)
+        return;
+
+    for (int p = 0; p < partitionRequestors.size(); p++)
+        stats.partitionOccupancy[p] = cache_store->occupancy(p);
+    stats.partitionOccupancy[partitionRequestors.size()] =
+        cache_store->occupancy(-1);
+}
+
+void
+SimpleCache::recordMissLatency(PacketPtr pkt, Tick lat)
+{
+    stats.missLatency.sample(lat);
+    if (isInst(pkt)) {
+        stats.instMissLatency.sample(lat);
+    } else {
+        stats.dataMissLatency.sample(lat);
+    }
+}
+
+bool
+SimpleCache::canPrefetch() const
+{
+    return prefetcher != nullptr && system->isTimingMode() &&
+           drainState() != DrainState::Draining &&
+           mshrQueue.numFree() > prefetchReservedMshrs && memPort.isIdle();
+}
+
+void
+SimpleCache::schedulePrefetch(Cycles delay)
+{
+    if (!canPrefetch())
+        return;
+
+    Tick next_pf_time = prefetcher->nextPrefetchReadyTime();
+    if (next_pf_time == MaxTick)
+        return;
+    next_pf_time = std::max(next_pf_time, clockEdge(delay));
+
+    if (!prefetchEvent.scheduled()) {
+        schedule(prefetchEvent, next_pf_time);
+    } else if (next_pf_time < prefetchEvent.when()) {
+        reschedule(prefetchEvent, next_pf_time);
+    }
+}
+
+void
+SimpleCache::issuePrefetches()
+{
+    // Redundant prefetches are dropped right away, one prefetch at most is
+    // sent to memory per cycle
+    while (canPrefetch() && prefetcher->nextPrefetchReadyTime() <= curTick()) {
+        PacketPtr pf = prefetcher->getPacket();
+        if (pf == nullptr)
+            break;
+
+        Addr block_addr = pf->getBlockAddr(blockSize);
+        if (cache_store->data_of(block_addr) != nullptr) {
+            DPRINTF(SimpleCache, "Prefetch %#x has hit in the cache, "
+                    "dropped\n", block_addr);
+            prefetcher->pfHitInCache();
+            stats.prefetchDropped++;
+            delete pf;
+        } else if (mshrQueue.findMatch(block_addr) != nullptr) {
+            DPRINTF(SimpleCache, "Prefetch %#x has hit in an MSHR, "
+                    "dropped\n", block_addr);
+            prefetcher->pfHitInMSHR();
+            stats.prefetchDropped++;
+            delete pf;
+        } else {
+            DPRINTF(SimpleCache, "Issuing prefetch for addr %#x\n",
+                    block_addr);
+            stats.prefetchIssued++;
+
+            // The prefetch is the first target of its MSHR, with nobody to
+            // respond to. Demand misses to the block merge into it.
+            mshrQueue.allocate(block_addr, pf, -1, curTick());
+            PacketPtr new_pkt = new Packet(pf->req, MemCmd::ReadReq,
+                                           blockSize);
+            new_pkt->allocate();
+            memPort.sendPacket(new_pkt);
+
+            schedulePrefetch(Cycles(1));
+            return;
+        }
+    }
+
+    schedulePrefetch();
+}
+
+void
+SimpleCache::releasePrefetched(Addr block_addr)
+{
+    if (!cache_store->is_prefetched(block_addr))
+        return;
+
+    DPRINTF(SimpleCache, "Prefetched addr %#x evicted unused\n", block_addr);
+    stats.prefetchUnused++;
+    if (prefetcher)
+        prefetcher->prefetchUnused();
+}
+
+void
+SimpleCache::unblock()
+{
     // For each of the cpu ports, if it needs to send a retry, it should do it
     // now since this memory object may be unblocked now.
     for (auto& port : cpuPorts) {
@@ -288,71 +665,444 @@ void SimpleCache::sendResponse(PacketPtr pkt)
     }
 }
 
+bool
+SimpleCache::handleResponse(PacketPtr pkt)
+{
+    DPRINTF(CacheStore, "Got response for addr %#x\n", pkt->getAddr());
+
+    // The fill carries the request of the access that missed, so it tells
+    // which MSHRs (and store) it belongs to
+    SimpleMSHRQueue &mshrs = mshrsFor(pkt);
+    SimpleMSHR *mshr = mshrs.findMatch(pkt->getAddr());
+    panic_if(mshr == nullptr, "Response for addr %#x without an MSHR",
+             pkt->getAddr());
+
+    if (isInst(pkt)) {
+        // The data store may hold a more recent copy written after the
+        // fetch missed
+        const uint8_t *data = cache_store->data_of(pkt->getAddr());
+        if (data != nullptr)
+            pkt->setData(data);
+    }
+
+    // An exclusive cache hands the block up without keeping it, unless it
+    // has to hold data written while the block was being fetched
+    bool allocate = inclusion != enums::Exclusive;
+    for (auto &target : mshr->targets) {
+        allocate = allocate || target.pkt->isWrite() ||
+                   target.pkt->cmd.isHWPrefetch();
+    }
+    // The block left an inclusive cache below while it was being fetched,
+    // it may not be installed here any more
+    allocate = allocate && !mshr->invalidated;
+
+    if (!allocate) {
+        // Serve the targets from the fill. Writes update it, and it is
+        // then written back in place of the line that was not installed.
+        uint8_t *data = pkt->getPtr<uint8_t>();
+        bool dirty = false;
+        for (auto &target : mshr->targets) {
+            if (target.pkt->cmd.isHWPrefetch()) {
+                delete target.pkt;
+                continue;
+            }
+            if (target.pkt->isEviction()) {
+                target.pkt->writeDataToBlock(data, blockSize);
+                dirty = dirty || target.pkt->cmd == MemCmd::WritebackDirty;
+                delete target.pkt;
+                continue;
+            }
+
+            recordMissLatency(target.pkt,
+                              curTick() - target.recv_tick);
+
+            if (target.pkt->isWrite()) {
+                target.pkt->writeDataToBlock(data, blockSize);
+                dirty = true;
+            } else {
+                target.pkt->setDataFromBlock(data, blockSize);
+            }
+            target.pkt->makeResponse();
+            sendResponse(target.pkt, target.port_id);
+        }
+        if (dirty)
+            memPort.sendPacket(evictionPacket(mshr->block_addr, data, true));
+    } else {
+        // For now assume that inserts are off of the critical path and don't
+        // count for any added latency.
+        for (auto writeback : insert(pkt))
+            memPort.sendPacket(writeback);
+        ppFill->notify(pkt);
+
+        // The block is in the cache now, so every request waiting for it is
+        // handled functionally, in the order they arrived.
+        bool written = false;
+        bool demanded = false;
+        for (auto &target : mshr->targets) {
+            if (target.pkt->cmd.isHWPrefetch()) {
+                // Nobody waits for a prefetch, the prefetcher handed its
+                // packet over to the cache
+                delete target.pkt;
+                continue;
+            }
+            if (target.pkt->isEviction()) {
+                // A writeback from above that raced with the fill. The line
+                // is there, only a compressed line growing can evict others.
+                for (auto writeback : handleEviction(target.pkt))
+                    memPort.sendPacket(writeback);
+                delete target.pkt;
+                continue;
+            }
+
+            recordMissLatency(target.pkt,
+                              curTick() - target.recv_tick);
+
+            [[maybe_unused]] bool hit = accessFunctional(target.pkt);
+            panic_if(!hit, "Should always hit after inserting");
+            demanded = true;
+            written = written || target.pkt->isWrite();
+            target.pkt->makeResponse();
+            sendResponse(target.pkt, target.port_id);
+        }
+
+        // A prefetch no demand access has caught up with yet
+        if (!demanded)
+            cache_store->set_prefetched(pkt->getAddr(), true);
+
+        if (written) {
+            for (auto writeback : recompress(pkt->getAddr()))
+                memPort.sendPacket(writeback);
+        }
+    }
+
+    mshrs.deallocate(mshr);
+
+    // The fill packet was created by this cache
+    delete pkt;
+
+    // With an MSHR free, the accesses that could not get one can go again
+    retryStalledAccesses();
+    unblock();
+    schedulePrefetch();
+
+    tryDrainDone();
+
+    return true;
+}
+
+Tick
+SimpleCache::handleAtomic(PacketPtr pkt)
+{
+    // Timing and atomic accesses are never mixed: the system is drained
+    // before switching the memory mode.
+    assert(mshrQueue.isEmpty() && instMshrQueue.isEmpty() &&
+           memPort.isIdle());
+
+    std::vector<PacketPtr> sub_pkts = splitAccess(pkt);
+    if (!sub_pkts.empty()) {
+        // The blocks are accessed in parallel, the slowest one sets the
+        // latency of the whole access
+        stats.splitAccesses++;
+        Tick lat = 0;
+        for (auto sub_pkt : sub_pkts) {
+            lat = std::max(lat, handleAtomic(sub_pkt));
+            delete sub_pkt;
+        }
+        pkt->makeResponse();
+        return lat;
+    }
+
+    Tick lat = cyclesToTicks(latency);
+
+    if (pkt->isEviction()) {
+        // The sender still owns the packet in atomic mode
+        for (auto writeback : handleEviction(pkt)) {
+            memPort.sendAtomic(writeback);
+            delete writeback;
+        }
+        return lat;
+    }
+
+    CacheStore::AccessInfo info;
+    bool hit = accessFunctional(pkt, &info);
+
+    DPRINTF(CacheStore, "%s for atomic packet: %s\n", hit ? "Hit" : "Miss",
+            pkt->print());
+
+    if (hit) {
+        recordHit(pkt, info);
+        pkt->makeResponse();
+
+        // A compressed line has to be decompressed first
+        lat += cyclesToTicks(info.decompression_latency);
+
+        PacketPtr writeback = releaseExclusive(pkt);
+        if (writeback != nullptr) {
+            memPort.sendAtomic(writeback);
+            delete writeback;
+        }
+        if (pkt->isWrite()) {
+            for (auto writeback : recompress(pkt->getBlockAddr(blockSize))) {
+                memPort.sendAtomic(writeback);
+                delete writeback;
+            }
+        }
+        return lat;
+    }
+
+    recordMiss(pkt);
+
+    panic_if(!pkt->isWrite() && !pkt->isRead(),
+             "Unknown packet type in upgrade size");
+
+    // Fetch the whole block and insert it right away
+    PacketPtr fill = new Packet(pkt->req, MemCmd::ReadReq, blockSize);
+    fill->allocate();
+    lat += memPort.sendAtomic(fill);
+
+    if (inclusion == enums::Exclusive && !pkt->isWrite()) {
+        // Hand the block up without keeping it
+        pkt->setDataFromBlock(fill->getConstPtr<uint8_t>(), blockSize);
+        delete fill;
+        pkt->makeResponse();
+        recordMissLatency(pkt, lat);
+        return lat;
+    }
+
+    for (auto writeback : insert(fill)) {
+        // Off of the critical path, like in timing mode
+        memPort.sendAtomic(writeback);
+        delete writeback;
+    }
+    ppFill->notify(fill);
+    delete fill;
+
+    [[maybe_unused]] bool filled = accessFunctional(pkt);
+    panic_if(!filled, "Should always hit after inserting");
+    pkt->makeResponse();
+    if (pkt->isWrite()) {
+        for (auto writeback : recompress(pkt->getBlockAddr(blockSize))) {
+            memPort.sendAtomic(writeback);
+            delete writeback;
+        }
+    }
+
+    recordMissLatency(pkt, lat);
+
+    return lat;
+}
+
+void SimpleCache::sendResponse(PacketPtr pkt, int port_id)
+{
+    auto parent = splitParents.find(pkt);
+    if (parent != splitParents.end()) {
+        // One block of a split access is done. The data is already in the
+        // buffer of the original packet.
+        PacketPtr orig = parent->second;
+        splitParents.erase(parent);
+        delete pkt;
+
+        if (--splitPending[orig] != 0)
+            return;
+        splitPending.erase(orig);
+        orig->makeResponse();
+        pkt = orig;
+    }
+
+    DPRINTF(CacheStore, "Sending resp for addr %#x\n", pkt->getAddr());
+
+    // Simply forward to the cpu port
+    cpuPorts[port_id].sendPacket(pkt);
+}
+
 void
 SimpleCache::handleFunctional(PacketPtr pkt)
 {
-    if (accessFunctional(pkt)) {
+    std::vector<PacketPtr> sub_pkts = splitAccess(pkt);
+    if (!sub_pkts.empty()) {
+        for (auto sub_pkt : sub_pkts) {
+            handleFunctional(sub_pkt);
+            delete sub_pkt;
+        }
+        pkt->makeResponse();
+        return;
+    }
+
+    if (accessFunctional(pkt, nullptr, true)) {
+        pkt->makeResponse();
+    } else if (memPort.trySatisfyFunctional(pkt)) {
+        // The block is on its way back to memory
         pkt->makeResponse();
     } else {
         memPort.sendFunctional(pkt);
     }
+
+    // Writes waiting for their block in an MSHR are younger than anything
+    // in the cache or in memory
+    mshrQueue.trySatisfyFunctional(pkt);
+    instMshrQueue.trySatisfyFunctional(pkt);
 }
 
 void
-SimpleCache::accessTiming(PacketPtr pkt)
+SimpleCache::accessTiming(PacketPtr pkt, int port_id)
 {
-    bool hit = accessFunctional(pkt);
+    std::vector<PacketPtr> sub_pkts = splitAccess(pkt);
+    if (!sub_pkts.empty()) {
+        // Access every block in parallel, the response is sent by
+        // sendResponse once the last block is done
+        stats.splitAccesses++;
+        splitPending[pkt] = sub_pkts.size();
+        for (auto sub_pkt : sub_pkts) {
+            splitParents[sub_pkt] = pkt;
+        }
+        for (auto sub_pkt : sub_pkts) {
+            accessTiming(sub_pkt, port_id);
+        }
+        return;
+    }
+
+    Addr block_addr = pkt->getBlockAddr(blockSize);
+
+    // A block being fetched is not in the cache yet, the access has to wait
+    // for the fill like the miss that allocated the MSHR
+    SimpleMSHRQueue &mshrs = mshrsFor(pkt);
+    SimpleMSHR *mshr = mshrs.findMatch(block_addr);
+
+    // Evictions from the caches above need no response. A writeback to a
+    // block being fetched waits for the fill, like any write.
+    if (pkt->isEviction() && (mshr == nullptr || !pkt->hasData())) {
+        for (auto writeback : handleEviction(pkt))
+            memPort.sendPacket(writeback);
+        // In timing mode the receiver of an eviction frees it
+        delete pkt;
+        return;
+    }
+
+    CacheStore::AccessInfo info;
+    bool hit = (mshr == nullptr) && accessFunctional(pkt, &info);
 
     DPRINTF(CacheStore, "%s for packet: %s\n", hit ? "Hit" : "Miss",
             pkt->print());
 
     if (hit) {
         // Respond to the CPU side
-        stats.hits++; // update stats
+        recordHit(pkt, info);
         DDUMP(CacheStore, pkt->getConstPtr<uint8_t>(), pkt->getSize());
         pkt->makeResponse();
-        sendResponse(pkt);
-    } else {
-        stats.misses++; // update stats
-        missTime = curTick();
-        // Forward to the memory side.
-        // We can't directly forward the packet unless it is exactly the size
-        // of the cache line, and aligned. Check for that here.
-        Addr addr = pkt->getAddr();
-        Addr block_addr = pkt->getBlockAddr(blockSize);
-        unsigned size = pkt->getSize();
-        if (addr == block_addr && size == blockSize) {
-            // Aligned and block size. We can just forward.
-            DPRINTF(CacheStore, "forwarding packet\n");
-            memPort.sendPacket(pkt);
-        } else {
-            DPRINTF(CacheStore, "Upgrading packet to block size\n");
-            panic_if(addr - block_addr + size > blockSize,
-                     "Cannot handle accesses that span multiple cache lines");
-            // Unaligned access to one cache block
-            assert(pkt->needsResponse());
-            MemCmd cmd;
-            if (pkt->isWrite() || pkt->isRead()) {
-                // Read the data from memory to write into the block.
-                // We'll write the data in the cache (i.e., a writeback cache)
-                cmd = MemCmd::ReadReq;
-            } else {
-                panic("Unknown packet type in upgrade size");
-            }
 
-            // Create a new packet that is blockSize
-            PacketPtr new_pkt = new Packet(pkt->req, cmd, blockSize);
-            new_pkt->allocate();
+        PacketPtr writeback = releaseExclusive(pkt);
+        if (writeback != nullptr)
+            memPort.sendPacket(writeback);
+        if (pkt->isWrite()) {
+            for (auto writeback : recompress(block_addr))
+                memPort.sendPacket(writeback);
+        }
 
-            // Should now be block aligned
-            assert(new_pkt->getAddr() == new_pkt->getBlockAddr(blockSize));
+        if (info.decompression_latency == 0) {
+            sendResponse(pkt, port_id);
+            return;
+        }
 
-            // Save the old packet
-            originalPacket = pkt;
+        // A compressed line has to be decompressed first
+        pendingAccesses++;
+        schedule(new EventFunctionWrapper([this, pkt, port_id]
+                                          {
+                                              pendingAccesses--;
+                                              sendResponse(pkt, port_id);
+                                              tryDrainDone();
+                                          },
+                                          name() + ".decompressEvent", true),
+                 clockEdge(info.decompression_latency));
+        return;
+    }
 
-            DPRINTF(CacheStore, "forwarding packet\n");
-            memPort.sendPacket(new_pkt);
+    assert(pkt->needsResponse() || pkt->isEviction());
+    panic_if(!pkt->isWrite() && !pkt->isRead(),
+             "Unknown packet type in upgrade size");
+
+    if (mshr != nullptr) {
+        // Merge with the outstanding miss to the same block
+        if (mshrs.allocateTarget(mshr, pkt, port_id, curTick())) {
+            DPRINTF(CacheStore, "Merging into MSHR for addr %#x\n",
+                    block_addr);
+            if (!pkt->isEviction()) {
+                recordMiss(pkt);
+                // The block was prefetched, but not early enough
+                if (mshr->targets.front().pkt->cmd.isHWPrefetch())
+                    stats.prefetchLate++;
+            }
+            stats.mshrMerges++;
+            return;
         }
+    } else if (!mshrs.isFull()) {
+        recordMiss(pkt);
+        mshrs.allocate(block_addr, pkt, port_id, curTick());
+
+        // Forward to the memory side.
+        // Always fetch the whole block: we'll write the data in the cache
+        // (i.e., a writeback cache) once it arrives, and every target of
+        // the MSHR is then served from the cache.
+        PacketPtr new_pkt = new Packet(pkt->req, MemCmd::ReadReq, blockSize);
+        new_pkt->allocate();
+
+        // Should now be block aligned
+        assert(new_pkt->getAddr() == new_pkt->getBlockAddr(blockSize));
+
+        DPRINTF(CacheStore, "forwarding packet\n");
+        memPort.sendPacket(new_pkt);
+        return;
+    }
+
+    // No MSHR (or no room for another target): wait for one to be freed
+    DPRINTF(CacheStore, "No MSHR for addr %#x, stalling\n", block_addr);
+    stalledAccesses.emplace_back(pkt, port_id);
+}
+
+std::vector<PacketPtr>
+SimpleCache::splitAccess(PacketPtr pkt) const
+{
+    std::vector<PacketPtr> sub_pkts;
+
+    Addr addr = pkt->getAddr();
+    Addr end = addr + pkt->getSize();
+    if (end - pkt->getBlockAddr(blockSize) <= blockSize)
+        return sub_pkts;
+
+    panic_if(!pkt->isWrite() && !pkt->isRead(),
+             "Unknown packet type in upgrade size");
+
+    DPRINTF(CacheStore, "Splitting %s\n", pkt->print());
+
+    uint8_t *data = pkt->getPtr<uint8_t>();
+    while (addr < end) {
+        Addr next = std::min(end, (addr | (blockSize - 1)) + 1);
+        unsigned size = next - addr;
+
+        // Same requestor and flags, the sub-accesses are still the
+        // original access as far as the cache is concerned
+        RequestPtr req = std::make_shared<Request>(
+            addr, size, pkt->req->getFlags(), pkt->req->requestorId());
+        if (pkt->req->hasPC())
+            req->setPC(pkt->req->getPC());
+
+        PacketPtr sub_pkt = new Packet(req, pkt->cmd);
+        sub_pkt->dataStatic(data + (addr - pkt->getAddr()));
+        sub_pkts.push_back(sub_pkt);
+
+        addr = next;
+    }
+
+    return sub_pkts;
+}
+
+void
+SimpleCache::retryStalledAccesses()
+{
+    // Accesses that stall again are queued back by accessTiming
+    std::deque<std::pair<PacketPtr, int>> stalled;
+    stalled.swap(stalledAccesses);
+    for (auto &access : stalled) {
+        accessTiming(access.first, access.second);
     }
 }
 
@@ -362,14 +1112,45 @@ SimpleCache::accessTiming(PacketPtr pkt)
  * @return true stands for 'hit'
 */
 bool
-SimpleCache::accessFunctional(PacketPtr pkt)
+SimpleCache::accessFunctional(PacketPtr pkt, CacheStore::AccessInfo *info,
+                              bool debug)
 {
     Addr block_addr = pkt->getBlockAddr(blockSize);
-    auto it = cache_store->find(block_addr);
+    if (pkt->isWrite())
+        invalidateInst(block_addr);
+
+    CacheStore *store = storeFor(pkt);
+    auto it = store->find(block_addr, pkt, info);
+    if (it.second == nullptr && store == inst_store) {
+        // A fetch of a block the data store has is served from there
+        uint8_t *data = cache_store->data_of(block_addr);
+        if (data != nullptr && debug) {
+            // Debug accesses must not change what the cache holds
+            if (pkt->isWrite())
+                pkt->writeDataToBlock(data, blockSize);
+            else
+                pkt->setDataFromBlock(data, blockSize);
+            return true;
+        }
+        if (data != nullptr) {
+            stats.instFillsFromData++;
+            Packet fill(pkt->req, MemCmd::ReadResp, blockSize);
+            fill.dataStatic(data);
+            // Fetched lines are never dirty and memory has them: the victim
+            // can be dropped whether the access is atomic or timing
+            for (auto writeback : insert(&fill))
+                delete writeback;
+            it = store->find(block_addr, pkt, info);
+        }
+    }
     if (it.second != nullptr) {  // hit
         if (pkt->isWrite()) {
             // Write the data into the block in the cache
             pkt->writeDataToBlock(it.second, blockSize);
+            // The line now differs from memory and has to be written back
+            // (a clean line written back from above still matches memory)
+            if (pkt->cmd != MemCmd::WritebackClean)
+                store->set_dirty(block_addr);
         } else if (pkt->isRead()) {
             // Read the data out of the cache block into the packet
             pkt->setDataFromBlock(it.second, blockSize);
@@ -381,43 +1162,306 @@ SimpleCache::accessFunctional(PacketPtr pkt)
     return false;
 }
 
-void
+std::vector<PacketPtr>
 SimpleCache::insert(PacketPtr pkt)
 {
     // The packet should be aligned.
     assert(pkt->getAddr() ==  pkt->getBlockAddr(blockSize));
-    // The pkt should be a response
-    assert(pkt->isResponse());
+    // The pkt should be a fill or a writeback from above
+    assert(pkt->hasData());
+
+    // Only the data store is partitioned
+    CacheStore *store = storeFor(pkt);
+    int partition = (store == cache_store) ? partitionOf(pkt) : -1;
+
+    // The room a block needs depends on how well it compresses
+    Cycles decomp_lat;
+    int size_bits = store->compress(pkt->getConstPtr<uint8_t>(), decomp_lat);
+
+    // One victim is enough without compression. With super-blocks, the
+    // lines of the victim super-block go one by one until the block fits.
+    std::vector<PacketPtr> writebacks;
+    while (store->isFull(pkt->getAddr(), partition, size_bits)) {
+        auto block = store->pick_line(pkt->getAddr(), partition);
+        PacketPtr writeback = evictLine(store, block.first, block.second);
+        if (writeback != nullptr)
+            writebacks.push_back(writeback);
+    }
+
+    DPRINTF(CacheStore, "Inserting %s\n", pkt->print());
+    DDUMP(CacheStore, pkt->getConstPtr<uint8_t>(), blockSize);
+
+    // Insert the address into the cache store, which hands back the block of
+    // its arena the data goes to
+    uint8_t *data = store->set(pkt->getAddr(), pkt, partition, size_bits,
+                               decomp_lat);
+    updateOccupancy();
+
+    // Write the data into the cache
+    pkt->writeDataToBlock(data, blockSize);
 
-    if (cache_store->isFull(pkt->getAddr())) {
-        auto block = cache_store->pick_line(pkt->getAddr());
-        DPRINTF(CacheStore, "Removing addr %#x\n", block.first);
+    return writebacks;
+}
+
+PacketPtr
+SimpleCache::evictLine(CacheStore *store, Addr addr, uint8_t *data)
+{
+    DPRINTF(CacheStore, "Removing addr %#x\n", addr);
+    if (store == cache_store)
+        stats.setEvictions[cache_store->set_of(addr)]++;
+
+    // Keep the hierarchy above inclusive. A dirty copy above is more
+    // recent than ours and is written back in its place.
+    bool dirty = store->is_dirty(addr);
+    if (inclusion == enums::Inclusive) {
+        for (auto upper : upperCaches) {
+            dirty = upper->backInvalidate(addr, data) || dirty;
+        }
+    }
+
+    if (dirty) {
+        stats.dirtyEvictions++;
+    } else {
+        stats.cleanEvictions++;
+    }
+    PacketPtr writeback = evictionPacket(addr, data, dirty);
 
-        // Write back the data.
-        // Create a new request-packet pair
-        RequestPtr req = std::make_shared<Request>(block.first, blockSize, 0, 0);
-        PacketPtr new_pkt = new Packet(req, MemCmd::WritebackDirty, blockSize);
-        new_pkt->dataDynamic(block.second);
+    // Delete this entry
+    if (store == cache_store)
+        releasePrefetched(addr);
+    store->erase(addr);
+    return writeback;
+}
 
+std::vector<PacketPtr>
+SimpleCache::recompress(Addr block_addr)
+{
+    std::vector<PacketPtr> writebacks;
+    if (cache_store->data_of(block_addr) == nullptr)
+        return writebacks;
+
+    for (Addr addr : cache_store->recompress(block_addr)) {
+        stats.expansionEvictions++;
+        PacketPtr writeback = evictLine(cache_store, addr,
+                                        cache_store->data_of(addr));
+        if (writeback != nullptr)
+            writebacks.push_back(writeback);
+    }
+    updateOccupancy();
+    return writebacks;
+}
+
+PacketPtr
+SimpleCache::evictionPacket(Addr addr, const uint8_t *data, bool dirty)
+{
+    // Create a new request-packet pair
+    RequestPtr req = std::make_shared<Request>(addr, blockSize, 0, 0);
+    PacketPtr pkt = nullptr;
+
+    if (dirty || writebackClean) {
+        // Write back the data. The victim block belongs to the CacheStore
+        // arena and is about to be refilled, so the packet needs its own
+        // copy of the data.
+        pkt = new Packet(req, dirty ? MemCmd::WritebackDirty :
+                                      MemCmd::WritebackClean, blockSize);
+        pkt->allocate();
+        pkt->setData(data);
         DPRINTF(CacheStore, "Writing packet back %s\n", pkt->print());
-        // Send the write to memory
-        memPort.sendPacket(new_pkt);
+    } else if (sendCleanEvict) {
+        // Memory already has the data. Tell the memory side about the
+        // eviction without any data instead of dropping the line silently.
+        pkt = new Packet(req, MemCmd::CleanEvict);
+        DPRINTF(CacheStore, "Sending clean evict %s\n", pkt->print());
+    }
+
+    return pkt;
+}
+
+std::vector<PacketPtr>
+SimpleCache::handleEviction(PacketPtr pkt)
+{
+    DPRINTF(CacheStore, "Got eviction %s\n", pkt->print());
+
+    // A CleanEvict carries no data and memory is up to date, nothing to do
+    if (!pkt->hasData())
+        return {};
+
+    stats.upperWritebacks++;
+
+    // Update the line if it is here. Otherwise (non-inclusive and exclusive
+    // caches) allocate it: this is how a victim cache is filled.
+    if (accessFunctional(pkt))
+        return recompress(pkt->getBlockAddr(blockSize));
 
-        // Delete this entry
-        cache_store->erase(block.first);
+    std::vector<PacketPtr> writebacks = insert(pkt);
+    if (pkt->cmd == MemCmd::WritebackDirty)
+        cache_store->set_dirty(pkt->getBlockAddr(blockSize));
+    return writebacks;
+}
+
+PacketPtr
+SimpleCache::releaseExclusive(PacketPtr pkt)
+{
+    if (inclusion != enums::Exclusive || !pkt->isRead())
+        return nullptr;
+
+    // The block moves up to the requesting cache, which gets it clean: a
+    // dirty copy has to reach memory first.
+    Addr block_addr = pkt->getBlockAddr(blockSize);
+    CacheStore *store = storeFor(pkt);
+    PacketPtr writeback = nullptr;
+    if (store->is_dirty(block_addr)) {
+        writeback = evictionPacket(block_addr, store->data_of(block_addr),
+                                   true);
     }
+    store->erase(block_addr);
+    updateOccupancy();
+    return writeback;
+}
 
-    DPRINTF(CacheStore, "Inserting %s\n", pkt->print());
-    DDUMP(CacheStore, pkt->getConstPtr<uint8_t>(), blockSize);
+bool
+SimpleCache::backInvalidate(Addr block_addr, uint8_t *data)
+{
+    // The caches above hold the most recent copy, if any
+    bool dirty = false;
+    for (auto upper : upperCaches) {
+        dirty = upper->backInvalidate(block_addr, data) || dirty;
+    }
 
-    // Allocate space for the cache block data
-    uint8_t *data = new uint8_t[blockSize];
+    uint8_t *block = cache_store->data_of(block_addr);
+    if (block != nullptr) {
+        DPRINTF(CacheStore, "Back-invalidating addr %#x\n", block_addr);
+        stats.backInvalidations++;
+        if (!dirty && cache_store->is_dirty(block_addr)) {
+            std::memcpy(data, block, blockSize);
+            dirty = true;
+        }
+        releasePrefetched(block_addr);
+        cache_store->erase(block_addr);
+    }
+    // Fetched lines are never dirty, they only have to go
+    if (inst_store != nullptr && inst_store->data_of(block_addr) != nullptr) {
+        stats.backInvalidations++;
+        inst_store->erase(block_addr);
+    }
+    updateOccupancy();
+
+    // Writebacks still queued are older than the line, if any, and would
+    // install the block below again
+    unsigned squashed = memPort.squashEvictions(block_addr, data, dirty);
+    stats.inFlightInvalidations += squashed;
+
+    // A fill still on its way would install the block here but not below
+    for (auto mshrs : {&mshrQueue, &instMshrQueue}) {
+        SimpleMSHR *mshr = mshrs->findMatch(block_addr);
+        if (mshr != nullptr && !mshr->invalidated) {
+            DPRINTF(CacheStore, "Back-invalidating the fill of addr %#x\n",
+                    block_addr);
+            stats.inFlightInvalidations++;
+            mshr->invalidated = true;
+        }
+    }
 
-    // Insert the data and address into the cache store
-    cache_store->set(pkt->getAddr(), data);
+    // Write buffer entries were freed
+    if (squashed != 0) {
+        unblock();
+        tryDrainDone();
+    }
 
-    // Write the data into the cache
-    pkt->writeDataToBlock(data, blockSize);
+    return dirty;
+}
+
+bool
+SimpleCache::isDrained() const
+{
+    if (pendingAccesses != 0 || !mshrQueue.isEmpty() ||
+        !instMshrQueue.isEmpty() || !stalledAccesses.empty() ||
+        !memPort.isIdle()) {
+        return false;
+    }
+    for (auto& port : cpuPorts) {
+        if (!port.isIdle())
+            return false;
+    }
+    return true;
+}
+
+void
+SimpleCache::tryDrainDone()
+{
+    if (drainState() == DrainState::Draining && isDrained()) {
+        DPRINTF(Drain, "SimpleCache done draining\n");
+        signalDrainDone();
+    }
+}
+
+DrainState
+SimpleCache::drain()
+{
+    // No prefetch is issued until the drain is over
+    if (prefetchEvent.scheduled())
+        deschedule(prefetchEvent);
+
+    if (isDrained()) {
+        DPRINTF(Drain, "SimpleCache drained\n");
+        return DrainState::Drained;
+    }
+
+    DPRINTF(Drain, "SimpleCache not drained\n");
+    return DrainState::Draining;
+}
+
+void
+SimpleCache::drainResume()
+{
+    schedulePrefetch();
+}
+
+void
+SimpleCache::memWriteback()
+{
+    // Functional writes, so that no timing state is created while the
+    // system is drained
+    cache_store->for_each_line([this](Addr addr, uint8_t *data, bool dirty)
+    {
+        if (!dirty)
+            return;
+
+        RequestPtr req = std::make_shared<Request>(addr, blockSize, 0, 0);
+        Packet packet(req, MemCmd::WriteReq);
+        packet.dataStatic(data);
+
+        DPRINTF(CacheStore, "Writing back addr %#x\n", addr);
+        memPort.sendFunctional(&packet);
+        cache_store->clean(addr);
+    });
+}
+
+void
+SimpleCache::memInvalidate()
+{
+    cache_store->invalidate_all();
+    if (inst_store != nullptr)
+        inst_store->invalidate_all();
+    updateOccupancy();
+}
+
+void
+SimpleCache::serialize(CheckpointOut &cp) const
+{
+    // The cache is drained, so everything is in the CacheStore
+    cache_store->serializeSection(cp, "cache_store");
+    if (inst_store != nullptr)
+        inst_store->serializeSection(cp, "inst_store");
+}
+
+void
+SimpleCache::unserialize(CheckpointIn &cp)
+{
+    cache_store->unserializeSection(cp, "cache_store");
+    if (inst_store != nullptr)
+        inst_store->unserializeSection(cp, "inst_store");
+    updateOccupancy();
 }
 
 AddrRangeList
@@ -436,17 +1480,148 @@ SimpleCache::sendRangeChange() const
     }
 }
 
-SimpleCache::SimpleCacheStats::SimpleCacheStats(statistics::Group *parent)
+SimpleCache::SimpleCacheStats::SimpleCacheStats(statistics::Group *parent,
+                                                int num_sets, int assoc,
+                                                int num_partitions,
+                                                int num_lines)
       : statistics::Group(parent),
       ADD_STAT(hits, statistics::units::Count::get(), "Number of hits"),
       ADD_STAT(misses, statistics::units::Count::get(), "Number of misses"),
       ADD_STAT(missLatency, statistics::units::Tick::get(),
                "Ticks for misses to the cache"),
+      ADD_STAT(dirtyEvictions, statistics::units::Count::get(),
+               "Number of evicted lines that were written back"),
+      ADD_STAT(cleanEvictions, statistics::units::Count::get(),
+               "Number of evicted lines dropped without a writeback"),
+      ADD_STAT(mshrMerges, statistics::units::Count::get(),
+               "Number of misses merged into an outstanding MSHR"),
+      ADD_STAT(blockedRequests, statistics::units::Count::get(),
+               "Number of requests refused because the MSHRs or the "
+               "write buffer were full"),
+      ADD_STAT(splitAccesses, statistics::units::Count::get(),
+               "Number of accesses split because they cross blocks"),
+      ADD_STAT(upperWritebacks, statistics::units::Count::get(),
+               "Number of lines written back by the caches above"),
+      ADD_STAT(backInvalidations, statistics::units::Count::get(),
+               "Number of lines invalidated to keep the caches above "
+               "inclusive"),
+      ADD_STAT(inFlightInvalidations, statistics::units::Count::get(),
+               "Number of fills not installed and of queued writebacks "
+               "dropped to keep the caches above inclusive"),
+      ADD_STAT(classHits, statistics::units::Count::get(),
+               "Number of hits of data accesses and instruction fetches"),
+      ADD_STAT(classMisses, statistics::units::Count::get(),
+               "Number of misses of data accesses and instruction fetches"),
+      ADD_STAT(dataMissLatency, statistics::units::Tick::get(),
+               "Ticks for data misses to the cache"),
+      ADD_STAT(instMissLatency, statistics::units::Tick::get(),
+               "Ticks for instruction fetch misses to the cache"),
+      ADD_STAT(instFillsFromData, statistics::units::Count::get(),
+               "Number of fetch misses filled from the data store"),
+      ADD_STAT(partitionHits, statistics::units::Count::get(),
+               "Number of data hits of each partition"),
+      ADD_STAT(partitionMisses, statistics::units::Count::get(),
+               "Number of data misses of each partition"),
+      ADD_STAT(partitionOccupancy, statistics::units::Count::get(),
+               "Average number of lines held by each partition"),
+      ADD_STAT(partitionWays, statistics::units::Count::get(),
+               "Average number of ways of each partition"),
+      ADD_STAT(repartitions, statistics::units::Count::get(),
+               "Number of times UCP handed the ways out"),
+      ADD_STAT(setHits, statistics::units::Count::get(),
+               "Number of hits per set"),
+      ADD_STAT(setMisses, statistics::units::Count::get(),
+               "Number of misses per set"),
+      ADD_STAT(setEvictions, statistics::units::Count::get(),
+               "Number of evictions per set"),
+      ADD_STAT(wayHits, statistics::units::Count::get(),
+               "Number of hits per way"),
+      ADD_STAT(setStackDistance, statistics::units::Count::get(),
+               "Hits per set by stack distance (number of other lines of "
+               "the set used since the line was last used)"),
+      ADD_STAT(decompressions, statistics::units::Count::get(),
+               "Number of hits on compressed lines"),
+      ADD_STAT(decompressionCycles, statistics::units::Cycle::get(),
+               "Cycles spent decompressing lines on hits"),
+      ADD_STAT(expansionEvictions, statistics::units::Count::get(),
+               "Number of lines evicted because a block sharing their "
+               "physical way no longer compressed well enough"),
+      ADD_STAT(storedBlocks, statistics::units::Count::get(),
+               "Average number of blocks held by the data store"),
+      ADD_STAT(effectiveCapacity, statistics::units::Ratio::get(),
+               "Average number of blocks held per physical line",
+               storedBlocks / statistics::constant(num_lines)),
+      ADD_STAT(prefetchIssued, statistics::units::Count::get(),
+               "Number of prefetches sent to memory"),
+      ADD_STAT(prefetchDropped, statistics::units::Count::get(),
+               "Number of prefetches dropped because the block was in the "
+               "cache or in an MSHR"),
+      ADD_STAT(prefetchUseful, statistics::units::Count::get(),
+               "Number of prefetched lines hit by a demand access"),
+      ADD_STAT(prefetchLate, statistics::units::Count::get(),
+               "Number of demand misses merged into a prefetch in flight"),
+      ADD_STAT(prefetchUnused, statistics::units::Count::get(),
+               "Number of prefetched lines evicted before any demand "
+               "access"),
+      ADD_STAT(prefetchAccuracy, statistics::units::Ratio::get(),
+               "Fraction of the issued prefetches used by a demand access, "
+               "on time or late",
+               (prefetchUseful + prefetchLate) / prefetchIssued),
+      ADD_STAT(prefetchCoverage, statistics::units::Ratio::get(),
+               "Fraction of the demand misses removed by the prefetches",
+               prefetchUseful / (prefetchUseful + misses)),
       ADD_STAT(hitRatio, statistics::units::Ratio::get(),
                "The ratio of hits to the total accesses to the cache",
                hits / (hits + misses))
 {
+    // Without a prefetcher, keep the prefetch stats out of the dump
+    for (auto pf_stat : {&prefetchIssued, &prefetchDropped, &prefetchUseful,
+                         &prefetchLate, &prefetchUnused}) {
+        pf_stat->flags(statistics::nozero);
+    }
+    prefetchAccuracy.flags(statistics::nozero | statistics::nonan);
+    prefetchCoverage.flags(statistics::nozero | statistics::nonan);
+
     missLatency.init(16); // number of buckets
+    dataMissLatency.init(16);
+    instMissLatency.init(16);
+
+    // Fetches only count as "inst" when they have a store of their own
+    classHits.init(2);
+    classMisses.init(2);
+    for (auto class_stat : {&classHits, &classMisses}) {
+        class_stat->subname(0, "data");
+        class_stat->subname(1, "inst");
+    }
+
+    // Most sets stay at zero in a short run, keep the dump readable
+    setHits.init(num_sets).flags(statistics::nozero);
+    setMisses.init(num_sets).flags(statistics::nozero);
+    setEvictions.init(num_sets).flags(statistics::nozero);
+    wayHits.init(assoc);
+
+    // One entry per partition, plus the requestors of no partition
+    partitionHits.init(num_partitions + 1);
+    partitionMisses.init(num_partitions + 1);
+    partitionOccupancy.init(num_partitions + 1);
+    partitionWays.init(std::max(num_partitions, 1)).flags(statistics::nozero);
+    for (int i = 0; i <= num_partitions; i++) {
+        std::string partition = (i < num_partitions) ? csprintf("p%d", i) :
+                                                       "other";
+        partitionHits.subname(i, partition);
+        partitionMisses.subname(i, partition);
+        partitionOccupancy.subname(i, partition);
+        if (i < num_partitions)
+            partitionWays.subname(i, partition);
+    }
+
+    setStackDistance.init(num_sets, assoc).flags(statistics::nozero);
+    for (int i = 0; i < num_sets; i++) {
+        setStackDistance.subname(i, csprintf("set%d", i));
+    }
+    for (int i = 0; i < assoc; i++) {
+        setStackDistance.ysubname(i, csprintf("%d", i));
+    }
 }
 
 } // namespace gem5
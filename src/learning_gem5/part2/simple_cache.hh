@@ -29,26 +29,45 @@
 #ifndef __LEARNING_GEM5_SIMPLE_CACHE_SIMPLE_CACHE_HH__
 #define __LEARNING_GEM5_SIMPLE_CACHE_SIMPLE_CACHE_HH__
 
+#include <deque>
+#include <memory>
+#include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "base/statistics.hh"
+#include "enums/SimpleCacheInclusion.hh"
+#include "enums/SimpleCachePartitioning.hh"
+#include "mem/cache/cache_accessor.hh"
+#include "mem/cache/prefetch/base.hh"
 #include "mem/port.hh"
 #include "params/SimpleCache.hh"
 #include "sim/clocked_object.hh"
+#include "sim/eventq.hh"
+#include "sim/probe/probe.hh"
 
 #include "./CacheStore/cache_store.hh"
+#include "./CacheStore/utility_partitioning.hh"
+#include "./SimpleMSHR/simple_mshr.hh"
 
 namespace gem5
 {
 
 /**
- * A very simple cache object. Has a fully-associative data store with random
- * replacement.
- * This cache is fully blocking (not non-blocking). Only a single request can
- * be outstanding at a time.
- * This cache is a writeback cache.
+ * A very simple cache object. Has a set-associative data store (CacheStore)
+ * whose victim selection is delegated to a configurable replacement policy.
+ * This cache is non-blocking: misses allocate an MSHR (requests to the same
+ * block are merged into it) and hits are served while misses are
+ * outstanding. It only stalls when the MSHRs or the write buffer are full.
+ * This cache is a writeback cache. Only dirty lines are written back.
+ * SimpleCaches stack into a hierarchy: a lower level takes the writebacks
+ * of the levels above, and is inclusive (back-invalidating them through
+ * upper_caches), exclusive (a victim cache for them) or neither (NINE).
+ * A hardware prefetcher may fill the data store: it observes the accesses
+ * through the Hit, Miss and Fill probe points and looks the cache up
+ * through the CacheAccessor interface.
  */
-class SimpleCache : public ClockedObject
+class SimpleCache : public ClockedObject, public CacheAccessor
 {
   private:
 
@@ -68,22 +87,23 @@ class SimpleCache : public ClockedObject
         /// True if the port needs to send a retry req.
         bool needRetry;
 
-        /// If we tried to send a packet and it was blocked, store it here
-        PacketPtr blockedPacket;
+        /// Responses we tried to send while the peer was busy, in order
+        std::deque<PacketPtr> blockedPackets;
 
       public:
         /**
          * Constructor. Just calls the superclass constructor.
          */
         CPUSidePort(const std::string& name, int id, SimpleCache *owner) :
-            ResponsePort(name, owner), id(id), owner(owner), needRetry(false),
-            blockedPacket(nullptr)
+            ResponsePort(name, owner), id(id), owner(owner), needRetry(false)
         { }
 
         /**
          * Send a packet across this port. This is called by the owner and
          * all of the flow control is hanled in this function.
          * This is a convenience function for the SimpleCache to send pkts.
+         * Several responses may be in flight, so packets that cannot be
+         * sent are queued and sent in order on a retry.
          *
          * @param packet to send.
          */
@@ -104,13 +124,20 @@ class SimpleCache : public ClockedObject
          */
         void trySendRetry();
 
+        /**
+         * @return true if no response is waiting to be sent
+         */
+        bool isIdle() const { return blockedPackets.empty(); }
+
       protected:
         /**
          * Receive an atomic request packet from the request port.
-         * No need to implement in this simple cache.
+         * Used to warm up the cache with an atomic CPU (fast-forward).
+         *
+         * @param packet the requestor sent.
+         * @return the latency of the access
          */
-        Tick recvAtomic(PacketPtr pkt) override
-        { panic("recvAtomic unimpl."); }
+        Tick recvAtomic(PacketPtr pkt) override;
 
         /**
          * Receive a functional request packet from the request port.
@@ -148,26 +175,63 @@ class SimpleCache : public ClockedObject
         /// The object that owns this object (SimpleCache)
         SimpleCache *owner;
 
-        /// If we tried to send a packet and it was blocked, store it here
-        PacketPtr blockedPacket;
+        /// Requests we tried to send while the peer was busy, in order.
+        /// The writebacks among them make up the write buffer.
+        std::deque<PacketPtr> blockedPackets;
+
+        /// Number of writebacks in blockedPackets
+        unsigned numWritebacks;
 
       public:
         /**
          * Constructor. Just calls the superclass constructor.
          */
         MemSidePort(const std::string& name, SimpleCache *owner) :
-            RequestPort(name, owner), owner(owner), blockedPacket(nullptr)
+            RequestPort(name, owner), owner(owner), numWritebacks(0)
         { }
 
         /**
          * Send a packet across this port. This is called by the owner and
          * all of the flow control is hanled in this function.
          * This is a convenience function for the SimpleCache to send pkts.
+         * Fills and writebacks that cannot be sent are queued in order, so
+         * a fill never overtakes a writeback of the same block.
          *
          * @param packet to send.
          */
         void sendPacket(PacketPtr pkt);
 
+        /**
+         * @return the number of writebacks waiting to be sent
+         */
+        unsigned writeBufferSize() const { return numWritebacks; }
+
+        /**
+         * Check a functional access against the writebacks waiting to be
+         * sent, they hold the only up-to-date copy of their block.
+         *
+         * @return true if the functional read is fully satisfied
+         */
+        bool trySatisfyFunctional(PacketPtr pkt);
+
+        /**
+         * Drop the queued evictions of a block, which an inclusive cache
+         * below is evicting: they would install it there again.
+         *
+         * @param block_addr block address of the line
+         * @param data where to copy the newest dirty data, if dirty is
+         *        false and a queued writeback has some
+         * @param dirty set once dirty data has been copied into data
+         * @return the number of evictions dropped
+         */
+        unsigned squashEvictions(Addr block_addr, uint8_t *data,
+                                 bool &dirty);
+
+        /**
+         * @return true if no request is waiting to be sent
+         */
+        bool isIdle() const { return blockedPackets.empty(); }
+
       protected:
         /**
          * Receive a timing response from the response port.
@@ -202,6 +266,111 @@ class SimpleCache : public ClockedObject
      */
     bool handleRequest(PacketPtr pkt, int port_id);
 
+    /**
+     * @return true if pkt cannot be accepted: all the MSHRs it would use are
+     *         in use or the write buffer is full
+     */
+    bool isBlocked(PacketPtr pkt);
+
+    /**
+     * @return true if pkt is an instruction fetch and fetches have a store
+     *         of their own (split_inst_data)
+     */
+    bool isInst(PacketPtr pkt) const;
+
+    /**
+     * @return the store holding the block of pkt: the instruction store for
+     *         fetches when split, the data store otherwise
+     */
+    CacheStore *storeFor(PacketPtr pkt);
+
+    /**
+     * @return the MSHRs tracking the misses of pkt, which follow its store
+     */
+    SimpleMSHRQueue &mshrsFor(PacketPtr pkt);
+
+    /**
+     * Drop the instruction copy of a block that is written, so that fetches
+     * see the new code. The data store keeps the only writable copy.
+     */
+    void invalidateInst(Addr block_addr);
+
+    /**
+     * Count a hit (or miss) of pkt in the totals, in its class and, for data
+     * accesses, in the per-set heatmaps.
+     */
+    void recordHit(PacketPtr pkt, const CacheStore::AccessInfo &info);
+    void recordMiss(PacketPtr pkt);
+    void recordMissLatency(PacketPtr pkt, Tick lat);
+
+    /**
+     * @return the partition of the requestor of pkt: the index of the first
+     *         partition_requestors prefix of its name, -1 if none matches
+     */
+    int partitionOf(PacketPtr pkt);
+
+    /**
+     * Count a demand access in the stats of its partition and, with UCP, in
+     * the shadow tags. Repartitions once every ucp_epoch accesses.
+     */
+    void monitorPartition(PacketPtr pkt, bool hit);
+
+    /**
+     * Hand the ways out again from the utility seen by the shadow tags
+     */
+    void repartition();
+
+    /**
+     * Sample the number of lines each partition holds
+     */
+    void updateOccupancy();
+
+    /**
+     * @return true if a prefetch may be issued now: a prefetcher is
+     *         attached, more than prefetch_reserved_mshrs MSHRs are free, the
+     *         memory side has nothing queued and the cache is not draining
+     */
+    bool canPrefetch() const;
+
+    /**
+     * Schedule prefetchEvent for when the next prefetch is ready, if one
+     * may be issued. Called whenever an access may have trained the
+     * prefetcher, or an MSHR or the memory side has been freed.
+     *
+     * @param delay cycles to wait at least, one after a prefetch was issued
+     */
+    void schedulePrefetch(Cycles delay = Cycles(0));
+
+    /**
+     * Issue the prefetches that are ready, as long as canPrefetch() holds.
+     * A prefetch of a block present or being fetched is dropped, the others
+     * allocate an MSHR of their own.
+     */
+    void issuePrefetches();
+
+    /**
+     * Tell the prefetcher about a block leaving the data store before any
+     * demand access used it, if it was prefetched.
+     */
+    void releasePrefetched(Addr block_addr);
+
+    /**
+     * Send a retry to every CPU-side port that was refused a request. Called
+     * whenever an MSHR or a write buffer entry is freed.
+     */
+    void unblock();
+
+    /**
+     * Handle an atomic request from the CPU side. A miss fetches the block
+     * from memory and inserts it right away; the victim is written back
+     * atomically as well.
+     *
+     * @param requesting packet
+     * @return the latency of the access (including the memory side on a
+     *         miss)
+     */
+    Tick handleAtomic(PacketPtr pkt);
+
     /**
      * Handle the respone from the memory side. Called from the memory port
      * on a timing response.
@@ -215,12 +384,12 @@ class SimpleCache : public ClockedObject
     /**
      * Send the packet to the CPU side.
      * This function assumes the pkt is already a response packet and forwards
-     * it to the correct port. This function also unblocks this object and
-     * cleans up the whole request.
+     * it to the correct port.
      *
      * @param the packet to send to the cpu side
+     * @param id of the port to send the response
      */
-    void sendResponse(PacketPtr pkt);
+    void sendResponse(PacketPtr pkt, int port_id);
 
     /**
      * Handle a packet functionally. Update the data on a write and get the
@@ -232,25 +401,121 @@ class SimpleCache : public ClockedObject
 
     /**
      * Access the cache for a timing access. This is called after the cache
-     * access latency has already elapsed.
+     * access latency has already elapsed. A hit is responded to right away,
+     * a miss is merged into the MSHR of its block or allocates a new one.
+     * An access crossing blocks is split and its blocks accessed in
+     * parallel; it is responded to once all of them are done.
+     *
+     * @param id of the port to send the response
+     */
+    void accessTiming(PacketPtr pkt, int port_id);
+
+    /**
+     * Split an access that crosses block boundaries into one sub-access per
+     * block. The sub-packets share the data buffer of the original packet,
+     * so a read is merged in place as the sub-accesses complete.
+     *
+     * @param packet of the access
+     * @return the sub-packets (owned by the caller), empty if the access
+     *         fits in one block
+     */
+    std::vector<PacketPtr> splitAccess(PacketPtr pkt) const;
+
+    /**
+     * Replay the accesses that found no MSHR (or no room for a target) once
+     * an MSHR has been freed.
      */
-    void accessTiming(PacketPtr pkt);
+    void retryStalledAccesses();
 
     /**
      * This is where we actually update / read from the cache. This function
      * is executed on both timing and functional accesses.
      *
+     * @param info if not nullptr, filled with the set (and way) accessed
+     * @param debug true for a functional access, which must not change
+     *        what the cache holds
      * @return true if a hit, false otherwise
      */
-    bool accessFunctional(PacketPtr pkt);
+    bool accessFunctional(PacketPtr pkt,
+                          CacheStore::AccessInfo *info = nullptr,
+                          bool debug = false);
+
+    /**
+     * Handle an eviction (writeback or CleanEvict) from a cache above. The
+     * data is written into the line, which is allocated if not present.
+     * The packet is not freed.
+     *
+     * @param the eviction packet
+     * @return the writebacks (or CleanEvicts) of the victims if a line had
+     *         to be allocated, or of the lines a compressed line grew out of
+     */
+    std::vector<PacketPtr> handleEviction(PacketPtr pkt);
+
+    /**
+     * An exclusive cache gives up a block once it is read by the cache
+     * above. Does nothing for other policies or for writes.
+     *
+     * @param the request that hit
+     * @return a writeback if the block was dirty, nullptr otherwise
+     */
+    PacketPtr releaseExclusive(PacketPtr pkt);
+
+    /**
+     * Create the packet that tells the memory side about an evicted line:
+     * WritebackDirty, WritebackClean (writeback_clean) or CleanEvict
+     * (send_clean_evict), depending on the line and the parameters.
+     *
+     * @param addr block address of the line
+     * @param data of the line, copied into the packet
+     * @param dirty whether memory is stale
+     * @return the packet, nullptr if nothing has to be sent
+     */
+    PacketPtr evictionPacket(Addr addr, const uint8_t *data, bool dirty);
+
+    /**
+     * Evict a line: back-invalidate the caches above if inclusive, and
+     * erase it from its store.
+     *
+     * @param store the store holding the line
+     * @param addr block address of the line
+     * @param data of the line
+     * @return the packet telling the memory side, nullptr if none
+     */
+    PacketPtr evictLine(CacheStore *store, Addr addr, uint8_t *data);
+
+    /**
+     * Compress a block of the data store again once it has been written.
+     * The blocks sharing its physical way are evicted if it no longer
+     * compresses well enough to share it.
+     *
+     * @param block_addr address of the block written
+     * @return the writebacks (or CleanEvicts) of the evicted blocks
+     */
+    std::vector<PacketPtr> recompress(Addr block_addr);
 
     /**
      * Insert a block into the cache. If there is no room left in the cache,
-     * then this function evicts a random entry t make room for the new block.
+     * then this function evicts the victim picked by the replacement policy
+     * to make room for the new block (with compression, a whole super-block
+     * may have to go).
      *
      * @param packet with the data (and address) to insert into the cache
+     * @return the writebacks (or CleanEvicts) of the victims. The caller
+     *         sends them in its own access mode.
+     */
+    std::vector<PacketPtr> insert(PacketPtr pkt);
+
+    /**
+     * @return true if there is no outstanding work: no access waiting for
+     *         the latency or an MSHR, and no packet queued on the ports
      */
-    void insert(PacketPtr pkt);
+    bool isDrained() const;
+
+    /**
+     * Tell the drain manager we are done if a drain is in progress and
+     * the last outstanding access just completed.
+     */
+    void tryDrainDone();
 
     /**
      * Return the address ranges this cache is responsible for. Just use the
@@ -271,37 +536,155 @@ class SimpleCache : public ClockedObject
     /// The block size for the cache
     const unsigned blockSize;
 
+    /// Send a CleanEvict for clean victims instead of dropping them silently
+    const bool sendCleanEvict;
+
+    /// Write clean victims back with their data (for an exclusive cache below)
+    const bool writebackClean;
+
+    /// Inclusion policy with respect to the caches above
+    const enums::SimpleCacheInclusion inclusion;
+
+    /// Caches directly above, back-invalidated when inclusive
+    const std::vector<SimpleCache *> upperCaches;
+
     /// Instantiation of the CPU-side port
     std::vector<CPUSidePort> cpuPorts;
 
     /// Instantiation of the memory-side port
     MemSidePort memPort;
 
-    /// True if this cache is currently blocked waiting for a response.
-    bool blocked;
+    /// Outstanding misses, one MSHR per block being fetched
+    SimpleMSHRQueue mshrQueue;
+
+    /// Outstanding instruction misses, so that fetches do not wait behind
+    /// data misses (only used with split_inst_data)
+    SimpleMSHRQueue instMshrQueue;
+
+    /// Number of writebacks that can wait for the memory side
+    const unsigned writeBuffers;
 
-    /// Packet that we are currently handling. Used for upgrading to larger
-    /// cache line sizes
-    PacketPtr originalPacket;
+    /// Original packet of every sub-access in flight
+    std::unordered_map<PacketPtr, PacketPtr> splitParents;
 
-    /// The port to send the response when we recieve it back
-    int waitingPortId;
+    /// Number of sub-accesses still in flight for each split packet
+    std::unordered_map<PacketPtr, unsigned> splitPending;
 
-    /// For tracking the miss latency
-    Tick missTime;
+    /// Accesses accepted but still waiting for the access latency
+    unsigned pendingAccesses;
+
+    /// Accesses that missed while no MSHR (or target) was free, with the
+    /// port to respond to. They are replayed when an MSHR is freed.
+    std::deque<std::pair<PacketPtr, int>> stalledAccesses;
 
     /// introduce CacheStore to replace unordered_map
     /// remember to construct and destruct the object
     CacheStore * cache_store;
 
+    /// Store for instruction fetches when split_inst_data is set, nullptr
+    /// otherwise (fetches then share cache_store)
+    CacheStore * inst_store;
+
+    /// How the ways of cache_store are shared among the partitions
+    const enums::SimpleCachePartitioning partitioning;
+
+    /// Name prefix of the requestors of each partition
+    const std::vector<std::string> partitionRequestors;
+
+    /// To look the requestor names up
+    System *system;
+
+    /// Partition of every requestor seen so far
+    std::unordered_map<RequestorID, int> requestorPartitions;
+
+    /// Shadow tags and allocation of UCP, nullptr for other partitionings
+    std::unique_ptr<UtilityPartitioning> ucp;
+
+    /// Accesses between two UCP repartitions, and since the last one
+    const unsigned ucpEpoch;
+    unsigned ucpAccesses;
+
+    /// Prefetcher filling the data store, nullptr if none
+    prefetch::Base *prefetcher;
+
+    /// MSHRs that prefetches leave to demand misses
+    const unsigned prefetchReservedMshrs;
+
+    /// Issues the prefetches once they are ready
+    EventFunctionWrapper prefetchEvent;
+
+    /// Probe points the prefetcher listens to by default
+    ProbePointArg<PacketPtr> *ppHit;
+    ProbePointArg<PacketPtr> *ppMiss;
+    ProbePointArg<PacketPtr> *ppFill;
+
     /// Cache statistics
   protected:
     struct SimpleCacheStats : public statistics::Group
     {
-        SimpleCacheStats(statistics::Group *parent);
+        SimpleCacheStats(statistics::Group *parent, int num_sets,
+                         int assoc, int num_partitions, int num_lines);
         statistics::Scalar hits;
         statistics::Scalar misses;
         statistics::Histogram missLatency;
+        statistics::Scalar dirtyEvictions;
+        statistics::Scalar cleanEvictions;
+        statistics::Scalar mshrMerges;
+        statistics::Scalar blockedRequests;
+        statistics::Scalar splitAccesses;
+        statistics::Scalar upperWritebacks;
+        statistics::Scalar backInvalidations;
+        statistics::Scalar inFlightInvalidations;
+
+        /// Hits and misses of data accesses and instruction fetches
+        statistics::Vector classHits;
+        statistics::Vector classMisses;
+        statistics::Histogram dataMissLatency;
+        statistics::Histogram instMissLatency;
+        /// Fetch misses served by a copy in the data store
+        statistics::Scalar instFillsFromData;
+
+        /// Per partition (and "other" for the remaining requestors), to
+        /// quantify what isolation buys
+        statistics::Vector partitionHits;
+        statistics::Vector partitionMisses;
+        statistics::AverageVector partitionOccupancy;
+        /// Ways of each partition, as set by UCP
+        statistics::AverageVector partitionWays;
+        statistics::Scalar repartitions;
+
+        /// Per-set heatmaps, to spot set conflicts
+        statistics::Vector setHits;
+        statistics::Vector setMisses;
+        statistics::Vector setEvictions;
+        /// Hits per way
+        statistics::Vector wayHits;
+        /// Stack distance of the hits within their set
+        statistics::Vector2d setStackDistance;
+
+        /// Hits on compressed lines, and the cycles spent decompressing
+        statistics::Scalar decompressions;
+        statistics::Scalar decompressionCycles;
+        /// Lines evicted because a block sharing their way grew on a write
+        statistics::Scalar expansionEvictions;
+        /// Blocks held by the data store, and per physical line
+        statistics::Average storedBlocks;
+        statistics::Formula effectiveCapacity;
+
+        /// Prefetches sent to memory, and those dropped because the block
+        /// was present or already being fetched
+        statistics::Scalar prefetchIssued;
+        statistics::Scalar prefetchDropped;
+        /// Prefetched lines hit by a demand access, demand misses merged
+        /// into a prefetch still in flight, and prefetched lines evicted
+        /// before any use
+        statistics::Scalar prefetchUseful;
+        statistics::Scalar prefetchLate;
+        statistics::Scalar prefetchUnused;
+        /// Issued prefetches a demand access used, on time or late
+        statistics::Formula prefetchAccuracy;
+        /// Demand misses the prefetches removed
+        statistics::Formula prefetchCoverage;
         statistics::Formula hitRatio;
     } stats;
 
@@ -328,6 +711,66 @@ class SimpleCache : public ClockedObject
     Port &getPort(const std::string &if_name,
                   PortID idx=InvalidPortID) override;
 
+    /**
+     * Register the Hit, Miss and Fill probe points, notified with the
+     * demand accesses (before they are turned into responses) and fills.
+     */
+    void regProbePoints() override;
+
+    /** @{ */
+    /**
+     * Lookups for the prefetcher. Only the data store is prefetched into,
+     * and the cache never coalesces writes.
+     */
+    bool inCache(Addr addr, bool is_secure) const override;
+    bool hasBeenPrefetched(Addr addr, bool is_secure) const override;
+    bool inMissQueue(Addr addr, bool is_secure) const override;
+    bool coalesce() const override { return false; }
+    /** @} */
+
+    /**
+     * Invalidate a block in this cache and in the caches above it, because
+     * an inclusive cache below evicts it. A fill of the block in flight is
+     * not installed, and the writebacks of the block still queued are
+     * dropped, their data going down with the eviction instead.
+     *
+     * @param block_addr block address of the line
+     * @param data where to copy the most recent dirty copy, if any
+     * @return true if a dirty copy was found (and copied into data)
+     */
+    bool backInvalidate(Addr block_addr, uint8_t *data);
+
+    /**
+     * Drain the cache before a CPU switch or a checkpoint: wait until all
+     * outstanding misses have been filled and every queued packet has been
+     * sent. The contents stay in the cache, so they survive a switch.
+     */
+    DrainState drain() override;
+
+    /**
+     * Issue prefetches again after a drain.
+     */
+    void drainResume() override;
+
+    /**
+     * Write back all the dirty lines to memory (functionally). Called
+     * before switching to a CPU that bypasses the caches.
+     */
+    void memWriteback() override;
+
+    /**
+     * Invalidate all the lines. Dirty data must have been written back
+     * with memWriteback() first.
+     */
+    void memInvalidate() override;
+
+    /**
+     * Checkpoint the contents of the CacheStore, so that a restored
+     * simulation starts with a warm cache.
+     */
+    void serialize(CheckpointOut &cp) const override;
+    void unserialize(CheckpointIn &cp) override;
+
 };
 
 } // namespace gem5
@@ -58,6 +58,7 @@
 #include "debug/Cache.hh"
 #include "debug/CachePort.hh"
 #include "enums/Clusivity.hh"
+#include "mem/cache/cache_accessor.hh"
 #include "mem/cache/cache_blk.hh"
 #include "mem/cache/compressors/base.hh"
 #include "mem/cache/mshr_queue.hh"
@@ -92,7 +93,7 @@ struct BaseCacheParams;
 /**
  * A basic cache interface. Implements some common functions for speed.
  */
-class BaseCache : public ClockedObject
+class BaseCache : public ClockedObject, public CacheAccessor
 {
   protected:
     /**
@@ -1276,11 +1277,11 @@ class BaseCache : public ClockedObject
         memSidePort.schedSendEvent(time);
     }
 
-    bool inCache(Addr addr, bool is_secure) const {
+    bool inCache(Addr addr, bool is_secure) const override {
         return tags->findBlock(addr, is_secure);
     }
 
-    bool hasBeenPrefetched(Addr addr, bool is_secure) const {
+    bool hasBeenPrefetched(Addr addr, bool is_secure) const override {
         CacheBlk *block = tags->findBlock(addr, is_secure);
         if (block) {
             return block->wasPrefetched();
@@ -1289,7 +1290,7 @@ class BaseCache : public ClockedObject
         }
     }
 
-    bool inMissQueue(Addr addr, bool is_secure) const {
+    bool inMissQueue(Addr addr, bool is_secure) const override {
         return mshrQueue.findMatch(addr, is_secure);
     }
 
@@ -1315,7 +1316,7 @@ class BaseCache : public ClockedObject
      *
      * @return True if the cache is coalescing writes
      */
-    bool coalesce() const;
+    bool coalesce() const override;
 
 
     /**
@@ -48,7 +48,6 @@
 #include <cassert>
 
 #include "base/intmath.hh"
-#include "mem/cache/base.hh"
 #include "params/BasePrefetcher.hh"
 #include "sim/system.hh"
 
@@ -94,7 +93,8 @@ Base::PrefetchListener::notify(const PacketPtr &pkt)
 }
 
 Base::Base(const BasePrefetcherParams &p)
-    : ClockedObject(p), listeners(), cache(nullptr), blkSize(p.block_size),
+    : ClockedObject(p), listeners(), cache(nullptr), system(nullptr),
+      probeManager(nullptr), blkSize(p.block_size),
       lBlkSize(floorLog2(blkSize)), onMiss(p.on_miss), onRead(p.on_read),
       onWrite(p.on_write), onData(p.on_data), onInst(p.on_inst),
       requestorId(p.sys->getRequestorId(this)),
@@ -108,13 +108,16 @@ Base::Base(const BasePrefetcherParams &p)
 }
 
 void
-Base::setCache(BaseCache *_cache)
+Base::setParentInfo(System *sys, ProbeManager *pm, CacheAccessor *_cache,
+                    unsigned blk_size)
 {
-    assert(!cache);
+    assert(!cache && !system && !probeManager);
+    system = sys;
+    probeManager = pm;
     cache = _cache;
 
     // If the cache has a different block size from the system's, save it
-    blkSize = cache->getBlockSize();
+    blkSize = blk_size;
     lBlkSize = floorLog2(blkSize);
 }
 
@@ -280,8 +283,8 @@ Base::regProbeListeners()
      * parent cache using the probe "Miss". Also connect to "Hit", if the
      * cache is configured to prefetch on accesses.
      */
-    if (listeners.empty() && cache != nullptr) {
-        ProbeManager *pm(cache->getProbeManager());
+    if (listeners.empty() && probeManager != nullptr) {
+        ProbeManager *pm(probeManager);
         listeners.push_back(new PrefetchListener(*this, pm, "Miss", false,
                                                 true));
         listeners.push_back(new PrefetchListener(*this, pm, "Fill", true,
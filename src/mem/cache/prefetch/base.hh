@@ -52,6 +52,7 @@
 #include "base/compiler.hh"
 #include "base/statistics.hh"
 #include "base/types.hh"
+#include "mem/cache/cache_accessor.hh"
 #include "mem/cache/cache_blk.hh"
 #include "mem/packet.hh"
 #include "mem/request.hh"
@@ -62,8 +63,8 @@
 namespace gem5
 {
 
-class BaseCache;
 struct BasePrefetcherParams;
+class System;
 
 GEM5_DEPRECATED_NAMESPACE(Prefetcher, prefetch);
 namespace prefetch
@@ -263,8 +264,14 @@ class Base : public ClockedObject
 
     // PARAMETERS
 
-    /** Pointr to the parent cache. */
-    BaseCache* cache;
+    /** Lookups into the parent cache. */
+    CacheAccessor *cache;
+
+    /** System the parent cache belongs to. */
+    System *system;
+
+    /** Probe manager of the parent cache, which issues the accesses. */
+    ProbeManager *probeManager;
 
     /** The block size of the parent cache. */
     unsigned blkSize;
@@ -371,7 +378,17 @@ class Base : public ClockedObject
     Base(const BasePrefetcherParams &p);
     virtual ~Base() = default;
 
-    virtual void setCache(BaseCache *_cache);
+    /**
+     * Attach the prefetcher to its parent cache.
+     *
+     * @param sys System the cache belongs to.
+     * @param pm Probe manager of the cache, providing the Miss, Fill and
+     *           Hit probe points the prefetcher listens to by default.
+     * @param _cache Lookups into the cache.
+     * @param blk_size Block size of the cache.
+     */
+    virtual void setParentInfo(System *sys, ProbeManager *pm,
+                               CacheAccessor *_cache, unsigned blk_size);
 
     /**
      * Notify prefetcher of cache access (may be any access or just
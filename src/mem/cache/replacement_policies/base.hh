@@ -32,6 +32,7 @@
 #include <memory>
 
 #include "base/compiler.hh"
+#include "base/random.hh"
 #include "mem/cache/replacement_policies/replaceable_entry.hh"
 #include "mem/packet.hh"
 #include "params/BaseReplacementPolicy.hh"
@@ -54,9 +55,18 @@ namespace replacement_policy
  */
 class Base : public SimObject
 {
+  protected:
+    /**
+     * Generator of the policies which draw random numbers, of their own
+     * so that their draws do not depend on the other objects (see
+     * objectSeed()). Mutable, as they draw in const methods; qualified,
+     * as replacement_policy::Random is the random policy.
+     */
+    mutable gem5::Random rng;
+
   public:
     typedef BaseReplacementPolicyParams Params;
-    Base(const Params &p) : SimObject(p) {}
+    Base(const Params &p) : SimObject(p), rng(objectSeed(name())) {}
     virtual ~Base() = default;
 
     /**
@@ -95,6 +105,22 @@ class Base : public SimObject
     virtual void reset(const std::shared_ptr<ReplacementData>&
         replacement_data) const = 0;
 
+    /**
+     * Restore replacement data from a checkpoint, where its holder was
+     * last accessed at an earlier tick. The holders are restored in the
+     * order of their last access, so by default this is a reset; policies
+     * keeping timestamps use the tick instead of the current one.
+     *
+     * @param replacement_data Replacement data to be restored.
+     * @param pkt Packet that generated the last access.
+     * @param tick Tick of the last access.
+     */
+    virtual void restore(const std::shared_ptr<ReplacementData>&
+        replacement_data, const PacketPtr pkt, Tick tick)
+    {
+        reset(replacement_data, pkt);
+    }
+
     /**
      * Find replacement victim among candidates.
      *
@@ -85,7 +85,7 @@ BRRIP::reset(const std::shared_ptr<ReplacementData>& replacement_data) const
     // Replacement data is inserted as "long re-reference" if lower than btp,
     // "distant re-reference" otherwise
     casted_replacement_data->rrpv.saturate();
-    if (random_mt.random<unsigned>(1, 100) <= btp) {
+    if (rng.random<unsigned>(1, 100) <= btp) {
         casted_replacement_data->rrpv--;
     }
 
@@ -91,6 +91,19 @@ Dueling::reset(const std::shared_ptr<ReplacementData>& replacement_data,
     duelingMonitor.sample(static_cast<Dueler*>(casted_replacement_data.get()));
 }
 
+void
+Dueling::restore(const std::shared_ptr<ReplacementData>& replacement_data,
+    const PacketPtr pkt, Tick tick)
+{
+    std::shared_ptr<DuelerReplData> casted_replacement_data =
+        std::static_pointer_cast<DuelerReplData>(replacement_data);
+    replPolicyA->restore(casted_replacement_data->replDataA, pkt, tick);
+    replPolicyB->restore(casted_replacement_data->replDataB, pkt, tick);
+
+    // The entry was filled by a miss, which sampled the duel
+    duelingMonitor.sample(static_cast<Dueler*>(casted_replacement_data.get()));
+}
+
 void
 Dueling::reset(const std::shared_ptr<ReplacementData>& replacement_data) const
 {
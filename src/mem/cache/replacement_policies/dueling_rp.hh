@@ -106,6 +106,8 @@ class Dueling : public Base
                                                                      override;
     void reset(const std::shared_ptr<ReplacementData>& replacement_data,
         const PacketPtr pkt) override;
+    void restore(const std::shared_ptr<ReplacementData>& replacement_data,
+        const PacketPtr pkt, Tick tick) override;
     void reset(const std::shared_ptr<ReplacementData>& replacement_data) const
                                                                      override;
     ReplaceableEntry* getVictim(const ReplacementCandidates& candidates) const
@@ -68,6 +68,15 @@ FIFO::reset(const std::shared_ptr<ReplacementData>& replacement_data) const
         replacement_data)->tickInserted = curTick();
 }
 
+void
+FIFO::restore(const std::shared_ptr<ReplacementData>& replacement_data,
+    const PacketPtr pkt, Tick tick)
+{
+    // Set insertion tick
+    std::static_pointer_cast<FIFOReplData>(
+        replacement_data)->tickInserted = tick;
+}
+
 ReplaceableEntry*
 FIFO::getVictim(const ReplacementCandidates& candidates) const
 {
@@ -70,6 +70,15 @@ LRU::reset(const std::shared_ptr<ReplacementData>& replacement_data) const
         replacement_data)->lastTouchTick = curTick();
 }
 
+void
+LRU::restore(const std::shared_ptr<ReplacementData>& replacement_data,
+    const PacketPtr pkt, Tick tick)
+{
+    // Set last touch timestamp
+    std::static_pointer_cast<LRUReplData>(
+        replacement_data)->lastTouchTick = tick;
+}
+
 ReplaceableEntry*
 LRU::getVictim(const ReplacementCandidates& candidates) const
 {
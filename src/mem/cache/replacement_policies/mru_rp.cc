@@ -70,6 +70,15 @@ MRU::reset(const std::shared_ptr<ReplacementData>& replacement_data) const
         replacement_data)->lastTouchTick = curTick();
 }
 
+void
+MRU::restore(const std::shared_ptr<ReplacementData>& replacement_data,
+    const PacketPtr pkt, Tick tick)
+{
+    // Set last touch timestamp
+    std::static_pointer_cast<MRUReplData>(
+        replacement_data)->lastTouchTick = tick;
+}
+
 ReplaceableEntry*
 MRU::getVictim(const ReplacementCandidates& candidates) const
 {
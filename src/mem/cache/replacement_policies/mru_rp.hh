@@ -95,6 +95,17 @@ class MRU : public Base
     void reset(const std::shared_ptr<ReplacementData>& replacement_data) const
                                                                      override;
 
+    /**
+     * Restore replacement data from a checkpoint.
+     * Sets its last touch tick as the tick of the last access.
+     *
+     * @param replacement_data Replacement data to be restored.
+     * @param pkt Packet that generated the last access.
+     * @param tick Tick of the last access.
+     */
+    void restore(const std::shared_ptr<ReplacementData>& replacement_data,
+        const PacketPtr pkt, Tick tick) override;
+
     /**
      * Find replacement victim using access timestamps.
      *
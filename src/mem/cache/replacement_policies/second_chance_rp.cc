@@ -88,6 +88,18 @@ SecondChance::reset(
         replacement_data)->hasSecondChance = false;
 }
 
+void
+SecondChance::restore(
+    const std::shared_ptr<ReplacementData>& replacement_data,
+    const PacketPtr pkt, Tick tick)
+{
+    FIFO::restore(replacement_data, pkt, tick);
+
+    // Entries are inserted with a second chance
+    std::static_pointer_cast<SecondChanceReplData>(
+        replacement_data)->hasSecondChance = false;
+}
+
 ReplaceableEntry*
 SecondChance::getVictim(const ReplacementCandidates& candidates) const
 {
@@ -103,7 +103,7 @@ TreePLRU::TreePLRUReplData::TreePLRUReplData(
 }
 
 TreePLRU::TreePLRU(const Params &p)
-  : Base(p), numLeaves(p.num_leaves), count(0), treeInstance(nullptr)
+  : Base(p), numLeaves(p.num_leaves), count(0)
 {
     fatal_if(!isPowerOf2(numLeaves),
              "Number of leaves must be non-zero and a power of 2");
@@ -201,13 +201,13 @@ TreePLRU::instantiateEntry()
 {
     // Generate a tree instance every numLeaves created
     if (count % numLeaves == 0) {
-        treeInstance = new PLRUTree(numLeaves - 1, false);
+        treeInstance = std::make_shared<PLRUTree>(numLeaves - 1, false);
     }
 
     // Create replacement data using current tree instance
     TreePLRUReplData* treePLRUReplData = new TreePLRUReplData(
         (count % numLeaves) + numLeaves - 1,
-        std::shared_ptr<PLRUTree>(treeInstance));
+        treeInstance);
 
     // Update instance counter
     count++;
@@ -0,0 +1,342 @@
+/*
+ * Copyright (c) 2026 The Regents of the University of California
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ * Implementation of a bridge between two event queues, carrying the
+ * packets in timestamped mailboxes.
+ */
+
+#include "mem/eventq_bridge.hh"
+
+#include "base/logging.hh"
+#include "base/trace.hh"
+#include "debug/Drain.hh"
+#include "debug/EventQueueBridge.hh"
+#include "mem/packet.hh"
+
+namespace gem5
+{
+
+EventQueueBridge::BridgeResponsePort::BridgeResponsePort(
+        const std::string &_name, EventQueueBridge &_bridge)
+    : ResponsePort(_name, &_bridge), bridge(_bridge),
+      outstandingRequests(0), outstandingResponses(0), retryReq(false)
+{
+}
+
+EventQueueBridge::BridgeRequestPort::BridgeRequestPort(
+        const std::string &_name, EventQueueBridge &_bridge)
+    : RequestPort(_name, &_bridge), bridge(_bridge)
+{
+}
+
+EventQueueBridge::EventQueueBridge(const Params &p)
+    : SimObject(p),
+      cpuSidePort(p.name + ".cpu_side_port", *this),
+      memSidePort(p.name + ".mem_side_port", *this),
+      memSideQueue(getEventQueue(p.mem_side_eventq_index)),
+      delay(p.delay),
+      reqQueueLimit(p.req_size),
+      respQueueLimit(p.resp_size),
+      requests(p.name + ".requests", memSideQueue,
+               [this](PacketPtr &pkt) { memSidePort.schedTimingReq(pkt); }),
+      responses(p.name + ".responses", eventQueue(),
+                [this](PacketPtr &pkt) { cpuSidePort.schedTimingResp(pkt); }),
+      credits(p.name + ".credits", eventQueue(),
+              [this](unsigned &) { cpuSidePort.requestLeft(); }),
+      inFlight(0)
+{
+    fatal_if(reqQueueLimit == 0 || respQueueLimit == 0,
+             "%s: the bridge must buffer at least one request and one "
+             "response.\n", name());
+}
+
+Port &
+EventQueueBridge::getPort(const std::string &if_name, PortID idx)
+{
+    if (if_name == "mem_side_port")
+        return memSidePort;
+    else if (if_name == "cpu_side_port")
+        return cpuSidePort;
+    else
+        return SimObject::getPort(if_name, idx);
+}
+
+void
+EventQueueBridge::init()
+{
+    if (!cpuSidePort.isConnected() || !memSidePort.isConnected())
+        fatal("Both ports of a bridge must be connected.\n");
+
+    // Messages must be posted at least a quantum ahead
+    fatal_if(delay < simQuantum, "%s: the delay (%d) must not be less "
+             "than the simulation quantum (%d).\n", name(), delay,
+             simQuantum);
+
+    cpuSidePort.sendRangeChange();
+}
+
+DrainState
+EventQueueBridge::drain()
+{
+    return inFlight == 0 ? DrainState::Drained : DrainState::Draining;
+}
+
+void
+EventQueueBridge::cross(Mailbox<PacketPtr> &mailbox, PacketPtr pkt)
+{
+    // The packet only reaches us after the header delay, and we also
+    // need to receive its payload before passing it on
+    Tick receive_delay = pkt->headerDelay + pkt->payloadDelay;
+    pkt->headerDelay = pkt->payloadDelay = 0;
+
+    ++inFlight;
+    mailbox.post(curTick() + delay + receive_delay, pkt);
+}
+
+void
+EventQueueBridge::packetSent()
+{
+    if (--inFlight == 0 && drainState() == DrainState::Draining) {
+        DPRINTF(Drain, "Bridge done draining, signaling drain manager\n");
+        signalDrainDone();
+    }
+}
+
+bool
+EventQueueBridge::BridgeResponsePort::reqQueueFull() const
+{
+    return outstandingRequests == bridge.reqQueueLimit;
+}
+
+bool
+EventQueueBridge::BridgeResponsePort::respQueueFull() const
+{
+    return outstandingResponses == bridge.respQueueLimit;
+}
+
+bool
+EventQueueBridge::BridgeResponsePort::recvTimingReq(PacketPtr pkt)
+{
+    DPRINTF(EventQueueBridge, "recvTimingReq: %s addr 0x%x\n",
+            pkt->cmdString(), pkt->getAddr());
+
+    panic_if(pkt->cacheResponding(), "Should not see packets where cache "
+             "is responding");
+
+    // The sender must wait for the retry it was promised
+    if (retryReq)
+        return false;
+
+    if (reqQueueFull() || (pkt->needsResponse() && respQueueFull())) {
+        DPRINTF(EventQueueBridge, "Bridge full: %d requests, %d responses "
+                "outstanding\n", outstandingRequests, outstandingResponses);
+        retryReq = true;
+        return false;
+    }
+
+    ++outstandingRequests;
+    if (pkt->needsResponse())
+        ++outstandingResponses;
+    bridge.cross(bridge.requests, pkt);
+    return true;
+}
+
+void
+EventQueueBridge::BridgeResponsePort::retryStalledReq()
+{
+    if (retryReq) {
+        DPRINTF(EventQueueBridge, "Room in the bridge, retrying request\n");
+        retryReq = false;
+        sendRetryReq();
+    }
+}
+
+void
+EventQueueBridge::BridgeResponsePort::requestLeft()
+{
+    assert(outstandingRequests != 0);
+    --outstandingRequests;
+    retryStalledReq();
+}
+
+bool
+EventQueueBridge::BridgeRequestPort::recvTimingResp(PacketPtr pkt)
+{
+    DPRINTF(EventQueueBridge, "recvTimingResp: %s addr 0x%x\n",
+            pkt->cmdString(), pkt->getAddr());
+
+    // Room was reserved for it when the request was accepted
+    bridge.cross(bridge.responses, pkt);
+    return true;
+}
+
+void
+EventQueueBridge::BridgeRequestPort::schedTimingReq(PacketPtr pkt)
+{
+    transmitList.push_back(pkt);
+    if (transmitList.size() == 1)
+        trySendTiming();
+}
+
+void
+EventQueueBridge::BridgeResponsePort::schedTimingResp(PacketPtr pkt)
+{
+    transmitList.push_back(pkt);
+    if (transmitList.size() == 1)
+        trySendTiming();
+}
+
+void
+EventQueueBridge::BridgeRequestPort::trySendTiming()
+{
+    // Send as many requests as the responder takes, and wait for a
+    // retry otherwise
+    while (!transmitList.empty()) {
+        PacketPtr pkt = transmitList.front();
+        DPRINTF(EventQueueBridge, "trySend request addr 0x%x, queue size "
+                "%d\n", pkt->getAddr(), transmitList.size());
+        if (!sendTimingReq(pkt))
+            return;
+        transmitList.pop_front();
+        bridge.packetSent();
+
+        // The requestor side may accept another request, once the
+        // credit has crossed back
+        bridge.credits.post(curTick() + bridge.delay, 1);
+    }
+}
+
+void
+EventQueueBridge::BridgeResponsePort::trySendTiming()
+{
+    while (!transmitList.empty()) {
+        PacketPtr pkt = transmitList.front();
+        DPRINTF(EventQueueBridge, "trySend response addr 0x%x, queue size "
+                "%d\n", pkt->getAddr(), transmitList.size());
+        if (!sendTimingResp(pkt))
+            return;
+        transmitList.pop_front();
+        bridge.packetSent();
+
+        assert(outstandingResponses != 0);
+        --outstandingResponses;
+        retryStalledReq();
+    }
+}
+
+void
+EventQueueBridge::BridgeRequestPort::recvReqRetry()
+{
+    trySendTiming();
+}
+
+void
+EventQueueBridge::BridgeResponsePort::recvRespRetry()
+{
+    trySendTiming();
+}
+
+Tick
+EventQueueBridge::BridgeResponsePort::recvAtomic(PacketPtr pkt)
+{
+    panic_if(pkt->cacheResponding(), "Should not see packets where cache "
+             "is responding");
+
+    EventQueue::ScopedMigration migrate(bridge.memSideQueue, inParallelMode);
+    return bridge.delay + bridge.memSidePort.sendAtomic(pkt);
+}
+
+void
+EventQueueBridge::BridgeResponsePort::recvFunctional(PacketPtr pkt)
+{
+    pkt->pushLabel(name());
+
+    // check the responses, which are on this queue
+    bool found = trySatisfyFunctional(pkt);
+    if (!found) {
+        // and then the requests and the responder, on the other queue
+        EventQueue::ScopedMigration migrate(bridge.memSideQueue,
+                                            inParallelMode);
+        found = bridge.memSidePort.trySatisfyFunctional(pkt);
+        if (!found) {
+            pkt->popLabel();
+            bridge.memSidePort.sendFunctional(pkt);
+            return;
+        }
+    }
+
+    pkt->popLabel();
+}
+
+bool
+EventQueueBridge::BridgeResponsePort::trySatisfyFunctional(PacketPtr pkt)
+{
+    bool found = false;
+    auto check = [pkt, &found](PacketPtr &other) {
+        if (!found && pkt->trySatisfyFunctional(other)) {
+            pkt->makeResponse();
+            found = true;
+        }
+    };
+    for (auto &other : transmitList)
+        check(other);
+    bridge.responses.forEach(check);
+    return found;
+}
+
+bool
+EventQueueBridge::BridgeRequestPort::trySatisfyFunctional(PacketPtr pkt)
+{
+    bool found = false;
+    auto check = [pkt, &found](PacketPtr &other) {
+        if (!found && pkt->trySatisfyFunctional(other)) {
+            pkt->makeResponse();
+            found = true;
+        }
+    };
+    for (auto &other : transmitList)
+        check(other);
+    bridge.requests.forEach(check);
+    return found;
+}
+
+AddrRangeList
+EventQueueBridge::BridgeResponsePort::getAddrRanges() const
+{
+    return bridge.memSidePort.getAddrRanges();
+}
+
+void
+EventQueueBridge::BridgeRequestPort::recvRangeChange()
+{
+    bridge.cpuSidePort.sendRangeChange();
+}
+
+} // namespace gem5
@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) 2026 The Regents of the University of California
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ * Declaration of a bridge between two event queues, i.e., between
+ * objects simulated by different threads.
+ */
+
+#ifndef __MEM_EVENTQ_BRIDGE_HH__
+#define __MEM_EVENTQ_BRIDGE_HH__
+
+#include <atomic>
+#include <deque>
+
+#include "base/types.hh"
+#include "mem/port.hh"
+#include "params/EventQueueBridge.hh"
+#include "sim/mailbox.hh"
+#include "sim/sim_object.hh"
+
+namespace gem5
+{
+
+/**
+ * A bridge carrying timing packets between a requestor on the event
+ * queue of the bridge and a responder on another event queue. The
+ * packets cross in mailboxes (see sim/mailbox.hh), and hence take at
+ * least a simulation quantum to cross: the delay of the bridge must be
+ * at least the quantum. The simulation then does not depend on the
+ * number of threads, and the bridge is also used between objects on
+ * the same queue for that reason.
+ *
+ * The bridge buffers at most req_size requests, from the time it
+ * accepts them to the time the responder takes them, and reserves room
+ * for the responses of at most resp_size requests. It refuses the
+ * requests beyond that, and asks for them again once there is room.
+ * The requestor side learns that a request left the bridge through a
+ * credit crossing back like a packet, so that what the bridge accepts
+ * only depends on the simulated time. The responses always find room.
+ *
+ * Atomic and functional accesses are passed on directly, with the
+ * thread migrated to the queue of the responder. Snooping is not
+ * supported, so a coherent crossbar must not be split from the caches
+ * it keeps coherent.
+ */
+class EventQueueBridge : public SimObject
+{
+  protected:
+    class BridgeRequestPort;
+
+    /**
+     * The port receiving the requests, on the queue of the bridge.
+     */
+    class BridgeResponsePort : public ResponsePort
+    {
+      private:
+        EventQueueBridge &bridge;
+
+        /** Responses which crossed the bridge, in order of arrival. */
+        std::deque<PacketPtr> transmitList;
+
+        /**
+         * Requests accepted whose credit has not come back yet, i.e.,
+         * which may still be in the bridge.
+         */
+        unsigned outstandingRequests;
+
+        /** Requests accepted and waiting for their response. */
+        unsigned outstandingResponses;
+
+        /** Whether a request was refused and waits for a retry. */
+        bool retryReq;
+
+        void trySendTiming();
+
+        bool reqQueueFull() const;
+        bool respQueueFull() const;
+
+        /** Ask for the refused request again, if any. */
+        void retryStalledReq();
+
+      public:
+        BridgeResponsePort(const std::string &_name,
+                           EventQueueBridge &_bridge);
+
+        /** Take the credit of a request the responder took. */
+        void requestLeft();
+
+        /** Send a response once it has crossed the bridge. */
+        void schedTimingResp(PacketPtr pkt);
+
+        /** Look for the data of a functional access in the responses. */
+        bool trySatisfyFunctional(PacketPtr pkt);
+
+      protected:
+        bool recvTimingReq(PacketPtr pkt) override;
+        void recvRespRetry() override;
+        Tick recvAtomic(PacketPtr pkt) override;
+        void recvFunctional(PacketPtr pkt) override;
+        AddrRangeList getAddrRanges() const override;
+    };
+
+    /**
+     * The port sending the requests, on the queue of the responder.
+     */
+    class BridgeRequestPort : public RequestPort
+    {
+      private:
+        EventQueueBridge &bridge;
+
+        /** Requests which crossed the bridge, in order of arrival. */
+        std::deque<PacketPtr> transmitList;
+
+        void trySendTiming();
+
+      public:
+        BridgeRequestPort(const std::string &_name,
+                          EventQueueBridge &_bridge);
+
+        /** Send a request once it has crossed the bridge. */
+        void schedTimingReq(PacketPtr pkt);
+
+        /** Look for the data of a functional access in the requests. */
+        bool trySatisfyFunctional(PacketPtr pkt);
+
+      protected:
+        bool recvTimingResp(PacketPtr pkt) override;
+        void recvReqRetry() override;
+        void recvRangeChange() override;
+    };
+
+    BridgeResponsePort cpuSidePort;
+    BridgeRequestPort memSidePort;
+
+    /** The queue of the responder, and of the request port. */
+    EventQueue *const memSideQueue;
+
+    /** Time taken to cross the bridge, at least the quantum. */
+    const Tick delay;
+
+    /** Maximum number of requests in the bridge. */
+    const unsigned reqQueueLimit;
+
+    /** Maximum number of requests waiting for their response. */
+    const unsigned respQueueLimit;
+
+    /** Requests towards the responder. */
+    Mailbox<PacketPtr> requests;
+
+    /** Responses towards the requestor. */
+    Mailbox<PacketPtr> responses;
+
+    /** Credits of the requests the responder took, towards the requestor. */
+    Mailbox<unsigned> credits;
+
+    /** Packets in the bridge, on either side or crossing it. */
+    std::atomic<unsigned> inFlight;
+
+    /** Post a packet to a mailbox, delayed by the bridge. */
+    void cross(Mailbox<PacketPtr> &mailbox, PacketPtr pkt);
+
+    /** Note that a packet left the bridge, which may be drained. */
+    void packetSent();
+
+  public:
+    Port &getPort(const std::string &if_name,
+                  PortID idx=InvalidPortID) override;
+
+    void init() override;
+
+    DrainState drain() override;
+
+    typedef EventQueueBridgeParams Params;
+    EventQueueBridge(const Params &p);
+};
+
+} // namespace gem5
+
+#endif //__MEM_EVENTQ_BRIDGE_HH__
@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2026 The Regents of the University of California
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "mem/stack_dist_calc.hh"
+
+using namespace gem5;
+
+/** The first access to an address has an infinite stack distance */
+TEST(StackDistCalcTest, FirstAccessIsInfinite)
+{
+    StackDistCalc calc;
+    ASSERT_EQ(calc.calcStackDistAndUpdate(0x40).first,
+              StackDistCalc::Infinity);
+    ASSERT_EQ(calc.calcStackDistAndUpdate(0x80).first,
+              StackDistCalc::Infinity);
+    ASSERT_EQ(calc.calcStackDist(0xc0).first, StackDistCalc::Infinity);
+}
+
+/** The distance counts the unique addresses accessed in between */
+TEST(StackDistCalcTest, UniqueAddressesInBetween)
+{
+    StackDistCalc calc;
+    calc.calcStackDistAndUpdate(0x0);
+    ASSERT_EQ(calc.calcStackDistAndUpdate(0x0).first, 0);
+
+    calc.calcStackDistAndUpdate(0x40);
+    calc.calcStackDistAndUpdate(0x80);
+    calc.calcStackDistAndUpdate(0x40);
+    // 0x40 and 0x80 came after 0x0, 0x40 twice
+    ASSERT_EQ(calc.calcStackDist(0x0).first, 2);
+    ASSERT_EQ(calc.calcStackDistAndUpdate(0x0).first, 2);
+    ASSERT_EQ(calc.calcStackDistAndUpdate(0x80).first, 2);
+    ASSERT_EQ(calc.calcStackDistAndUpdate(0x80).first, 0);
+}
+
+/** Marks are returned once and reset when the address is pushed again */
+TEST(StackDistCalcTest, Mark)
+{
+    StackDistCalc calc;
+    calc.calcStackDistAndUpdate(0x0);
+    calc.calcStackDistAndUpdate(0x40);
+
+    ASSERT_EQ(calc.calcStackDist(0x0, true), std::make_pair(uint64_t(1),
+                                                            false));
+    ASSERT_EQ(calc.calcStackDist(0x0), std::make_pair(uint64_t(1), true));
+    ASSERT_EQ(calc.calcStackDist(0x0), std::make_pair(uint64_t(1), false));
+
+    calc.calcStackDist(0x0, true);
+    ASSERT_EQ(calc.calcStackDistAndUpdate(0x0),
+              std::make_pair(uint64_t(1), true));
+    ASSERT_EQ(calc.calcStackDistAndUpdate(0x0),
+              std::make_pair(uint64_t(0), false));
+}
+
+/** Deleting an entry removes it from the stack */
+TEST(StackDistCalcTest, Delete)
+{
+    StackDistCalc calc;
+    calc.calcStackDistAndUpdate(0x0);
+    calc.calcStackDistAndUpdate(0x40);
+    calc.calcStackDistAndUpdate(0x80);
+
+    ASSERT_EQ(calc.calcStackDistAndUpdate(0x40, false).first, 1);
+    ASSERT_EQ(calc.calcStackDist(0x40).first, StackDistCalc::Infinity);
+    ASSERT_EQ(calc.calcStackDist(0x0).first, 1);
+    ASSERT_EQ(calc.calcStackDistAndUpdate(0x40, false).first,
+              StackDistCalc::Infinity);
+}
+
+/**
+ * A long random stream, compacted many times, gives the distances of a
+ * naive stack (the calculator checks them against its own when verifying)
+ */
+TEST(StackDistCalcTest, RandomStream)
+{
+    StackDistCalc calc(true);
+    std::vector<Addr> stack;
+    std::mt19937 rng(0);
+    for (int i = 0; i < 50000; i++) {
+        // Mostly a small working set, sometimes a deletion
+        Addr addr = (rng() % ((i % 7) ? 300 : 3000)) << 6;
+        bool add = rng() % 16 != 0;
+
+        uint64_t expected = StackDistCalc::Infinity;
+        for (auto it = stack.rbegin(); it != stack.rend(); ++it) {
+            if (*it == addr) {
+                expected = it - stack.rbegin();
+                stack.erase(std::next(it).base());
+                break;
+            }
+        }
+        if (add)
+            stack.push_back(addr);
+
+        ASSERT_EQ(calc.calcStackDistAndUpdate(addr, add).first, expected);
+    }
+}
@@ -44,6 +44,7 @@ import _m5.event
 from _m5.event import GlobalSimLoopExitEvent as SimExit
 from _m5.event import PyEvent as Event
 from _m5.event import getEventQueue, setEventQueue
+from _m5.event import EventQueueStructure, setEventQueueStructure
 
 mainq = None
 
@@ -69,6 +69,7 @@ def parse_options():
     group = options.set_group
 
     listener_modes = ( "on", "off", "auto" )
+    eventq_structures = ( "list", "heap" )
 
     # Help options
     option('-B', "--build-info", action="store_true", default=False,
@@ -98,6 +99,11 @@ def parse_options():
     option("--allow-remote-connections", action="store_true", default=False,
         help="Port listeners will accept connections from anywhere (0.0.0.0). "
         "Default is only localhost.")
+    option("--eventq-structure", metavar="{list,heap}",
+        choices=eventq_structures, default=None,
+        help="Keep the pending events in a sorted list or in a 4-ary heap " \
+        "of bins (faster with many distinct pending ticks) " \
+        "[Default: list, or heap if built with USE_EVENTQ_HEAP]")
     option('-i', "--interactive", action="store_true", default=False,
         help="Invoke the interactive interpreter after running the script")
     option("--pdb", action="store_true", default=False,
@@ -220,6 +226,10 @@ def main():
 
     m5.options = options
 
+    if options.eventq_structure:
+        event.setEventQueueStructure(
+            getattr(event.EventQueueStructure, options.eventq_structure))
+
     # Set the main event queue for the main thread.
     event.mainq = event.getEventQueue(0)
     event.setEventQueue(event.mainq)
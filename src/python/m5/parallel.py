@@ -0,0 +1,298 @@
+# Copyright (c) 2026 The Regents of the University of California
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are
+# met: redistributions of source code must retain the above copyright
+# notice, this list of conditions and the following disclaimer;
+# redistributions in binary form must reproduce the above copyright
+# notice, this list of conditions and the following disclaimer in the
+# documentation and/or other materials provided with the distribution;
+# neither the name of the copyright holders nor the names of its
+# contributors may be used to endorse or promote products derived from
+# this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+# "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+# A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+# OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+# SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+# LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+# DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+# THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+"""Partitioning of a system onto event queues, i.e., simulation threads.
+
+partition() puts every core of a system, with the objects only it uses
+(its private caches, TLBs, interrupt controller, workload...), on an
+event queue of its own, or shares the queues between the cores in
+blocks when there are fewer queues than cores. The objects the cores
+share, such as the memory bus and controllers, go on the first queue.
+
+Every port connection between two partitions gets an EventQueueBridge,
+through which the packets cross in timestamped mailboxes, handed over
+at quantum boundaries. The results do not depend on the number of
+queues: a system partitioned onto one queue runs the same as the same
+system partitioned onto sixteen, only slower. Root.sim_quantum must
+not exceed the latency of the bridges.
+
+Cores that share objects, e.g., the threads of a process, make a
+single partition. Objects of the private types (SimpleCache by
+default) join the partition of the cores they serve if only those
+use them, through their ports or parameters. Everything else is
+shared.
+
+Limitations:
+- The bridges do not carry snoops: coherent caches and Ruby must stay
+  with the cores they keep coherent, which is warned about. Nor do they
+  carry back-invalidations: an inclusive SimpleCache must be in the
+  partition of its upper_caches.
+- Processes in different partitions must not interact through the
+  emulated OS (signals, futexes, clones onto another core).
+- Replacement policies, branch predictors and the thread selection of
+  the CPUs draw from generators of their own, seeded from their names,
+  and so draw the same numbers whatever the queues. Other models drawing
+  random numbers (memory latency variation, traffic generators, testers)
+  share random_mt, and must stay shared, on the first queue.
+- Atomic and functional accesses cross the bridges directly, and
+  atomic simulation is not deterministic with several queues.
+"""
+
+from m5.params import VectorPortRef, isNullPointer
+from m5.proxy import isproxy
+from m5.SimObject import isSimObject, isSimObjectVector
+from m5.util import fatal, inform, warn
+
+REQUESTOR = 'GEM5 REQUESTOR'
+RESPONDER = 'GEM5 RESPONDER'
+
+def _ports(obj):
+    """The connected ports of an object, in a fixed order."""
+    for name in sorted(obj._port_refs.keys()):
+        ref = obj._port_refs[name]
+        elements = ref.elements if isinstance(ref, VectorPortRef) else [ref]
+        for element in elements:
+            if element.peer is not None and not isproxy(element.peer):
+                yield element
+
+def _references(obj):
+    """The objects the parameters of an object refer to, but the upper
+    caches of a SimpleCache, which it only calls into if inclusive."""
+    for name, value in sorted(obj._values.items(), key=lambda v: v[0]):
+        if value is None or isproxy(value) or isNullPointer(value):
+            continue
+        if name == 'upper_caches' and _is_a(obj, ('SimpleCache', )) and \
+                not _back_invalidates(obj):
+            continue
+        if isSimObjectVector(value) or isinstance(value, list):
+            values = value
+        else:
+            values = [value]
+        for v in values:
+            if isSimObject(v) and not isproxy(v):
+                yield v
+
+def _is_a(obj, class_names):
+    return any(c.__name__ in class_names for c in type(obj).__mro__)
+
+def _back_invalidates(cache):
+    """Whether a SimpleCache calls into its upper caches."""
+    return str(cache.inclusion) == 'Inclusive'
+
+def partition(system, queues, latency='1ns', arena=None, private=None):
+    """Partition the cores of a system onto event queues.
+
+    system -- the object to partition, objects outside are left alone
+    queues -- the event queue indices to use, or their number
+    latency -- the delay of the bridges between the partitions
+    arena -- physArenaSize of the processes when there are several
+             partitions, so that their physical pages do not depend on
+             the order in which they fault (None to leave it)
+    private -- the classes of objects which may be private to cores,
+               SimpleCache by default
+    """
+    import m5.objects
+    from m5.objects import BaseCPU, EventQueueBridge
+
+    if isinstance(queues, int):
+        queues = range(queues)
+    queues = list(queues)
+    if not queues:
+        fatal("No event queue to partition %s onto", system)
+    if private is None:
+        private = tuple(getattr(m5.objects, name) for name in
+                        ('SimpleCache', ) if hasattr(m5.objects, name))
+    private = tuple(private)
+
+    # Adopt the orphan parameters now rather than when instantiating,
+    # so that the processes of the cores are part of them
+    for obj in system.descendants():
+        obj.adoptOrphanParams()
+    objects = list(system.descendants())
+    cores = [obj for obj in objects if isinstance(obj, BaseCPU)]
+    if not cores:
+        fatal("No core to partition in %s", system)
+    for core in cores:
+        if core.switched_out:
+            fatal("Cannot partition %s: %s is switched out", system, core)
+
+    # The core each object is part of, by the object tree
+    core_of = {}
+    for obj in objects:
+        if isinstance(obj, BaseCPU):
+            core_of[obj] = obj
+        else:
+            core_of[obj] = core_of.get(obj.get_parent())
+
+    referrers = dict((obj, []) for obj in objects)
+    for obj in objects:
+        for ref in _references(obj):
+            if ref in referrers:
+                referrers[ref].append(obj)
+
+    # Cores using each other's objects are a single partition
+    leader = dict((core, core) for core in cores)
+    def find(core):
+        while leader[core] is not core:
+            core = leader[core]
+        return core
+    for obj in objects:
+        if core_of[obj] is None:
+            continue
+        others = list(_references(obj)) + \
+            [port.peer.simobj for port in _ports(obj)]
+        for other in others:
+            if core_of.get(other) is not None:
+                leader[find(core_of[other])] = find(core_of[obj])
+
+    # The partition of each object, a core standing for it, or None for
+    # the shared objects
+    part = dict((obj, None if core_of[obj] is None else find(core_of[obj]))
+                for obj in objects)
+
+    # Objects of the private types reachable from the requestor ports of
+    # a single partition, through objects of these types
+    reached = {}
+    for obj in objects:
+        if part[obj] is None:
+            continue
+        stack = [obj]
+        while stack:
+            for port in _ports(stack.pop()):
+                other = port.peer.simobj
+                if port.role != REQUESTOR or other not in part or \
+                        part[other] is not None or \
+                        not isinstance(other, private):
+                    continue
+                units = reached.setdefault(other, [])
+                if part[obj] not in units:
+                    units.append(part[obj])
+                    stack.append(other)
+
+    # Each private object takes its children along
+    root_of = {}
+    for obj in objects:
+        if part[obj] is None:
+            if len(reached.get(obj, [])) == 1:
+                root_of[obj] = obj
+            elif obj.get_parent() in root_of:
+                root_of[obj] = root_of[obj.get_parent()]
+            else:
+                continue
+            part[obj] = reached[root_of[obj]][0]
+
+    # Objects used from outside their partition are shared after all
+    def foreign_user(obj):
+        for port in _ports(obj):
+            if port.role == RESPONDER and \
+                    part.get(port.peer.simobj) is not part[obj]:
+                return port.peer
+        for user in referrers[obj]:
+            if part[user] is part[obj]:
+                continue
+            if _is_a(user, ('SimpleCache', )) and obj in user.upper_caches:
+                # It would take every cache above it into the shared
+                # partition, and with them the cores if they could
+                fatal("%s back-invalidates %s, of another partition, which "
+                      "the bridges do not carry: keep it with the cores or "
+                      "make it non-inclusive", user, obj)
+            return user
+        return None
+    changed = True
+    while changed:
+        changed = False
+        for obj in objects:
+            if obj not in root_of or part[obj] is None:
+                continue
+            user = foreign_user(obj)
+            if user is not None:
+                root = root_of[obj]
+                warn("%s is used by %s, of another partition: sharing %s",
+                     obj, user, root)
+                for other in root_of:
+                    if root_of[other] is root:
+                        part[other] = None
+                changed = True
+
+    for obj in objects:
+        if core_of[obj] is not None:
+            for user in referrers[obj]:
+                if part[user] is not part[obj]:
+                    warn("%s refers to %s, of another partition, and must "
+                         "not call it while simulating", user, obj)
+
+    # The partitions in blocks of queues, the shared objects on the first
+    units = []
+    for core in cores:
+        if find(core) not in units:
+            units.append(find(core))
+    queue_of = dict((unit, queues[i * len(queues) // len(units)])
+                    for i, unit in enumerate(units))
+    queue_of[None] = queues[0]
+    for obj in objects:
+        obj.eventq_index = queue_of[part[obj]]
+
+    # A bridge between the partitions on every connection, even on the
+    # same queue, so that the timing does not depend on the queues
+    bridges = 0
+    for obj in objects:
+        for port in list(_ports(obj)):
+            peer = port.peer
+            other = peer.simobj
+            if other not in part or part[other] is part[obj]:
+                continue
+            if port.role == RESPONDER and peer.role == REQUESTOR:
+                # bridged from the other side
+                continue
+            if port.role != REQUESTOR or peer.role != RESPONDER:
+                fatal("Cannot bridge %s and %s, of roles '%s' and '%s', "
+                      "in different partitions", port, peer, port.role,
+                      peer.role)
+            for side in (obj, other):
+                if _is_a(side, ('BaseCache', 'RubyPort')):
+                    warn("%s is coherent but bridged from %s, and the "
+                         "bridge does not carry snoops", side,
+                         other if side is obj else obj)
+            bridge = EventQueueBridge(
+                delay=latency, eventq_index=queue_of[part[obj]],
+                mem_side_eventq_index=queue_of[part[other]])
+            if port.index < 0:
+                name = '%s_bridge' % port.name
+            else:
+                name = '%s%d_bridge' % (port.name, port.index)
+            setattr(obj, name, bridge)
+            port.splice(bridge.cpu_side_port, bridge.mem_side_port)
+            bridges += 1
+
+    if arena is not None and len(units) > 1:
+        for core in cores:
+            for process in core.workload:
+                process.physArenaSize = arena
+
+    inform("Partitioned %s: %d partitions on %d queues, %d bridges",
+           system, len(units), len(queues), bridges)
+    return [[core for core in cores if find(core) is unit]
+            for unit in units]
@@ -115,6 +115,12 @@ pybind_init_event(py::module_ &m_native)
     m.def("getEventQueue", &getEventQueue,
           py::return_value_policy::reference);
 
+    py::enum_<EventQueue::Structure>(m, "EventQueueStructure")
+        .value("list", EventQueue::Structure::BinList)
+        .value("heap", EventQueue::Structure::BinHeap)
+        ;
+    m.def("setEventQueueStructure", &setEventQueueStructure);
+
     py::class_<EventQueue>(m, "EventQueue")
         .def("name",  [](EventQueue *eq) { return eq->name(); })
         .def("dump", &EventQueue::dump)
@@ -46,6 +46,9 @@ class Process(SimObject):
                             table in an architecture-specific format')
     kvmInSE = Param.Bool('false', 'initialize the process for KvmCPU in SE')
     maxStackSize = Param.MemorySize('64MiB', 'maximum size of the stack')
+    physArenaSize = Param.MemorySize('0', 'physical memory reserved for '
+        'this process alone at its first allocation (0 to allocate from '
+        'the workload as needed)')
 
     uid = Param.Int(100, 'user id')
     euid = Param.Int(100, 'effective user id')
@@ -30,6 +30,7 @@
 
 #include "sim/eventq.hh"
 
+#include <algorithm>
 #include <cassert>
 #include <iostream>
 #include <mutex>
@@ -39,6 +40,7 @@
 
 #include "base/logging.hh"
 #include "base/trace.hh"
+#include "config/use_eventq_heap.hh"
 #include "cpu/smt.hh"
 #include "debug/Checkpoint.hh"
 
@@ -70,6 +72,18 @@ getEventQueue(uint32_t index)
     return mainEventQueue[index];
 }
 
+void
+setEventQueueStructure(EventQueue::Structure s)
+{
+    EventQueue::defaultStructure(s);
+    for (uint32_t i = 0; i < numMainEventQueues; ++i)
+        mainEventQueue[i]->structure(s);
+}
+
+EventQueue::Structure EventQueue::_defaultStructure =
+    USE_EVENTQ_HEAP ? EventQueue::Structure::BinHeap :
+    EventQueue::Structure::BinList;
+
 #ifndef NDEBUG
 Counter Event::instanceCounter = 0;
 #endif
@@ -111,6 +125,11 @@ Event::insertBefore(Event *event, Event *curr)
 void
 EventQueue::insert(Event *event)
 {
+    if (_structure == Structure::BinHeap) {
+        heapInsert(event);
+        return;
+    }
+
     // Deal with the head case
     if (!head || *event <= *head) {
         head = Event::insertBefore(event, head);
@@ -170,6 +189,11 @@ EventQueue::remove(Event *event)
 
     assert(event->queue == this);
 
+    if (_structure == Structure::BinHeap) {
+        heapRemove(event);
+        return;
+    }
+
     // deal with an event on the head's 'in bin' list (event has the same
     // time as the head)
     if (*head == *event) {
@@ -194,6 +218,185 @@ EventQueue::remove(Event *event)
     prev->nextBin = Event::removeItem(event, curr);
 }
 
+void
+EventQueue::heapUp(size_t pos)
+{
+    Bin *bin = binHeap[pos];
+    while (pos > 0) {
+        size_t parent = (pos - 1) / 4;
+        if (!(*bin->top < *binHeap[parent]->top))
+            break;
+        binHeap[pos] = binHeap[parent];
+        binHeap[pos]->pos = pos;
+        pos = parent;
+    }
+    binHeap[pos] = bin;
+    bin->pos = pos;
+}
+
+void
+EventQueue::heapDown(size_t pos)
+{
+    Bin *bin = binHeap[pos];
+    const size_t size = binHeap.size();
+    while (true) {
+        size_t first = 4 * pos + 1;
+        if (first >= size)
+            break;
+        size_t best = first;
+        size_t last = std::min(first + 4, size);
+        for (size_t child = first + 1; child < last; ++child) {
+            if (*binHeap[child]->top < *binHeap[best]->top)
+                best = child;
+        }
+        if (!(*binHeap[best]->top < *bin->top))
+            break;
+        binHeap[pos] = binHeap[best];
+        binHeap[pos]->pos = pos;
+        pos = best;
+    }
+    binHeap[pos] = bin;
+    bin->pos = pos;
+}
+
+void
+EventQueue::heapErase(Bin *bin)
+{
+    size_t pos = bin->pos;
+    Bin *last = binHeap.back();
+    binHeap.pop_back();
+    if (last == bin)
+        return;
+
+    binHeap[pos] = last;
+    if (pos > 0 && *last->top < *binHeap[(pos - 1) / 4]->top)
+        heapUp(pos);
+    else
+        heapDown(pos);
+}
+
+void
+EventQueue::heapInsert(Event *event)
+{
+    auto [it, fresh] =
+        binMap.try_emplace(BinKey{event->when(), event->priority()});
+    Bin &bin = it->second;
+
+    // The new event goes on top of the stack of its bin, whose key
+    // (and hence position in the heap) does not change
+    event->nextBin = NULL;
+    event->nextInBin = bin.top;
+    bin.top = event;
+    if (fresh) {
+        bin.pos = binHeap.size();
+        binHeap.push_back(&bin);
+        heapUp(bin.pos);
+    }
+
+    head = binHeap[0]->top;
+}
+
+void
+EventQueue::heapRemove(Event *event)
+{
+    auto it = binMap.find(BinKey{event->when(), event->priority()});
+    if (it == binMap.end())
+        panic("event not found!");
+
+    // nextBin is NULL, so this returns NULL once the bin is empty
+    Bin &bin = it->second;
+    bin.top = Event::removeItem(event, bin.top);
+    if (!bin.top) {
+        heapErase(&bin);
+        binMap.erase(it);
+    }
+
+    head = binHeap.empty() ? NULL : binHeap[0]->top;
+}
+
+void
+EventQueue::heapPop()
+{
+    Bin *bin = binHeap[0];
+    Event *event = bin->top;
+    bin->top = event->nextInBin;
+    if (!bin->top) {
+        heapErase(bin);
+        binMap.erase(BinKey{event->when(), event->priority()});
+    }
+
+    head = binHeap.empty() ? NULL : binHeap[0]->top;
+}
+
+Event *
+EventQueue::heapToList()
+{
+    Event *list = NULL;
+    Event **link = &list;
+    while (!binHeap.empty()) {
+        Event *top = binHeap[0]->top;
+        *link = top;
+        link = &top->nextBin;
+        heapErase(binHeap[0]);
+    }
+    *link = NULL;
+
+    binMap.clear();
+    head = NULL;
+    return list;
+}
+
+void
+EventQueue::heapFromList(Event *list)
+{
+    // The bins of the list are sorted, so each one lands on a leaf
+    // of the heap and stays there
+    while (list) {
+        Event *top = list;
+        list = top->nextBin;
+        top->nextBin = NULL;
+
+        auto [it, fresh] =
+            binMap.try_emplace(BinKey{top->when(), top->priority()});
+        panic_if(!fresh, "Event list has two bins for priority %d @ %d.",
+                 (int)top->priority(), top->when());
+        Bin &bin = it->second;
+        bin.top = top;
+        bin.pos = binHeap.size();
+        binHeap.push_back(&bin);
+        heapUp(bin.pos);
+    }
+
+    head = binHeap.empty() ? NULL : binHeap[0]->top;
+}
+
+std::vector<Event *>
+EventQueue::bins() const
+{
+    std::vector<Event *> tops;
+    if (_structure == Structure::BinHeap) {
+        for (const Bin *bin : binHeap)
+            tops.push_back(bin->top);
+        std::sort(tops.begin(), tops.end(),
+                  [](const Event *l, const Event *r) { return *l < *r; });
+    } else {
+        for (Event *bin = head; bin; bin = bin->nextBin)
+            tops.push_back(bin);
+    }
+    return tops;
+}
+
+void
+EventQueue::structure(Structure s)
+{
+    if (s == _structure)
+        return;
+
+    Event *events = replaceHead(NULL);
+    _structure = s;
+    replaceHead(events);
+}
+
 Event *
 EventQueue::serviceOne()
 {
@@ -202,7 +405,9 @@ EventQueue::serviceOne()
     Event *next = head->nextInBin;
     event->flags.clear(Event::Scheduled);
 
-    if (next) {
+    if (_structure == Structure::BinHeap) {
+        heapPop();
+    } else if (next) {
         // update the next bin pointer since it could be stale
         next->nextBin = head->nextBin;
 
@@ -295,15 +500,12 @@ EventQueue::dump() const
     if (empty())
         cprintf("<No Events>\n");
     else {
-        Event *nextBin = head;
-        while (nextBin) {
+        for (Event *nextBin : bins()) {
             Event *nextInBin = nextBin;
             while (nextInBin) {
                 nextInBin->dump();
                 nextInBin = nextInBin->nextInBin;
             }
-
-            nextBin = nextBin->nextBin;
         }
     }
 
@@ -318,8 +520,27 @@ EventQueue::debugVerify() const
     Tick time = 0;
     short priority = 0;
 
-    Event *nextBin = head;
-    while (nextBin) {
+    for (size_t i = 0; i < binHeap.size(); ++i) {
+        const Bin *bin = binHeap[i];
+        const Bin *parent = binHeap[i > 0 ? (i - 1) / 4 : 0];
+        if (bin->pos != i || *bin->top < *parent->top) {
+            cprintf("heap order broken!");
+            bin->top->dump();
+            return false;
+        }
+        auto it = binMap.find(BinKey{bin->top->when(), bin->top->priority()});
+        if (it == binMap.end() || &it->second != bin) {
+            cprintf("bin not in the map!");
+            bin->top->dump();
+            return false;
+        }
+    }
+    if (binMap.size() != binHeap.size()) {
+        cprintf("stale bins in the map!");
+        return false;
+    }
+
+    for (Event *nextBin : bins()) {
         Event *nextInBin = nextBin;
         while (nextInBin) {
             if (nextInBin->when() < time) {
@@ -345,8 +566,6 @@ EventQueue::debugVerify() const
 
             nextInBin = nextInBin->nextInBin;
         }
-
-        nextBin = nextBin->nextBin;
     }
 
     return true;
@@ -355,6 +574,12 @@ EventQueue::debugVerify() const
 Event*
 EventQueue::replaceHead(Event* s)
 {
+    if (_structure == Structure::BinHeap) {
+        Event *t = heapToList();
+        heapFromList(s);
+        return t;
+    }
+
     Event* t = head;
     head = s;
     return t;
@@ -416,7 +641,7 @@ Event::dump() const
 }
 
 EventQueue::EventQueue(const std::string &n)
-    : objName(n), head(NULL), _curTick(0)
+    : objName(n), head(NULL), _curTick(0), _structure(_defaultStructure)
 {
 }
 
@@ -43,6 +43,8 @@
 #include <list>
 #include <memory>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "base/debug.hh"
 #include "base/flags.hh"
@@ -261,7 +263,9 @@ class Event : public EventBase, public Serializable
     // result is that the insert/removal in 'nextBin' is
     // linear/constant, and the lookup/removal in 'nextInBin' is
     // constant/constant.  Hopefully this is a significant improvement
-    // over the current fully linear insertion.
+    // over the current fully linear insertion.  When the queue keeps
+    // its bins in a heap instead (see EventQueue::Structure), only
+    // 'nextInBin' is used and 'nextBin' stays NULL.
     Event *nextBin;
     Event *nextInBin;
 
@@ -621,6 +625,30 @@ operator!=(const Event &l, const Event &r)
  */
 class EventQueue
 {
+  public:
+    /**
+     * How the queue finds its bins. Events with the same when and
+     * priority share a bin and are serviced in LIFO order, and bins
+     * are serviced in (when, priority) order, whichever the structure:
+     * they only differ in the cost of reaching a bin that is not the
+     * head.
+     *
+     * BinList links the bins in a sorted list through nextBin, so
+     * inserting or removing an event is linear in the number of bins
+     * ahead of it. BinHeap keeps them in a 4-ary min-heap and finds
+     * them through a hash map on (when, priority), which makes these
+     * operations logarithmic in the number of pending bins at the
+     * cost of a hash lookup. It pays off when thousands of distinct
+     * ticks are pending, e.g., in large Ruby networks.
+     *
+     * @ingroup api_eventq
+     */
+    enum class Structure
+    {
+        BinList,
+        BinHeap
+    };
+
   private:
     friend void curEventQueue(EventQueue *);
 
@@ -628,6 +656,64 @@ class EventQueue
     Event *head;
     Tick _curTick;
 
+    //! Structure used by queues created from now on.
+    static Structure _defaultStructure;
+
+    Structure _structure;
+
+    /**
+     * A bin of the heap structure: its top event and its index in
+     * binHeap. The bins live in binMap, whose nodes are stable.
+     */
+    struct Bin
+    {
+        Event *top = nullptr;
+        size_t pos = 0;
+    };
+
+    struct BinKey
+    {
+        Tick when;
+        Event::Priority priority;
+
+        bool
+        operator==(const BinKey &other) const
+        {
+            return when == other.when && priority == other.priority;
+        }
+    };
+
+    struct BinKeyHash
+    {
+        size_t
+        operator()(const BinKey &key) const
+        {
+            return (key.when * 0x9e3779b97f4a7c15ULL) ^
+                (uint8_t)key.priority;
+        }
+    };
+
+    //! Bins of the heap structure by (when, priority).
+    std::unordered_map<BinKey, Bin, BinKeyHash> binMap;
+
+    //! 4-ary min-heap of the bins, ordered by their top event.
+    std::vector<Bin *> binHeap;
+
+    //! Heap structure counterparts of insert(), remove(), the pop in
+    //! serviceOne() and replaceHead().
+    void heapInsert(Event *event);
+    void heapRemove(Event *event);
+    void heapPop();
+    Event *heapToList();
+    void heapFromList(Event *list);
+
+    void heapUp(size_t pos);
+    void heapDown(size_t pos);
+    void heapErase(Bin *bin);
+
+    //! Top events of the bins, in service order.
+    std::vector<Event *> bins() const;
+
     //! Mutex to protect async queue.
     UncontendedMutex async_queue_mutex;
 
@@ -747,6 +833,28 @@ class EventQueue
      */
     EventQueue(const std::string &n);
 
+    /**
+     * Structure of the queues created from now on; the build default
+     * is BinList, or BinHeap with USE_EVENTQ_HEAP.
+     *
+     * @ingroup api_eventq
+     * @{
+     */
+    static Structure defaultStructure() { return _defaultStructure; }
+    static void defaultStructure(Structure s) { _defaultStructure = s; }
+    /** @}*/ //end of api_eventq group
+
+    /**
+     * Structure of this queue. Switching moves the pending events over
+     * without changing their service order.
+     *
+     * @ingroup api_eventq
+     * @{
+     */
+    Structure structure() const { return _structure; }
+    void structure(Structure s);
+    /** @}*/ //end of api_eventq group
+
     /**
      * @ingroup api_eventq
      * @{
@@ -984,6 +1092,12 @@ curEventQueue(EventQueue *q)
 
 void dumpMainQueue();
 
+/**
+ * Make s the structure of the main event queues, existing and to be
+ * created.
+ */
+void setEventQueueStructure(EventQueue::Structure s);
+
 class EventManager
 {
   protected:
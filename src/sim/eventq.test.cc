@@ -0,0 +1,247 @@
+/*
+ * Copyright (c) 2026 The Regents of the University of California
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "sim/eventq.hh"
+
+using namespace gem5;
+
+/** An event that logs its id when processed. */
+class LogEvent : public Event
+{
+  public:
+    LogEvent(int _id, std::vector<int> &_log, Priority p)
+        : Event(p), id(_id), log(_log)
+    {}
+
+    void process() override { log.push_back(id); }
+
+    const int id;
+
+  private:
+    std::vector<int> &log;
+};
+
+/**
+ * The same events scheduled on a list and a heap queue, each with its
+ * own service log. Operations are applied to both sides alike.
+ */
+class Mirror
+{
+  public:
+    Mirror(int num_events)
+        : listQueue("list"), heapQueue("heap")
+    {
+        listQueue.structure(EventQueue::Structure::BinList);
+        heapQueue.structure(EventQueue::Structure::BinHeap);
+
+        // Few priorities and close ticks, so that bins are shared
+        const Event::Priority prios[] = {
+            Event::Default_Pri, Event::CPU_Tick_Pri, Event::Sim_Exit_Pri
+        };
+        for (int i = 0; i < num_events; ++i) {
+            Event::Priority p = prios[i % 3];
+            listEvents.emplace_back(new LogEvent(i, listLog, p));
+            heapEvents.emplace_back(new LogEvent(i, heapLog, p));
+        }
+    }
+
+    ~Mirror()
+    {
+        drain();
+    }
+
+    void
+    schedule(int i, Tick delay)
+    {
+        listQueue.schedule(listEvents[i].get(),
+                           listQueue.getCurTick() + delay);
+        heapQueue.schedule(heapEvents[i].get(),
+                           heapQueue.getCurTick() + delay);
+    }
+
+    void
+    deschedule(int i)
+    {
+        listQueue.deschedule(listEvents[i].get());
+        heapQueue.deschedule(heapEvents[i].get());
+    }
+
+    void
+    reschedule(int i, Tick delay)
+    {
+        listQueue.reschedule(listEvents[i].get(),
+                             listQueue.getCurTick() + delay, true);
+        heapQueue.reschedule(heapEvents[i].get(),
+                             heapQueue.getCurTick() + delay, true);
+    }
+
+    void
+    serviceOne()
+    {
+        listQueue.serviceOne();
+        heapQueue.serviceOne();
+    }
+
+    void
+    drain()
+    {
+        while (!listQueue.empty())
+            listQueue.serviceOne();
+        while (!heapQueue.empty())
+            heapQueue.serviceOne();
+    }
+
+    EventQueue listQueue;
+    EventQueue heapQueue;
+    std::vector<std::unique_ptr<LogEvent>> listEvents;
+    std::vector<std::unique_ptr<LogEvent>> heapEvents;
+    std::vector<int> listLog;
+    std::vector<int> heapLog;
+};
+
+/**
+ * Random schedules, deschedules and reschedules service the events in
+ * the same order with both structures.
+ */
+TEST(EventQueueTest, SameServiceOrder)
+{
+    const int num_events = 500;
+    Mirror mirror(num_events);
+    std::mt19937 rng(7);
+
+    for (int step = 0; step < 20000; ++step) {
+        int i = rng() % num_events;
+        Tick delay = rng() % 64;
+        bool scheduled = mirror.listEvents[i]->scheduled();
+        ASSERT_EQ(scheduled, mirror.heapEvents[i]->scheduled());
+
+        switch (rng() % 4) {
+          case 0:
+            if (scheduled)
+                mirror.deschedule(i);
+            else
+                mirror.schedule(i, delay);
+            break;
+          case 1:
+            mirror.reschedule(i, delay);
+            break;
+          default:
+            if (!mirror.listQueue.empty())
+                mirror.serviceOne();
+            break;
+        }
+
+        ASSERT_EQ(mirror.listQueue.empty(), mirror.heapQueue.empty());
+        if (!mirror.listQueue.empty()) {
+            ASSERT_EQ(mirror.listQueue.nextTick(),
+                      mirror.heapQueue.nextTick());
+            ASSERT_EQ(static_cast<LogEvent *>(
+                          mirror.listQueue.getHead())->id,
+                      static_cast<LogEvent *>(
+                          mirror.heapQueue.getHead())->id);
+        }
+        if (step % 1000 == 0) {
+            ASSERT_TRUE(mirror.heapQueue.debugVerify());
+        }
+    }
+
+    mirror.drain();
+    ASSERT_FALSE(mirror.listLog.empty());
+    ASSERT_EQ(mirror.listLog, mirror.heapLog);
+}
+
+/** Switching the structure with pending events keeps their order. */
+TEST(EventQueueTest, SwitchStructure)
+{
+    const int num_events = 300;
+    Mirror mirror(num_events);
+    std::mt19937 rng(11);
+
+    for (int i = 0; i < num_events; ++i)
+        mirror.schedule(i, rng() % 100);
+    for (int i = 0; i < 50; ++i)
+        mirror.serviceOne();
+
+    // Swap the structures of the two sides, twice
+    for (int round = 0; round < 2; ++round) {
+        EventQueue::Structure list_s = mirror.listQueue.structure();
+        mirror.listQueue.structure(mirror.heapQueue.structure());
+        mirror.heapQueue.structure(list_s);
+        ASSERT_NE(mirror.listQueue.structure(),
+                  mirror.heapQueue.structure());
+        ASSERT_TRUE(mirror.listQueue.debugVerify());
+        ASSERT_TRUE(mirror.heapQueue.debugVerify());
+
+        for (int i = 0; i < num_events; i += 7)
+            mirror.reschedule(i, rng() % 100);
+        for (int i = 0; i < 50; ++i)
+            mirror.serviceOne();
+    }
+
+    mirror.drain();
+    ASSERT_EQ(mirror.listLog.size(), mirror.heapLog.size());
+    ASSERT_EQ(mirror.listLog, mirror.heapLog);
+}
+
+/**
+ * Replacing the head of a heap queue sets its events aside, like with
+ * the list, and restoring it brings them back in order.
+ */
+TEST(EventQueueTest, ReplaceHead)
+{
+    const int num_events = 100;
+    Mirror mirror(num_events);
+    std::mt19937 rng(13);
+
+    for (int i = 0; i < num_events - 1; ++i)
+        mirror.schedule(i, 1 + rng() % 50);
+
+    Event *list_saved = mirror.listQueue.replaceHead(NULL);
+    Event *heap_saved = mirror.heapQueue.replaceHead(NULL);
+    ASSERT_TRUE(mirror.listQueue.empty());
+    ASSERT_TRUE(mirror.heapQueue.empty());
+
+    // Run another event in between
+    mirror.schedule(num_events - 1, 0);
+    mirror.serviceOne();
+    ASSERT_EQ(mirror.heapLog, std::vector<int>{num_events - 1});
+
+    ASSERT_EQ(mirror.listQueue.replaceHead(list_saved), nullptr);
+    ASSERT_EQ(mirror.heapQueue.replaceHead(heap_saved), nullptr);
+    ASSERT_TRUE(mirror.heapQueue.debugVerify());
+
+    mirror.drain();
+    ASSERT_EQ(mirror.heapLog.size(), (size_t)num_events);
+    ASSERT_EQ(mirror.listLog, mirror.heapLog);
+}
@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2026 The Regents of the University of California
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * Scheduling throughput of the event queue structures.
+ *
+ * Runs the hold model: a fixed number of events are pending, and each
+ * one reschedules itself when serviced, after a random number of
+ * cycles. With "spread" delays (up to twice the number of events) the
+ * pending events sit on about as many distinct ticks, which is where
+ * the list structure is linear; with "clocked" delays (1 to 4 cycles)
+ * they share a handful of bins near the head.
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "base/cprintf.hh"
+#include "sim/eventq.hh"
+
+using namespace gem5;
+
+namespace
+{
+
+const Tick period = 500;
+
+class HoldEvent : public Event
+{
+  public:
+    HoldEvent(EventQueue &_eq, const std::vector<Tick> &_delays, size_t _idx)
+        : eq(_eq), delays(_delays), idx(_idx)
+    {}
+
+    void
+    process() override
+    {
+        idx = (idx + 1) % delays.size();
+        eq.schedule(this, eq.getCurTick() + delays[idx]);
+    }
+
+  private:
+    EventQueue &eq;
+    const std::vector<Tick> &delays;
+    size_t idx;
+};
+
+double
+run(EventQueue::Structure structure, int pending, Tick max_cycles,
+    long services)
+{
+    EventQueue eq("bench");
+    eq.structure(structure);
+    curEventQueue(&eq);
+
+    // The same delays for both structures, drawn up front
+    std::mt19937_64 rng(pending);
+    std::vector<Tick> delays(1 << 16);
+    for (auto &delay : delays)
+        delay = (1 + rng() % max_cycles) * period;
+
+    std::vector<HoldEvent *> events;
+    for (int i = 0; i < pending; ++i) {
+        events.push_back(new HoldEvent(eq, delays, i * 7919));
+        eq.schedule(events.back(), delays[i] - period);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < services; ++i)
+        eq.serviceOne();
+    auto end = std::chrono::steady_clock::now();
+
+    for (auto *event : events) {
+        eq.deschedule(event);
+        delete event;
+    }
+    curEventQueue(nullptr);
+
+    return services / std::chrono::duration<double>(end - start).count();
+}
+
+} // anonymous namespace
+
+int
+main(int argc, char *argv[])
+{
+    long services = argc > 1 ? std::atol(argv[1]) : 200000;
+
+    cprintf("%-8s %8s %16s %16s %8s\n", "delays", "pending",
+            "list events/s", "heap events/s", "speedup");
+    for (bool spread : {false, true}) {
+        for (int pending : {16, 256, 1024, 4096, 16384}) {
+            Tick max_cycles = spread ? 2 * pending : 4;
+            double list = run(EventQueue::Structure::BinList, pending,
+                              max_cycles, services);
+            double heap = run(EventQueue::Structure::BinHeap, pending,
+                              max_cycles, services);
+            cprintf("%-8s %8d %16d %16d %7.2fx\n",
+                    spread ? "spread" : "clocked", pending, (uint64_t)list,
+                    (uint64_t)heap, heap / list);
+        }
+    }
+
+    return 0;
+}
@@ -30,6 +30,7 @@
 #include "sim/global_event.hh"
 
 #include "sim/cur_tick.hh"
+#include "sim/mailbox.hh"
 
 namespace gem5
 {
@@ -146,12 +147,15 @@ GlobalSyncEvent::BarrierEvent::process()
     // wait for all queues to arrive at barrier, then process event
     if (globalBarrier()) {
         _globalEvent->process();
+        // messages posted from now on belong to the next quantum
+        MailboxBase::closeQuantum();
     }
 
     // second barrier to force all queues to wait for event processing
     // to finish before continuing
     globalBarrier();
     curEventQueue()->handleAsyncInsertions();
+    MailboxBase::collectAll(curEventQueue());
 }
 
 void
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2026 The Regents of the University of California
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "sim/mailbox.hh"
+
+#include <map>
+
+namespace gem5
+{
+
+std::atomic<uint64_t> MailboxBase::_quantum(0);
+
+namespace
+{
+
+/**
+ * The mailboxes towards each queue, in the order of creation. Only
+ * changed while the simulation threads are stopped.
+ */
+std::map<EventQueue *, std::vector<MailboxBase *>> &
+mailboxes()
+{
+    static std::map<EventQueue *, std::vector<MailboxBase *>> boxes;
+    return boxes;
+}
+
+} // anonymous namespace
+
+MailboxBase::MailboxBase(const std::string &name, EventQueue *destination)
+    : _name(name), _destination(destination)
+{
+    mailboxes()[destination].push_back(this);
+}
+
+MailboxBase::~MailboxBase()
+{
+    auto it = mailboxes().find(_destination);
+    auto &boxes = it->second;
+    boxes.erase(std::find(boxes.begin(), boxes.end(), this));
+    if (boxes.empty())
+        mailboxes().erase(it);
+}
+
+bool
+MailboxBase::inUse()
+{
+    return !mailboxes().empty();
+}
+
+void
+MailboxBase::collectAll(EventQueue *destination)
+{
+    auto it = mailboxes().find(destination);
+    if (it == mailboxes().end())
+        return;
+    for (auto *box : it->second)
+        box->collect();
+}
+
+} // namespace gem5
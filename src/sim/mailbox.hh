@@ -0,0 +1,275 @@
+/*
+ * Copyright (c) 2026 The Regents of the University of California
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file sim/mailbox.hh
+ * Timestamped mailboxes between event queues.
+ *
+ * Objects on different event queues, i.e., on different simulation
+ * threads, must not call each other. Scheduling an event on another
+ * queue goes through its asynchronous insertion list, where the order
+ * of events with the same tick and priority depends on the timing of
+ * the host threads. A mailbox carries messages to an object on one
+ * queue from objects on any queue, and does so deterministically:
+ *
+ * - A message is posted with the tick at which it must be delivered,
+ *   at least one simulation quantum after the current tick.
+ * - The messages posted during a quantum are handed to the destination
+ *   queue once all the threads have reached the end of the quantum, by
+ *   the GlobalSyncEvent, and never earlier whatever the speed of the
+ *   threads.
+ * - They are then delivered at their tick by an event of the
+ *   destination queue, in the order of their ticks and then of their
+ *   posting, mailbox by mailbox in the order of creation.
+ *
+ * A mailbox must have a single sender, i.e., all its messages must be
+ * posted by the same group of objects: the order of the messages of
+ * different senders for the same tick would depend on the timing of
+ * their threads. Objects with several senders use a mailbox per
+ * sender, created in a deterministic order.
+ *
+ * The delivery of the messages therefore does not depend on the number
+ * of simulation threads: a run with all the objects on one queue sees
+ * the same messages at the same ticks as a run with one queue per
+ * group of objects, as long as the groups only talk through mailboxes.
+ */
+
+#ifndef __SIM_MAILBOX_HH__
+#define __SIM_MAILBOX_HH__
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/logging.hh"
+#include "base/types.hh"
+#include "sim/eventq.hh"
+
+namespace gem5
+{
+
+class MailboxBase
+{
+  private:
+    const std::string _name;
+
+    /** The queue the messages are delivered on. */
+    EventQueue *const _destination;
+
+    /** Number of the quantum messages are currently posted in. */
+    static std::atomic<uint64_t> _quantum;
+
+  protected:
+    static uint64_t currentQuantum() { return _quantum.load(); }
+
+    /**
+     * Hand the messages of the closed quanta to the destination queue.
+     * Called from the thread of that queue.
+     */
+    virtual void collect() = 0;
+
+  public:
+    MailboxBase(const std::string &name, EventQueue *destination);
+    virtual ~MailboxBase();
+
+    MailboxBase(const MailboxBase &) = delete;
+    MailboxBase &operator=(const MailboxBase &) = delete;
+
+    const std::string &name() const { return _name; }
+    EventQueue *destination() const { return _destination; }
+
+    /** Are there mailboxes, i.e., does the simulation need quanta? */
+    static bool inUse();
+
+    /**
+     * End the current quantum: the messages posted until now may be
+     * collected. Called by a single thread while the others wait, at
+     * the end of every quantum and before the simulation loop starts.
+     */
+    static void closeQuantum() { ++_quantum; }
+
+    /** Collect the messages of all the mailboxes towards a queue. */
+    static void collectAll(EventQueue *destination);
+};
+
+/**
+ * A mailbox of messages of type T, which are passed to a handler on
+ * the destination queue at their tick.
+ */
+template <class T>
+class Mailbox : public MailboxBase
+{
+  public:
+    typedef std::function<void(T &)> Handler;
+
+  private:
+    struct Message
+    {
+        Tick when;
+        uint64_t quantum;
+        T payload;
+    };
+
+    struct EarlierTick
+    {
+        bool
+        operator()(const Message &a, const Message &b) const
+        {
+            return a.when < b.when;
+        }
+    };
+
+    Handler handler;
+
+    /** Protects the outbox, the only state shared between threads. */
+    mutable std::mutex mutex;
+
+    /** Posted messages, in the order of posting. */
+    std::deque<Message> outbox;
+
+    /** Collected messages, in the order of delivery. */
+    std::deque<Message> inbox;
+
+    EventFunctionWrapper deliverEvent;
+
+    void
+    collect() override
+    {
+        std::vector<Message> collected;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            const uint64_t open = currentQuantum();
+            auto end = std::find_if(outbox.begin(), outbox.end(),
+                [open](const Message &m) { return m.quantum >= open; });
+            collected.assign(std::make_move_iterator(outbox.begin()),
+                             std::make_move_iterator(end));
+            outbox.erase(outbox.begin(), end);
+        }
+        if (collected.empty())
+            return;
+
+        // Both sorts are stable, so messages for the same tick stay in
+        // the order of posting
+        std::stable_sort(collected.begin(), collected.end(), EarlierTick());
+        const size_t pending = inbox.size();
+        inbox.insert(inbox.end(), std::make_move_iterator(collected.begin()),
+                     std::make_move_iterator(collected.end()));
+        std::inplace_merge(inbox.begin(), inbox.begin() + pending,
+                           inbox.end(), EarlierTick());
+
+        const Tick first = inbox.front().when;
+        panic_if(first < destination()->getCurTick(),
+                 "%s: message for tick %d collected at tick %d.\n",
+                 name(), first, destination()->getCurTick());
+        if (!deliverEvent.scheduled())
+            destination()->schedule(&deliverEvent, first);
+        else if (first < deliverEvent.when())
+            destination()->reschedule(&deliverEvent, first);
+    }
+
+    void
+    deliver()
+    {
+        const Tick now = destination()->getCurTick();
+        while (!inbox.empty() && inbox.front().when <= now) {
+            // The handler may post more messages, so take this one out
+            // of the inbox first
+            T payload = std::move(inbox.front().payload);
+            inbox.pop_front();
+            handler(payload);
+        }
+        if (!inbox.empty())
+            destination()->schedule(&deliverEvent, inbox.front().when);
+    }
+
+  public:
+    Mailbox(const std::string &name, EventQueue *destination,
+            Handler _handler, Event::Priority prio=Event::Default_Pri)
+        : MailboxBase(name, destination), handler(_handler),
+          deliverEvent([this]{ deliver(); }, name + ".deliver", false, prio)
+    {}
+
+    ~Mailbox()
+    {
+        if (deliverEvent.scheduled())
+            destination()->deschedule(&deliverEvent);
+    }
+
+    /**
+     * Post a message for the given tick. May be called from any
+     * thread.
+     */
+    void
+    post(Tick when, T payload)
+    {
+        panic_if(when < curTick() + simQuantum,
+                 "%s: message for tick %d posted at tick %d, less than "
+                 "the quantum (%d) ahead.\n",
+                 name(), when, curTick(), simQuantum);
+        std::lock_guard<std::mutex> lock(mutex);
+        outbox.push_back(Message{when, currentQuantum(), std::move(payload)});
+    }
+
+    /**
+     * Are all the messages delivered? Only meaningful when the threads
+     * are stopped, e.g., when draining.
+     */
+    bool
+    empty() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return outbox.empty() && inbox.empty();
+    }
+
+    /**
+     * Apply a function to all the messages not delivered yet, in no
+     * particular order, e.g., to look for data in flight. Called from
+     * the thread of the destination queue or while holding it.
+     */
+    template <class F>
+    void
+    forEach(F f)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto &m : inbox)
+            f(m.payload);
+        for (auto &m : outbox)
+            f(m.payload);
+    }
+};
+
+} // namespace gem5
+
+#endif // __SIM_MAILBOX_HH__
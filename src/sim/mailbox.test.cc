@@ -0,0 +1,292 @@
+/*
+ * Copyright (c) 2026 The Regents of the University of California
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <memory>
+#include <random>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "base/barrier.hh"
+#include "sim/cur_tick.hh"
+#include "sim/eventq.hh"
+#include "sim/mailbox.hh"
+
+using namespace gem5;
+
+namespace
+{
+
+const Tick quantum = 100;
+const int numNodes = 4;
+const int numQuanta = 120;
+
+struct Note
+{
+    int src;
+    int seq;
+    int hops;
+};
+
+/** A delivery as seen by its receiver: tick, sender, sequence, state. */
+typedef std::tuple<Tick, int, int, uint64_t> Delivery;
+
+/**
+ * A group of objects living on an event queue. It sends notes to the
+ * other nodes at random times, and forwards the notes it receives to a
+ * node that depends on everything it received so far.
+ */
+class Node
+{
+  public:
+    Node(int _id, EventQueue *_eventq,
+         std::vector<std::unique_ptr<Node>> &_nodes)
+        : id(_id), eventq(_eventq), nodes(_nodes), rng(_id),
+          sendEvent([this]{ send(); }, "send")
+    {
+        // A mailbox per sender
+        for (int i = 0; i < numNodes; ++i) {
+            boxes.emplace_back(new Mailbox<Note>(
+                "node" + std::to_string(id) + ".box" + std::to_string(i),
+                eventq, [this](Note &note) { receive(note); }));
+        }
+        eventq->schedule(&sendEvent, eventq->getCurTick() + 1 + rng() % 50);
+    }
+
+    ~Node()
+    {
+        if (sendEvent.scheduled())
+            eventq->deschedule(&sendEvent);
+    }
+
+    void
+    send()
+    {
+        int dest = (id + 1 + rng() % (numNodes - 1)) % numNodes;
+        nodes[dest]->boxes[id]->post(curTick() + quantum + rng() % quantum,
+                                     Note{id, sent++, 0});
+        if (sent < 200)
+            eventq->schedule(&sendEvent, curTick() + 1 + rng() % 50);
+    }
+
+    void
+    receive(Note &note)
+    {
+        state = state * 0x100000001b3 ^ (note.src * 1000003 + note.seq);
+        log.emplace_back(curTick(), note.src, note.seq, state);
+        if (note.hops < 3) {
+            int dest = state % numNodes;
+            nodes[dest]->boxes[id]->post(curTick() + quantum + state % 7,
+                                         Note{note.src, note.seq,
+                                              note.hops + 1});
+        }
+    }
+
+    const int id;
+    EventQueue *const eventq;
+    std::vector<std::unique_ptr<Node>> &nodes;
+    std::mt19937 rng;
+    std::vector<std::unique_ptr<Mailbox<Note>>> boxes;
+    EventFunctionWrapper sendEvent;
+    int sent = 0;
+    uint64_t state = 0;
+    std::vector<Delivery> log;
+};
+
+/** Service the events of a queue until the end of a quantum. */
+void
+runQuantum(EventQueue *eventq, Tick end)
+{
+    curEventQueue(eventq);
+    while (!eventq->empty() && eventq->nextTick() < end)
+        eventq->serviceOne();
+    eventq->setCurTick(end);
+}
+
+/**
+ * A simulation of the nodes on a given number of queues, run by a
+ * thread per queue or by a single thread.
+ */
+class Simulation
+{
+  public:
+    Simulation(int num_queues)
+    {
+        for (int i = 0; i < num_queues; ++i)
+            queues.emplace_back(new EventQueue("queue" + std::to_string(i)));
+        for (int i = 0; i < numNodes; ++i) {
+            nodes.emplace_back(
+                new Node(i, queues[i % num_queues].get(), nodes));
+        }
+    }
+
+    ~Simulation()
+    {
+        nodes.clear();
+        curEventQueue(nullptr);
+    }
+
+    void
+    runSingleThread()
+    {
+        for (int q = 1; q <= numQuanta; ++q) {
+            for (auto &eventq : queues)
+                runQuantum(eventq.get(), q * quantum);
+            MailboxBase::closeQuantum();
+            for (auto &eventq : queues) {
+                curEventQueue(eventq.get());
+                MailboxBase::collectAll(eventq.get());
+            }
+        }
+    }
+
+    void
+    runThreads()
+    {
+        Barrier barrier(queues.size());
+        std::vector<std::thread> threads;
+        for (int i = 0; i < (int)queues.size(); ++i) {
+            threads.emplace_back([this, &barrier, i]() {
+                EventQueue *eventq = queues[i].get();
+                std::mt19937 jitter(std::random_device{}());
+                for (int q = 1; q <= numQuanta; ++q) {
+                    runQuantum(eventq, q * quantum);
+                    // Make the threads reach the end of the quantum in a
+                    // different order every time
+                    std::this_thread::sleep_for(
+                        std::chrono::microseconds(jitter() % 50));
+                    if (barrier.wait())
+                        MailboxBase::closeQuantum();
+                    barrier.wait();
+                    MailboxBase::collectAll(eventq);
+                }
+                curEventQueue(nullptr);
+            });
+        }
+        for (auto &t : threads)
+            t.join();
+    }
+
+    std::vector<std::vector<Delivery>>
+    logs() const
+    {
+        std::vector<std::vector<Delivery>> result;
+        for (auto &node : nodes) {
+            EXPECT_FALSE(node->sendEvent.scheduled());
+            for (auto &box : node->boxes)
+                EXPECT_TRUE(box->empty());
+            result.push_back(node->log);
+        }
+        return result;
+    }
+
+    std::vector<std::unique_ptr<EventQueue>> queues;
+    std::vector<std::unique_ptr<Node>> nodes;
+};
+
+} // anonymous namespace
+
+class MailboxTest : public testing::Test
+{
+  protected:
+    void SetUp() override { simQuantum = quantum; }
+    void TearDown() override { simQuantum = 0; }
+};
+
+/** The messages are delivered in order at their tick. */
+TEST_F(MailboxTest, DeliveryOrder)
+{
+    EventQueue eventq("queue");
+    curEventQueue(&eventq);
+    std::vector<std::pair<Tick, int>> log;
+    Mailbox<int> box("box", &eventq, [&](int &value) {
+        log.emplace_back(curTick(), value);
+    });
+
+    // Out of order, and several for the same tick
+    box.post(250, 0);
+    box.post(150, 1);
+    box.post(250, 2);
+    box.post(150, 3);
+
+    // Nothing is delivered before the end of the quantum
+    runQuantum(&eventq, quantum);
+    ASSERT_TRUE(log.empty());
+    ASSERT_FALSE(box.empty());
+
+    MailboxBase::closeQuantum();
+    MailboxBase::collectAll(&eventq);
+    box.post(eventq.getCurTick() + 2 * quantum, 4);
+    runQuantum(&eventq, 3 * quantum);
+
+    // The last message waits for the end of its quantum
+    std::vector<std::pair<Tick, int>> expected = {
+        {150, 1}, {150, 3}, {250, 0}, {250, 2}
+    };
+    ASSERT_EQ(log, expected);
+    MailboxBase::closeQuantum();
+    MailboxBase::collectAll(&eventq);
+    runQuantum(&eventq, 4 * quantum);
+    ASSERT_EQ(log.size(), expected.size() + 1);
+    ASSERT_EQ(log.back(), std::make_pair((Tick)(3 * quantum), 4));
+    ASSERT_TRUE(box.empty());
+    curEventQueue(nullptr);
+}
+
+/**
+ * The nodes see the same deliveries whether they share a queue or not,
+ * and whatever the timing of the threads.
+ */
+TEST_F(MailboxTest, SameDeliveries)
+{
+    std::vector<std::vector<Delivery>> reference;
+    {
+        Simulation sim(1);
+        sim.runSingleThread();
+        reference = sim.logs();
+    }
+    for (auto &log : reference)
+        ASSERT_GT(log.size(), 200u);
+
+    {
+        Simulation sim(numNodes);
+        sim.runSingleThread();
+        ASSERT_EQ(sim.logs(), reference);
+    }
+
+    for (int run = 0; run < 5; ++run) {
+        for (int num_queues : {2, numNodes}) {
+            Simulation sim(num_queues);
+            sim.runThreads();
+            ASSERT_EQ(sim.logs(), reference);
+        }
+    }
+}
@@ -117,6 +117,8 @@ Process::Process(const ProcessParams &params, EmulationPageTable *pTable,
       useArchPT(params.useArchPT),
       kvmInSE(params.kvmInSE),
       useForClone(false),
+      physArenaSize(params.physArenaSize),
+      physArenaNext(0), physArenaEnd(0),
       pTable(pTable),
       objFile(obj_file),
       argv(params.cmd), envp(params.env),
@@ -336,19 +338,43 @@ Process::allocateMem(Addr vaddr, int64_t size, bool clobber)
     }
 
     const int npages = divCeil(size, page_size);
-    const Addr paddr = seWorkload->allocPhysPages(npages);
+    const Addr paddr = allocPhysPages(npages);
     const Addr pages_size = npages * page_size;
     pTable->map(page_addr, paddr, pages_size,
                 clobber ? EmulationPageTable::Clobber :
                           EmulationPageTable::MappingFlags(0));
 }
 
+Addr
+Process::allocPhysPages(int npages)
+{
+    if (!physArenaSize)
+        return seWorkload->allocPhysPages(npages);
+
+    // The arena is reserved at the first allocation, normally when the
+    // process is initialized, so that its pages depend neither on the
+    // other processes nor on the order in which they fault at run time
+    const auto page_size = pTable->pageSize();
+    if (!physArenaEnd) {
+        const int arena_pages = divCeil(physArenaSize, page_size);
+        physArenaNext = seWorkload->allocPhysPages(arena_pages);
+        physArenaEnd = physArenaNext + arena_pages * page_size;
+    }
+
+    const Addr paddr = physArenaNext;
+    fatal_if(paddr + npages * page_size > physArenaEnd,
+             "%s: out of physical memory in the arena of %d bytes, "
+             "increase physArenaSize.", name(), physArenaSize);
+    physArenaNext += npages * page_size;
+    return paddr;
+}
+
 void
 Process::replicatePage(Addr vaddr, Addr new_paddr, ThreadContext *old_tc,
                        ThreadContext *new_tc, bool allocate_page)
 {
     if (allocate_page)
-        new_paddr = seWorkload->allocPhysPages(1);
+        new_paddr = allocPhysPages(1);
 
     // Read from old physical page.
     uint8_t buf_p[pTable->pageSize()];
@@ -373,6 +399,8 @@ Process::serialize(CheckpointOut &cp) const
     memState->serialize(cp);
     pTable->serialize(cp);
     fds->serialize(cp);
+    SERIALIZE_SCALAR(physArenaNext);
+    SERIALIZE_SCALAR(physArenaEnd);
 
     /**
      * Checkpoints for pipes, device drivers or sockets currently
@@ -388,6 +416,8 @@ Process::unserialize(CheckpointIn &cp)
     memState->unserialize(cp);
     pTable->unserialize(cp);
     fds->unserialize(cp);
+    UNSERIALIZE_OPT_SCALAR(physArenaNext);
+    UNSERIALIZE_OPT_SCALAR(physArenaEnd);
     /**
      * Checkpoints for pipes, device drivers or sockets currently
      * do not work. Need to come back and fix them at a later date.
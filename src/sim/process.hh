@@ -121,6 +121,13 @@ class Process : public SimObject
     // requested, and may configure more if necessary.
     void allocateMem(Addr vaddr, int64_t size, bool clobber=false);
 
+    /**
+     * Allocate physical pages for this process, from its arena if it
+     * has one (see the physArenaSize parameter), or from the pools of
+     * the workload otherwise.
+     */
+    Addr allocPhysPages(int npages);
+
     /// Attempt to fix up a fault at vaddr by allocating a page on the stack.
     /// @return Whether the fault has been fixed.
     bool fixupFault(Addr vaddr);
@@ -182,6 +189,12 @@ class Process : public SimObject
     // flag for using the process as a thread which shares page tables
     bool useForClone;
 
+    // physical pages reserved for this process alone: the size, and the
+    // next and end addresses once reserved
+    uint64_t physArenaSize;
+    Addr physArenaNext;
+    Addr physArenaEnd;
+
     EmulationPageTable *pTable;
 
     // Memory proxy for initial image load.
@@ -51,6 +51,7 @@
 #include "base/types.hh"
 #include "sim/async.hh"
 #include "sim/eventq.hh"
+#include "sim/mailbox.hh"
 #include "sim/sim_events.hh"
 #include "sim/sim_exit.hh"
 #include "sim/stat_control.hh"
@@ -203,7 +204,10 @@ simulate(Tick num_cycles)
     }
     simulate_limit_event->reschedule(exit_tick);
 
-    if (numMainEventQueues > 1) {
+    // Mailboxes deliver at quantum boundaries even with a single
+    // queue, so that the simulation does not depend on the number of
+    // queues
+    if (numMainEventQueues > 1 || MailboxBase::inUse()) {
         fatal_if(simQuantum == 0,
                  "Quantum for multi-eventq simulation not specified");
 
@@ -211,7 +215,10 @@ simulate(Tick num_cycles)
             new GlobalSyncEvent(curTick() + simQuantum, simQuantum,
                                 EventBase::Progress_Event_Pri, 0));
 
-        inParallelMode = true;
+        // Messages posted before or since the last simulate() call
+        MailboxBase::closeQuantum();
+
+        inParallelMode = numMainEventQueues > 1;
     }
 
     simulatorThreads->runUntilLocalExit();
@@ -271,6 +278,7 @@ doSimLoop(EventQueue *eventq)
     // set the per thread current eventq pointer
     curEventQueue(eventq);
     eventq->handleAsyncInsertions();
+    MailboxBase::collectAll(eventq);
 
     while (1) {
         // there should always be at least one event (the SimLoopExitEvent
@@ -32,6 +32,7 @@
 #include <sys/syscall.h>
 #include <unistd.h>
 
+#include <atomic>
 #include <csignal>
 #include <iostream>
 #include <mutex>
@@ -45,6 +46,8 @@
 #include "mem/page_table.hh"
 #include "mem/se_translating_port_proxy.hh"
 #include "sim/byteswap.hh"
+#include "sim/global_event.hh"
+#include "sim/mailbox.hh"
 #include "sim/process.hh"
 #include "sim/proxy_ptr.hh"
 #include "sim/sim_exit.hh"
@@ -104,6 +107,73 @@ exitFutexWake(ThreadContext *tc, VPtr<> addr, uint64_t tgid)
     futex_map.wakeup(addr, tgid, 1);
 }
 
+namespace
+{
+
+/** Exit the simulation loop if no thread context is active any more. */
+void
+exitIfLastContext(System *sys, int status)
+{
+    int activeContexts = 0;
+    for (auto &system: sys->systemList)
+        activeContexts += system->threads.numRunning();
+
+    if (activeContexts == 0) {
+        /**
+         * Even though we are terminating the final thread context, dist-gem5
+         * requires the simulation to remain active and provide
+         * synchronization messages to the switch process. So we just halt
+         * the last thread context and return. The simulation will be
+         * terminated by dist-gem5 in a coordinated manner once all nodes
+         * have signaled their readiness to exit. For non dist-gem5
+         * simulations, readyToExit() always returns true.
+         */
+        if (!DistIface::readyToExit(0))
+            return;
+
+        exitSimLoop("exiting with last active thread context", status & 0xff);
+    }
+}
+
+/**
+ * Global event checking for the last active thread context, when all
+ * the event queues are at the same tick. Only the last pending check
+ * may exit, so that contexts halted in the same quantum exit once.
+ */
+class LastContextCheckEvent : public GlobalEvent
+{
+  private:
+    static std::atomic<int> pending;
+
+    System *sys;
+    int status;
+
+  public:
+    LastContextCheckEvent(Tick when, System *_sys, int _status)
+        : GlobalEvent(when, Sim_Exit_Pri, AutoDelete),
+          sys(_sys), status(_status)
+    {
+        ++pending;
+    }
+
+    void
+    process() override
+    {
+        if (--pending == 0)
+            exitIfLastContext(sys, status);
+    }
+
+    const char *
+    description() const override
+    {
+        return "last thread context check";
+    }
+};
+
+std::atomic<int> LastContextCheckEvent::pending(0);
+
+} // anonymous namespace
+
 static SyscallReturn
 exitImpl(SyscallDesc *desc, ThreadContext *tc, bool group, int status)
 {
@@ -208,29 +278,14 @@ exitImpl(SyscallDesc *desc, ThreadContext *tc, bool group, int status)
 
     /**
      * check to see if there is no more active thread in the system. If so,
-     * exit the simulation loop
+     * exit the simulation loop. The thread contexts of the other event
+     * queues are only looked at once all the queues have reached the
+     * same tick, a quantum later.
      */
-    int activeContexts = 0;
-    for (auto &system: sys->systemList)
-        activeContexts += system->threads.numRunning();
-
-    if (activeContexts == 0) {
-        /**
-         * Even though we are terminating the final thread context, dist-gem5
-         * requires the simulation to remain active and provide
-         * synchronization messages to the switch process. So we just halt
-         * the last thread context and return. The simulation will be
-         * terminated by dist-gem5 in a coordinated manner once all nodes
-         * have signaled their readiness to exit. For non dist-gem5
-         * simulations, readyToExit() always returns true.
-         */
-        if (!DistIface::readyToExit(0)) {
-            return status;
-        }
-
-        exitSimLoop("exiting with last active thread context", status & 0xff);
-        return status;
-    }
+    if (inParallelMode || MailboxBase::inUse())
+        new LastContextCheckEvent(curTick() + simQuantum, sys, status);
+    else
+        exitIfLastContext(sys, status);
 
     return status;
 }
@@ -64,6 +64,26 @@ gem5_verify_config(
     valid_isas=(constants.gcn3_x86_tag,),
 )
 
+# The config exits with an error if the systems simulated by one and by
+# several threads do not have the same statistics
+gem5_verify_config(
+    name='simple_cache_parallel_test',
+    verifiers=(),
+    config=joinpath(config_path, 'simple_cache_parallel.py'),
+    config_args=['--cores', '8', '--threads', '4'],
+    valid_isas=(constants.gcn3_x86_tag,),
+)
+
+# The config exits with an error if a tester does not reach its number of
+# loads, e.g., on reading stale data
+gem5_verify_config(
+    name='simple_cache_memtest_test',
+    verifiers=(),
+    config=joinpath(config_path, 'simple_cache_memtest.py'),
+    config_args=[],
+    valid_isas=(constants.null_tag,),
+)
+
 # Note: for simple memobj and simple cache I want to use the traffic generator
 # as well as the scripts above.
 